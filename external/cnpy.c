@@ -1,197 +1,658 @@
 #include "cnpy.h"
+#include "mem_track.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 #include <sys/stat.h>
 #include <zip.h>  // Use libzip for handling ZIP archives
+#include <emmintrin.h>  // SSE2 for dtype conversion
+#ifdef __F16C__
+#include <immintrin.h>  // F16C half conversion
+#endif
+
+// The format caps version 1 headers at 64 KiB; later versions only lift it for huge dtypes, so larger is corrupt
+#define NPY_MAX_HEADER_LEN 65536
 
 cnpy_array cnpy_load_npz(const char* fname, const char* varname) {
-    cnpy_array result = {NULL, NULL, 0, '\0'};
-    
-    printf("Attempting to open NPZ file: %s\n", fname);
+    cnpy_array result = {0};
 
-    // Open the NPZ archive using libzip
-    int err = 0;
-    zip_t* zip_archive = zip_open(fname, ZIP_RDONLY, &err);
-    if (zip_archive == NULL) {
-        printf("Error: Unable to open NPZ file %s\n", fname);
+    cnpy_npz* npz = cnpy_npz_open(fname);
+    if (!npz) {
         return result;
     }
 
-    printf("Successfully opened NPZ file: %s\n", fname);
+    result = cnpy_npz_load(npz, varname);
+    cnpy_npz_close(npz);
 
-    // Print all file names in the archive
-    zip_int64_t num_files = zip_get_num_entries(zip_archive, 0);
-    printf("Files in the NPZ archive:\n");
-    for (zip_int64_t i = 0; i < num_files; i++) {
-        const char* file_name = zip_get_name(zip_archive, i, 0);
-        printf(" - %s\n", file_name);
-    }
+    return result;
+}
 
-    // Look for the first array, `arr_0.npy`
-    for (zip_int64_t i = 0; i < num_files; i++) {
-        const char* file_name = zip_get_name(zip_archive, i, 0);
-        if (strstr(file_name, "arr_0.npy")) {
-            printf("Found matching variable: %s\n", file_name);
-
-            // Extract the NPY file from the archive
-            zip_file_t* npy_file = zip_fopen_index(zip_archive, i, 0);
-            if (!npy_file) {
-                printf("Error: Unable to extract NPY file %s\n", file_name);
-                zip_close(zip_archive);
-                return result;
-            }
-
-            // Read the contents of the NPY file
-            struct zip_stat st;
-            zip_stat_index(zip_archive, i, 0, &st);
-            size_t npy_size = st.size;
-            void* npy_data = malloc(npy_size);
-            if (!npy_data) {
-                printf("Error: Memory allocation failed for NPY data.\n");
-                zip_fclose(npy_file);
-                zip_close(zip_archive);
-                return result;
-            }
-
-            zip_fread(npy_file, npy_data, npy_size);
-            zip_fclose(npy_file);
-
-            // Now load the NPY data from memory
-            result = cnpy_load_npy_from_memory(npy_data, npy_size);
-
-            // Free the extracted NPY data
-            free(npy_data);
-
-            break;
-        }
+// Skip to the value of a header dictionary key such as 'descr'
+static const char* find_header_value(const char* header, const char* key) {
+    size_t key_len = strlen(key);
+    for (const char* p = strstr(header, key); p; p = strstr(p + 1, key)) {
+        // The key must be quoted, so both neighbours are quote characters
+        if (p == header || (p[-1] != '\'' && p[-1] != '"')) continue;
+        if (p[key_len] != '\'' && p[key_len] != '"') continue;
+        const char* colon = strchr(p + key_len + 1, ':');
+        if (!colon) return NULL;
+        colon++;
+        while (*colon == ' ') colon++;
+        return colon;
     }
+    return NULL;
+}
 
-    zip_close(zip_archive);
+// Parse a descr string such as '<f4' into kind, size and byte order
+static bool parse_descr(const char* value, cnpy_array* arr) {
+    char quote = value[0];
+    if (quote != '\'' && quote != '"') return false;
 
-    if (!result.data) {
-        printf("Error: 'arr_0' not found in NPZ file\n");
+    const char* p = value + 1;
+    char byte_order = *p;
+    if (byte_order == '<' || byte_order == '>' || byte_order == '|' || byte_order == '=') {
+        p++;
     } else {
-        // Inspect the loaded array
-        printf("Loaded array with %lu elements, ndim: %lu\n", result.shape ? result.shape[0] : 0, result.ndim);
+        byte_order = '=';
     }
 
-    // Debug: Print out the ndim and shape from the file header
-    printf("Array dimensions (ndim): %zu\n", result.ndim);
-    for (size_t i = 0; i < result.ndim; ++i) {
-        printf("Shape[%zu]: %zu\n", i, result.shape[i]);
+    char kind = *p++;
+    char* end = NULL;
+    unsigned long size = strtoul(p, &end, 10);
+    if (end == p || *end != quote) return false;
+
+    if (byte_order == '=') {
+        unsigned int probe = 1;
+        byte_order = (*(unsigned char*)&probe == 1) ? '<' : '>';
     }
 
-    return result;
+    arr->datatype = kind;
+    arr->word_size = size;
+    arr->big_endian = (byte_order == '>' && size > 1);
+
+    if (kind == 'f' && size == 2) arr->dtype = CNPY_DTYPE_F2;
+    else if (kind == 'f' && size == 4) arr->dtype = CNPY_DTYPE_F4;
+    else if (kind == 'f' && size == 8) arr->dtype = CNPY_DTYPE_F8;
+    else if (kind == 'u' && size == 1) arr->dtype = CNPY_DTYPE_U1;
+    else if (kind == 'u' && size == 2) arr->dtype = CNPY_DTYPE_U2;
+    else if (kind == 'i' && size == 4) arr->dtype = CNPY_DTYPE_I4;
+    else arr->dtype = CNPY_DTYPE_UNKNOWN;
+
+    return true;
 }
 
-cnpy_array cnpy_load_npy_from_memory(const void* npy_data, size_t npy_size) {
-    cnpy_array result = {NULL, NULL, 0, '\0'};
-    const char* data_ptr = (const char*)npy_data;
+// Parse a shape tuple such as (480, 640) or (307200,) of any length
+static bool parse_shape(const char* value, cnpy_array* arr) {
+    if (*value != '(') return false;
+
+    const char* close = strchr(value, ')');
+    if (!close) return false;
+
+    size_t ndim = 0;
+    for (const char* p = value + 1; p < close; p++) {
+        if (*p >= '0' && *p <= '9' && (p[-1] < '0' || p[-1] > '9')) ndim++;
+    }
+
+    arr->ndim = ndim;
+    arr->shape = (size_t*)mem_malloc(MEM_CNPY, (ndim ? ndim : 1) * sizeof(size_t));
+    if (!arr->shape) {
+        log_error("Memory allocation failed for shape.");
+        return false;
+    }
+
+    const char* p = value + 1;
+    for (size_t i = 0; i < ndim; i++) {
+        while (p < close && (*p < '0' || *p > '9')) p++;
+        char* end = NULL;
+        arr->shape[i] = (size_t)strtoull(p, &end, 10);
+        p = end;
+    }
+    return true;
+}
+
+bool cnpy_parse_npy_header(const void* npy_data, size_t npy_size, cnpy_array* arr, size_t* data_offset) {
+    const unsigned char* bytes = (const unsigned char*)npy_data;
+    cnpy_array parsed = {0};
 
     // Check the NPY magic string
-    if (strncmp(data_ptr, "\x93NUMPY", 6) != 0) {
-        printf("Error: Invalid NPY file format\n");
-        return result;
+    if (npy_size < 10 || memcmp(bytes, "\x93NUMPY", 6) != 0) {
+        log_error("Invalid NPY file format");
+        return false;
     }
 
-    // Read the version
-    unsigned char major_version = data_ptr[6];
-    unsigned char minor_version = data_ptr[7];
-    printf("NPY Version: %d.%d\n", major_version, minor_version);
+    // Version 1.x stores a 16-bit header length, 2.x and 3.x a 32-bit one
+    unsigned char major_version = bytes[6];
+    size_t header_len, header_start;
+    if (major_version == 1) {
+        header_len = (size_t)bytes[8] | ((size_t)bytes[9] << 8);
+        header_start = 10;
+    } else if (major_version == 2 || major_version == 3) {
+        if (npy_size < 12) return false;
+        header_len = (size_t)bytes[8] | ((size_t)bytes[9] << 8) |
+                     ((size_t)bytes[10] << 16) | ((size_t)bytes[11] << 24);
+        header_start = 12;
+    } else {
+        log_error("Unsupported NPY version %d.%d", major_version, bytes[7]);
+        return false;
+    }
+
+    if (header_len > NPY_MAX_HEADER_LEN) {
+        log_error("NPY header of %zu bytes is too large", header_len);
+        return false;
+    }
+    if (header_start + header_len > npy_size) {
+        log_error("Truncated NPY header");
+        return false;
+    }
 
-    // Read the header length (different depending on the version)
-    size_t header_len;
-    if (major_version == 1 && minor_version == 0) {
-        header_len = *(unsigned short*)(data_ptr + 8);
+    // Copy the header so it can be searched as a C string
+    char header_str[1024];
+    char* header = header_len < sizeof(header_str) ? header_str : (char*)mem_malloc(MEM_CNPY, header_len + 1);
+    if (!header) {
+        log_error("Memory allocation failed for NPY header.");
+        return false;
+    }
+    memcpy(header, bytes + header_start, header_len);
+    header[header_len] = '\0';
+
+    bool ok = true;
+    const char* descr = find_header_value(header, "descr");
+    const char* order = find_header_value(header, "fortran_order");
+    const char* shape = find_header_value(header, "shape");
+
+    if (!descr || !parse_descr(descr, &parsed)) {
+        log_error("Could not parse descr in the header: %s", header);
+        ok = false;
+    } else if (!shape || !parse_shape(shape, &parsed)) {
+        log_error("Could not find shape in the header: %s", header);
+        ok = false;
     } else {
-        header_len = *(unsigned int*)(data_ptr + 8);
+        parsed.fortran_order = order && strncmp(order, "True", 4) == 0;
+    }
+
+    if (ok && parsed.dtype == CNPY_DTYPE_UNKNOWN) {
+        log_error("Unsupported NPY dtype %c%zu", parsed.datatype, parsed.word_size);
+        ok = false;
     }
 
-    // Read the header string
-    char* header_str = malloc(header_len + 1);
-    if (!header_str) {
-        printf("Error: Memory allocation failed for NPY header.\n");
+    // Every loader sizes its buffers from shape times word size, so a product that wraps is rejected here
+    if (ok) {
+        size_t count = 1;
+        for (size_t i = 0; ok && i < parsed.ndim; i++) {
+            if (parsed.shape[i] != 0 && count > SIZE_MAX / parsed.shape[i]) ok = false;
+            count *= parsed.shape[i];
+        }
+        if (!ok || (parsed.word_size != 0 && count > SIZE_MAX / parsed.word_size)) {
+            log_error("NPY shape of %zu dimensions is too large to address", parsed.ndim);
+            ok = false;
+        }
+    }
+
+    if (header != header_str) mem_free(MEM_CNPY, header);
+
+    if (!ok) {
+        cnpy_free(&parsed);
+        return false;
+    }
+
+    *arr = parsed;
+    *data_offset = header_start + header_len;
+    return true;
+}
+
+size_t cnpy_num_elements(const cnpy_array* arr) {
+    size_t count = 1;
+    for (size_t i = 0; i < arr->ndim; i++) {
+        count *= arr->shape[i];
+    }
+    return count;
+}
+
+cnpy_array cnpy_load_npy_from_memory(const void* npy_data, size_t npy_size) {
+    cnpy_array result = {0};
+    size_t data_offset;
+
+    if (!cnpy_parse_npy_header(npy_data, npy_size, &result, &data_offset)) {
+        return result;
+    }
+
+    // Now read the data based on the shape and dtype
+    size_t data_size = cnpy_num_elements(&result) * result.word_size;
+    if (data_size > npy_size - data_offset) {
+        log_error("NPY data is truncated (%zu bytes expected, %zu available)",
+               data_size, npy_size - data_offset);
+        cnpy_free(&result);
+        return result;
+    }
+
+    result.data = mem_malloc(MEM_CNPY, data_size ? data_size : 1);
+    if (!result.data) {
+        log_error("Memory allocation failed for NPY data.");
+        cnpy_free(&result);
         return result;
     }
 
-    memcpy(header_str, data_ptr + 10, header_len);
-    header_str[header_len] = '\0';
+    memcpy(result.data, (const char*)npy_data + data_offset, data_size);
+
+    return result;
+}
+
+// IEEE half to single precision, handling denormals, infinities and NaN
+static float half_to_float(uint16_t h) {
+    union { uint32_t u; float f; } o, magic = { (254u - 15u) << 23 };
+    uint32_t expmant = h & 0x7fffu;
+    o.u = expmant << 13;
+    o.f *= magic.f;
+    if (expmant >= 0x7c00u) o.u |= 255u << 23;
+    o.u |= (uint32_t)(h & 0x8000u) << 16;
+    return o.f;
+}
 
-    printf("NPY Header: %s\n", header_str);
+#ifndef __F16C__
+// Four halves held in the low 16 bits of each 32-bit lane to four floats (SSE2)
+static inline __m128 half4_to_float(__m128i h) {
+    const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    __m128i expmant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+    __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expmant), 16);
+    __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expmant, 13)), magic);
+    __m128i infnan = _mm_and_si128(_mm_cmpgt_epi32(expmant, _mm_set1_epi32(0x7bff)),
+                                   _mm_set1_epi32(255 << 23));
+    return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infnan)));
+}
+#endif
 
-    // Extract array shape from the header string
-    // Assuming header contains something like 'shape': (480, 640, 1)
-    char* shape_str = strstr(header_str, "'shape':");
-    if (shape_str) {
-        // Count how many dimensions are present
-        size_t ndim = 0;
-        const char* dim_str = strchr(shape_str, '(');
-        if (dim_str) {
-            ndim = 1;  // Start with one dimension
-            for (const char* p = dim_str + 1; *p && *p != ')'; p++) {
-                if (*p == ',') ndim++;
-            }
+static void swap_bytes(unsigned char* bytes, size_t size) {
+    for (size_t i = 0; i < size / 2; i++) {
+        unsigned char tmp = bytes[i];
+        bytes[i] = bytes[size - 1 - i];
+        bytes[size - 1 - i] = tmp;
+    }
+}
+
+float cnpy_element_as_float(const cnpy_array* arr, size_t index) {
+    unsigned char bytes[8];
+    memcpy(bytes, (const unsigned char*)arr->data + index * arr->word_size, arr->word_size);
+    if (arr->big_endian) swap_bytes(bytes, arr->word_size);
+
+    switch (arr->dtype) {
+        case CNPY_DTYPE_F2: { uint16_t v; memcpy(&v, bytes, 2); return half_to_float(v); }
+        case CNPY_DTYPE_F4: { float v; memcpy(&v, bytes, 4); return v; }
+        case CNPY_DTYPE_F8: { double v; memcpy(&v, bytes, 8); return (float)v; }
+        case CNPY_DTYPE_U1: return (float)bytes[0];
+        case CNPY_DTYPE_U2: { uint16_t v; memcpy(&v, bytes, 2); return (float)v; }
+        case CNPY_DTYPE_I4: { int32_t v; memcpy(&v, bytes, 4); return (float)v; }
+        default: return 0.0f;
+    }
+}
+
+void cnpy_convert_to_float(const cnpy_array* arr, size_t first, size_t count, float* out) {
+    const unsigned char* src = (const unsigned char*)arr->data + first * arr->word_size;
+    size_t i = 0;
+
+    if (!arr->big_endian) {
+        const __m128i zero = _mm_setzero_si128();
+        switch (arr->dtype) {
+            case CNPY_DTYPE_F4:
+                memcpy(out, src, count * sizeof(float));
+                return;
+            case CNPY_DTYPE_F8:
+                for (; i + 4 <= count; i += 4) {
+                    __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd((const double*)(src + i * 8)));
+                    __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd((const double*)(src + i * 8 + 16)));
+                    _mm_storeu_ps(out + i, _mm_movelh_ps(lo, hi));
+                }
+                break;
+            case CNPY_DTYPE_F2:
+                for (; i + 8 <= count; i += 8) {
+                    __m128i h = _mm_loadu_si128((const __m128i*)(src + i * 2));
+#ifdef __F16C__
+                    _mm_storeu_ps(out + i, _mm_cvtph_ps(h));
+                    _mm_storeu_ps(out + i + 4, _mm_cvtph_ps(_mm_unpackhi_epi64(h, h)));
+#else
+                    _mm_storeu_ps(out + i, half4_to_float(_mm_unpacklo_epi16(h, zero)));
+                    _mm_storeu_ps(out + i + 4, half4_to_float(_mm_unpackhi_epi16(h, zero)));
+#endif
+                }
+                break;
+            case CNPY_DTYPE_U1:
+                for (; i + 16 <= count; i += 16) {
+                    __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+                    __m128i lo = _mm_unpacklo_epi8(b, zero);
+                    __m128i hi = _mm_unpackhi_epi8(b, zero);
+                    _mm_storeu_ps(out + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+                    _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+                    _mm_storeu_ps(out + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+                    _mm_storeu_ps(out + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+                }
+                break;
+            case CNPY_DTYPE_U2:
+                for (; i + 8 <= count; i += 8) {
+                    __m128i w = _mm_loadu_si128((const __m128i*)(src + i * 2));
+                    _mm_storeu_ps(out + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(w, zero)));
+                    _mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(w, zero)));
+                }
+                break;
+            case CNPY_DTYPE_I4:
+                for (; i + 4 <= count; i += 4) {
+                    __m128i v = _mm_loadu_si128((const __m128i*)(src + i * 4));
+                    _mm_storeu_ps(out + i, _mm_cvtepi32_ps(v));
+                }
+                break;
+            default:
+                break;
         }
-        result.ndim = ndim;
-
-        // Allocate memory for the shape array based on the number of dimensions
-        result.shape = (size_t*)malloc(result.ndim * sizeof(size_t));
-        if (!result.shape) {
-            printf("Error: Memory allocation failed for shape.\n");
-            free(header_str);
-            return result;
+    }
+
+    // Remaining tail elements and big-endian data go through the scalar path
+    for (; i < count; i++) {
+        out[i] = cnpy_element_as_float(arr, first + i);
+    }
+}
+
+// One archive member, keyed by its variable name (member name without ".npy")
+typedef struct {
+    char* name;
+    zip_uint64_t index;
+    zip_uint64_t size;      // Uncompressed member size, 0 if unknown
+    bool has_meta;
+    cnpy_array meta;        // Cached header information, data always NULL
+    size_t data_offset;
+} cnpy_npz_entry;
+
+struct cnpy_npz {
+    zip_t* zip;
+    cnpy_npz_entry* entries;
+    size_t count;
+    size_t* table;          // Open-addressed hash table of entry index + 1, 0 = empty
+    size_t table_mask;
+};
+
+// FNV-1a over at most len bytes of a name
+static size_t hash_name(const char* name, size_t len) {
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < len && name[i]; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+// Length of a variable name once an optional ".npy" suffix is removed
+static size_t var_name_length(const char* name) {
+    size_t len = strlen(name);
+    if (len >= 4 && strcmp(name + len - 4, ".npy") == 0) len -= 4;
+    return len;
+}
+
+static cnpy_npz_entry* find_entry(const cnpy_npz* npz, const char* varname) {
+    size_t len = var_name_length(varname);
+    for (size_t slot = hash_name(varname, len) & npz->table_mask; npz->table[slot];
+         slot = (slot + 1) & npz->table_mask) {
+        cnpy_npz_entry* entry = &npz->entries[npz->table[slot] - 1];
+        if (strlen(entry->name) == len && strncmp(entry->name, varname, len) == 0) {
+            return entry;
         }
+    }
+    return NULL;
+}
+
+cnpy_npz* cnpy_npz_open(const char* fname) {
+    int err = 0;
+    zip_t* zip_archive = zip_open(fname, ZIP_RDONLY, &err);
+    if (zip_archive == NULL) {
+        log_error("Unable to open NPZ file %s", fname);
+        return NULL;
+    }
 
-        // Extract shape values based on the number of dimensions
-        if (ndim == 1) {
-            sscanf(shape_str, "'shape': (%zu)", &result.shape[0]);
-        } else if (ndim == 2) {
-            sscanf(shape_str, "'shape': (%zu, %zu)", &result.shape[0], &result.shape[1]);
-        } else if (ndim == 3) {
-            sscanf(shape_str, "'shape': (%zu, %zu, %zu)", &result.shape[0], &result.shape[1], &result.shape[2]);
-        } else {
-            printf("Error: Unsupported number of dimensions (%zu)\n", ndim);
-            free(header_str);
-            return result;
+    zip_int64_t num_files = zip_get_num_entries(zip_archive, 0);
+    cnpy_npz* npz = (cnpy_npz*)mem_calloc(MEM_CNPY, 1, sizeof(cnpy_npz));
+    size_t table_size = 16;
+    while (table_size < (size_t)(num_files > 0 ? num_files : 0) * 2) table_size *= 2;
+
+    if (npz) {
+        npz->entries = (cnpy_npz_entry*)mem_calloc(MEM_CNPY, num_files > 0 ? (size_t)num_files : 1, sizeof(cnpy_npz_entry));
+        npz->table = (size_t*)mem_calloc(MEM_CNPY, table_size, sizeof(size_t));
+    }
+    if (!npz || !npz->entries || !npz->table) {
+        log_error("Memory allocation failed for NPZ index.");
+        if (npz) {
+            mem_free(MEM_CNPY, npz->entries);
+            mem_free(MEM_CNPY, npz->table);
+            mem_free(MEM_CNPY, npz);
         }
+        zip_close(zip_archive);
+        return NULL;
+    }
+
+    npz->zip = zip_archive;
+    npz->table_mask = table_size - 1;
 
-        printf("Parsed shape: ");
-        for (size_t i = 0; i < result.ndim; ++i) {
-            printf("%zu ", result.shape[i]);
+    // Index every .npy member by name; only the central directory is read here
+    for (zip_int64_t i = 0; i < num_files; i++) {
+        const char* file_name = zip_get_name(zip_archive, i, 0);
+        if (!file_name) continue;
+
+        size_t len = var_name_length(file_name);
+        if (len == strlen(file_name) || find_entry(npz, file_name)) continue;
+
+        cnpy_npz_entry* entry = &npz->entries[npz->count];
+        entry->name = (char*)mem_malloc(MEM_CNPY, len + 1);
+        if (!entry->name) continue;
+        memcpy(entry->name, file_name, len);
+        entry->name[len] = '\0';
+        entry->index = (zip_uint64_t)i;
+
+        struct zip_stat st;
+        zip_stat_init(&st);
+        if (zip_stat_index(zip_archive, i, 0, &st) == 0 && (st.valid & ZIP_STAT_SIZE)) {
+            entry->size = st.size;
         }
-        printf("\n");
 
-    } else {
-        printf("Error: Could not find shape in the header\n");
-        free(header_str);
+        size_t slot = hash_name(entry->name, len) & npz->table_mask;
+        while (npz->table[slot]) slot = (slot + 1) & npz->table_mask;
+        npz->table[slot] = ++npz->count;
+    }
+
+    return npz;
+}
+
+void cnpy_npz_close(cnpy_npz* npz) {
+    if (!npz) return;
+    for (size_t i = 0; i < npz->count; i++) {
+        mem_free(MEM_CNPY, npz->entries[i].name);
+        cnpy_free(&npz->entries[i].meta);
+    }
+    mem_free(MEM_CNPY, npz->entries);
+    mem_free(MEM_CNPY, npz->table);
+    zip_close(npz->zip);
+    mem_free(MEM_CNPY, npz);
+}
+
+size_t cnpy_npz_count(const cnpy_npz* npz) {
+    return npz ? npz->count : 0;
+}
+
+const char* cnpy_npz_name(const cnpy_npz* npz, size_t i) {
+    return (npz && i < npz->count) ? npz->entries[i].name : NULL;
+}
+
+bool cnpy_npz_contains(const cnpy_npz* npz, const char* varname) {
+    return npz && find_entry(npz, varname) != NULL;
+}
+
+// Read exactly size bytes from a member stream
+static bool read_member(zip_file_t* file, void* dst, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        zip_int64_t got = zip_fread(file, (char*)dst + done, size - done);
+        if (got <= 0) return false;
+        done += (size_t)got;
+    }
+    return true;
+}
+
+// Open a member and consume its npy header, leaving the stream at the element data.
+// Only the header bytes are inflated, and the parsed header is cached on the entry.
+static zip_file_t* open_npy_stream(cnpy_npz* npz, cnpy_npz_entry* entry) {
+    zip_file_t* file = zip_fopen_index(npz->zip, entry->index, 0);
+    if (!file) {
+        log_error("Unable to extract NPY file %s.npy", entry->name);
+        return NULL;
+    }
+
+    unsigned char prefix[12];
+    if (!read_member(file, prefix, sizeof(prefix))) {
+        log_error("Truncated NPY file %s.npy", entry->name);
+        zip_fclose(file);
+        return NULL;
+    }
+
+    // Validated before the length is trusted, so a corrupt member cannot request a huge header buffer
+    if (memcmp(prefix, "\x93NUMPY", 6) != 0 || prefix[6] < 1 || prefix[6] > 3) {
+        log_error("%s.npy is not a supported NPY file", entry->name);
+        zip_fclose(file);
+        return NULL;
+    }
+    size_t header_len = prefix[6] == 1
+        ? ((size_t)prefix[8] | ((size_t)prefix[9] << 8)) + 10
+        : ((size_t)prefix[8] | ((size_t)prefix[9] << 8) | ((size_t)prefix[10] << 16) | ((size_t)prefix[11] << 24)) + 12;
+    if (header_len > NPY_MAX_HEADER_LEN + 12) {
+        log_error("NPY header of %s.npy is too large (%zu bytes)", entry->name, header_len);
+        zip_fclose(file);
+        return NULL;
+    }
+
+    unsigned char local[1024];
+    unsigned char* header = header_len <= sizeof(local) ? local : (unsigned char*)mem_malloc(MEM_CNPY, header_len);
+    bool ok = header != NULL && header_len >= sizeof(prefix);
+    if (ok) {
+        memcpy(header, prefix, sizeof(prefix));
+        ok = read_member(file, header + sizeof(prefix), header_len - sizeof(prefix));
+    }
+
+    if (ok && !entry->has_meta) {
+        ok = cnpy_parse_npy_header(header, header_len, &entry->meta, &entry->data_offset);
+        entry->has_meta = ok;
+    }
+
+    if (header && header != local) mem_free(MEM_CNPY, header);
+
+    if (!ok) {
+        log_error("Could not read NPY header of %s.npy", entry->name);
+        zip_fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+// Copy cached metadata into a caller-owned array with its own shape buffer
+static bool copy_meta(const cnpy_npz_entry* entry, cnpy_array* out) {
+    *out = entry->meta;
+    out->data = NULL;
+    out->shape = (size_t*)mem_malloc(MEM_CNPY, (entry->meta.ndim ? entry->meta.ndim : 1) * sizeof(size_t));
+    if (!out->shape) {
+        log_error("Memory allocation failed for shape.");
+        *out = (cnpy_array){0};
+        return false;
+    }
+    memcpy(out->shape, entry->meta.shape, entry->meta.ndim * sizeof(size_t));
+    return true;
+}
+
+bool cnpy_npz_info(cnpy_npz* npz, const char* varname, cnpy_array* meta) {
+    cnpy_npz_entry* entry = npz ? find_entry(npz, varname) : NULL;
+    if (!entry) {
+        log_error("'%s' not found in NPZ file", varname);
+        return false;
+    }
+
+    if (!entry->has_meta) {
+        zip_file_t* file = open_npy_stream(npz, entry);
+        if (!file) return false;
+        zip_fclose(file);
+    }
+
+    return copy_meta(entry, meta);
+}
+
+cnpy_array cnpy_npz_load(cnpy_npz* npz, const char* varname) {
+    cnpy_array result = {0};
+
+    cnpy_npz_entry* entry = npz ? find_entry(npz, varname) : NULL;
+    if (!entry) {
+        log_error("'%s' not found in NPZ file", varname);
         return result;
     }
 
-    // Now read the data based on the shape and dtype
-    size_t data_offset = 10 + header_len;
-    size_t data_size = npy_size - data_offset;
+    zip_file_t* file = open_npy_stream(npz, entry);
+    if (!file) return result;
 
-    result.data = malloc(data_size);
-    if (!result.data) {
-        printf("Error: Memory allocation failed for NPY data.\n");
-        free(header_str);
+    size_t data_size = cnpy_num_elements(&entry->meta) * entry->meta.word_size;
+    if (entry->size && (entry->data_offset > entry->size || data_size > entry->size - entry->data_offset)) {
+        log_error("NPY data is truncated in %s.npy", entry->name);
+        zip_fclose(file);
         return result;
     }
 
-    memcpy(result.data, data_ptr + data_offset, data_size);
+    if (!copy_meta(entry, &result)) {
+        zip_fclose(file);
+        return result;
+    }
 
-    free(header_str);
+    // Inflate straight into the final buffer, no intermediate copy of the member
+    result.data = mem_malloc(MEM_CNPY, data_size ? data_size : 1);
+    if (!result.data) {
+        log_error("Memory allocation failed for NPY data.");
+        cnpy_free(&result);
+    } else if (!read_member(file, result.data, data_size)) {
+        log_error("Failed to read NPY data of %s.npy", entry->name);
+        cnpy_free(&result);
+    }
 
+    zip_fclose(file);
     return result;
 }
 
+bool cnpy_npz_load_into(cnpy_npz* npz, const char* varname, void* buffer, size_t capacity, cnpy_array* meta) {
+    cnpy_npz_entry* entry = npz ? find_entry(npz, varname) : NULL;
+    if (!entry) {
+        log_error("'%s' not found in NPZ file", varname);
+        return false;
+    }
+
+    zip_file_t* file = open_npy_stream(npz, entry);
+    if (!file) return false;
+
+    size_t data_size = cnpy_num_elements(&entry->meta) * entry->meta.word_size;
+    if (data_size > capacity) {
+        log_error("%s.npy needs %zu bytes but the buffer holds %zu", entry->name, data_size, capacity);
+        zip_fclose(file);
+        return false;
+    }
+
+    bool ok = read_member(file, buffer, data_size);
+    zip_fclose(file);
+    if (!ok) {
+        log_error("Failed to read NPY data of %s.npy", entry->name);
+        return false;
+    }
+
+    return copy_meta(entry, meta);
+}
+
 void cnpy_free(cnpy_array* arr) {
-    if (arr->data) free(arr->data);
-    if (arr->shape) free(arr->shape);
+    if (arr->data) mem_free(MEM_CNPY, arr->data);
+    if (arr->shape) mem_free(MEM_CNPY, arr->shape);
     arr->data = NULL;
     arr->shape = NULL;
     arr->ndim = 0;
     arr->datatype = '\0';
+    arr->dtype = CNPY_DTYPE_UNKNOWN;
+    arr->word_size = 0;
+    arr->big_endian = false;
+    arr->fortran_order = false;
 }
+
@@ -2,31 +2,140 @@
 #define CNPY_H
 
 #include <stddef.h>  // For size_t
+#include <stdbool.h>
+
+/**
+ * Element types understood by the loader, taken from the 'descr' header field.
+ * Byte order is tracked separately in cnpy_array.big_endian.
+ */
+typedef enum {
+    CNPY_DTYPE_UNKNOWN = 0,
+    CNPY_DTYPE_F2,     // IEEE half precision ('f2')
+    CNPY_DTYPE_F4,     // IEEE single precision ('f4')
+    CNPY_DTYPE_F8,     // IEEE double precision ('f8')
+    CNPY_DTYPE_U1,     // unsigned 8-bit integer ('u1')
+    CNPY_DTYPE_U2,     // unsigned 16-bit integer ('u2')
+    CNPY_DTYPE_I4      // signed 32-bit integer ('i4')
+} cnpy_dtype;
 
 /**
  * Structure to store a loaded NumPy array.
- * - data: Pointer to the array data.
+ * - data: Pointer to the raw array data, exactly as stored in the file.
  * - shape: Pointer to the array's dimensions (size of each axis).
  * - ndim: Number of dimensions in the array.
  * - datatype: Character representing the data type ('f' for float, 'i' for int, etc.).
+ * - dtype: Parsed element type, see cnpy_dtype.
+ * - word_size: Size of one element in bytes.
+ * - big_endian: True when the data is stored big-endian ('>' in descr).
+ * - fortran_order: True when the data is stored column-major.
  */
 typedef struct {
     void* data;        // Pointer to the raw array data
     size_t* shape;     // Array shape (e.g., dimensions like [100, 3])
     size_t ndim;       // Number of dimensions
     char datatype;     // Data type of the array ('f' for float, 'i' for int, etc.)
+    cnpy_dtype dtype;  // Parsed element type
+    size_t word_size;  // Bytes per element
+    bool big_endian;   // Byte order of the stored elements
+    bool fortran_order; // Column-major storage
 } cnpy_array;
 
+/**
+ * Handle to an open .npz archive. Members are indexed by variable name when
+ * the archive is opened and decompressed lazily when a variable is loaded.
+ * A handle may be used by one thread at a time.
+ */
+typedef struct cnpy_npz cnpy_npz;
+
+/**
+ * Open a .npz archive and index its members. Returns NULL on failure.
+ */
+cnpy_npz* cnpy_npz_open(const char* fname);
+
+/**
+ * Close an archive opened with cnpy_npz_open.
+ */
+void cnpy_npz_close(cnpy_npz* npz);
+
+/**
+ * Number of variables in the archive and the name of the i-th one
+ * (member name without the ".npy" suffix).
+ */
+size_t cnpy_npz_count(const cnpy_npz* npz);
+const char* cnpy_npz_name(const cnpy_npz* npz, size_t i);
+
+/**
+ * Whether the archive contains a variable. Both "arr_0" and "arr_0.npy" are accepted.
+ */
+bool cnpy_npz_contains(const cnpy_npz* npz, const char* varname);
+
+/**
+ * Read shape and dtype of a variable without loading its data.
+ * - Only the npy header at the start of the member is read; the result is cached.
+ * - meta->data is NULL; release meta->shape with cnpy_free.
+ * Returns true on success.
+ */
+bool cnpy_npz_info(cnpy_npz* npz, const char* varname, cnpy_array* meta);
+
+/**
+ * Load a variable from an open archive. The member is inflated directly into
+ * the returned data buffer. Returns an array with data == NULL on failure.
+ */
+cnpy_array cnpy_npz_load(cnpy_npz* npz, const char* varname);
+
+/**
+ * Load a variable into a caller-owned buffer, e.g. one reused across frames.
+ * - Fails without reading any data if the variable needs more than capacity bytes;
+ *   cnpy_npz_info gives the size up front.
+ * - On success meta describes the array but meta->data stays NULL; release meta with cnpy_free.
+ * Returns true on success.
+ */
+bool cnpy_npz_load_into(cnpy_npz* npz, const char* varname, void* buffer, size_t capacity, cnpy_array* meta);
+
 /**
  * Load a specific variable from a .npz file (NumPy ZIP archive).
  * - fname: The filename of the .npz file.
  * - varname: The name of the variable to extract from the .npz archive.
  * Returns a cnpy_array struct containing the array data, shape, and metadata.
+ * Convenience wrapper that opens, loads and closes the archive.
  */
 cnpy_array cnpy_load_npz(const char* fname, const char* varname);
-// Add this declaration at the top of cnpy.c or in cnpy.h
+
+/**
+ * Load an array from an in-memory .npy image.
+ * - npy_data: Pointer to the start of the .npy file contents.
+ * - npy_size: Size of the .npy file contents in bytes.
+ * The element data is copied unconverted; use cnpy_convert_to_float to read it.
+ */
 cnpy_array cnpy_load_npy_from_memory(const void* npy_data, size_t npy_size);
 
+/**
+ * Parse the magic string and header dictionary of a .npy image.
+ * - npy_data: Pointer to at least the first npy_size bytes of the .npy file.
+ * - arr: Receives shape, ndim and dtype information; data is left NULL.
+ * - data_offset: Receives the byte offset of the element data.
+ * Returns true on success. On success arr->shape must be released with cnpy_free.
+ */
+bool cnpy_parse_npy_header(const void* npy_data, size_t npy_size, cnpy_array* arr, size_t* data_offset);
+
+/**
+ * Number of elements in the array (product of the shape, 1 for 0-d arrays).
+ */
+size_t cnpy_num_elements(const cnpy_array* arr);
+
+/**
+ * Convert count consecutive stored elements starting at element first to float.
+ * - Uses SSE2 (and F16C when available) for little-endian data.
+ * - Elements are taken in storage order, so callers reading Fortran-ordered
+ *   arrays must account for the transposed layout themselves.
+ */
+void cnpy_convert_to_float(const cnpy_array* arr, size_t first, size_t count, float* out);
+
+/**
+ * Read a single stored element as float. Slow path for strided access.
+ */
+float cnpy_element_as_float(const cnpy_array* arr, size_t index);
+
 /**
  * Free the memory associated with a cnpy_array.
  * - arr: Pointer to the cnpy_array to free.
@@ -0,0 +1,266 @@
+// File: src/arena.c
+#include "arena.h"
+#include "platform.h"
+#include "log.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define POOL_ALIGNMENT 64
+#define POOL_MIN_CLASS 12     // 4 KiB
+#define POOL_CLASS_COUNT 48
+
+struct ArenaBlock {
+    ArenaBlock* prev;
+    size_t size;   // Usable bytes after the header
+    size_t used;
+};
+
+static atomic_size_t heap_allocations;
+static atomic_size_t heap_frees;
+static atomic_size_t heap_bytes;
+static atomic_size_t arena_allocations;
+static atomic_size_t pool_hits;
+static atomic_size_t pool_misses;
+
+// Every heap request of the arenas and pools goes through these two functions
+static void* counted_malloc(size_t size, MemSubsystem subsystem) {
+    void* memory = malloc(size);
+    if (memory) {
+        atomic_fetch_add_explicit(&heap_allocations, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&heap_bytes, size, memory_order_relaxed);
+        mem_track(subsystem, size);
+    }
+    return memory;
+}
+
+static void counted_free(void* memory, size_t size, MemSubsystem subsystem) {
+    if (!memory) return;
+    atomic_fetch_add_explicit(&heap_frees, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&heap_bytes, size, memory_order_relaxed);
+    mem_untrack(subsystem, size);
+    free(memory);
+}
+
+void alloc_counters_get(AllocCounters* counters) {
+    counters->heap_allocations = atomic_load_explicit(&heap_allocations, memory_order_relaxed);
+    counters->heap_frees = atomic_load_explicit(&heap_frees, memory_order_relaxed);
+    counters->heap_bytes = atomic_load_explicit(&heap_bytes, memory_order_relaxed);
+    counters->arena_allocations = atomic_load_explicit(&arena_allocations, memory_order_relaxed);
+    counters->pool_hits = atomic_load_explicit(&pool_hits, memory_order_relaxed);
+    counters->pool_misses = atomic_load_explicit(&pool_misses, memory_order_relaxed);
+}
+
+void arena_init(Arena* arena, size_t block_size) {
+    arena->current = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->capacity = 0;
+    arena->peak = 0;
+    arena->subsystem = MEM_ARENAS;
+}
+
+static ArenaBlock* new_block(Arena* arena, size_t size) {
+    ArenaBlock* block = (ArenaBlock*)counted_malloc(sizeof(ArenaBlock) + size, arena->subsystem);
+    if (!block) {
+        log_error("Failed to allocate %zu bytes of arena memory.", size);
+        return NULL;
+    }
+    block->prev = arena->current;
+    block->size = size;
+    block->used = 0;
+    arena->current = block;
+    arena->capacity += size;
+    return block;
+}
+
+static void free_blocks_after(Arena* arena, ArenaBlock* keep) {
+    while (arena->current && arena->current != keep) {
+        ArenaBlock* prev = arena->current->prev;
+        arena->capacity -= arena->current->size;
+        counted_free(arena->current, sizeof(ArenaBlock) + arena->current->size, arena->subsystem);
+        arena->current = prev;
+    }
+}
+
+void arena_free(Arena* arena) {
+    free_blocks_after(arena, NULL);
+    arena->peak = 0;
+}
+
+// Bytes handed out, counting each block up to its fill level
+static size_t arena_used(const Arena* arena) {
+    size_t used = 0;
+    for (const ArenaBlock* block = arena->current; block; block = block->prev) used += block->used;
+    return used;
+}
+
+void* arena_alloc(Arena* arena, size_t size, size_t alignment) {
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    atomic_fetch_add_explicit(&arena_allocations, 1, memory_order_relaxed);
+
+    ArenaBlock* block = arena->current;
+    if (block) {
+        uintptr_t base = (uintptr_t)(block + 1);
+        uintptr_t start = (base + block->used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (start + size <= base + block->size) {
+            block->used = start + size - base;
+            return (void*)start;
+        }
+    }
+
+    // Grow geometrically so a growing workload needs few blocks before it coalesces
+    size_t needed = size + alignment;
+    size_t block_size = arena->capacity > arena->block_size ? arena->capacity : arena->block_size;
+    if (block_size < needed) block_size = needed;
+    size_t used_before = arena_used(arena);
+
+    block = new_block(arena, block_size);
+    if (!block) return NULL;
+
+    uintptr_t base = (uintptr_t)(block + 1);
+    uintptr_t start = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    block->used = start + size - base;
+    if (used_before + block->used > arena->peak) arena->peak = used_before + block->used;
+    return (void*)start;
+}
+
+void arena_reset(Arena* arena) {
+    size_t used = arena_used(arena);
+    if (used > arena->peak) arena->peak = used;
+    if (!arena->current) return;
+
+    // Several blocks mean the workload outgrew the arena: replace them with one block that fits it
+    if (arena->current->prev) {
+        size_t capacity = arena->capacity;
+        free_blocks_after(arena, NULL);
+        new_block(arena, capacity);
+        return;
+    }
+    arena->current->used = 0;
+}
+
+ArenaMark arena_mark(const Arena* arena) {
+    ArenaMark mark = { arena->current, arena->current ? arena->current->used : 0 };
+    return mark;
+}
+
+void arena_release(Arena* arena, ArenaMark mark) {
+    bool at_start = mark.block == NULL || (mark.block->prev == NULL && mark.used == 0);
+    if (at_start) {
+        arena_reset(arena);
+        return;
+    }
+
+    size_t used = arena_used(arena);
+    if (used > arena->peak) arena->peak = used;
+    free_blocks_after(arena, mark.block);
+    mark.block->used = mark.used;
+}
+
+static _Thread_local Arena scratch_arena;
+static _Thread_local bool scratch_ready;
+
+Arena* arena_scratch(void) {
+    if (!scratch_ready) {
+        arena_init(&scratch_arena, 0);
+        scratch_ready = true;
+    }
+    return &scratch_arena;
+}
+
+void arena_scratch_free(void) {
+    if (scratch_ready) arena_free(&scratch_arena);
+}
+
+// Placed directly in front of every pooled buffer
+typedef struct PoolHeader {
+    void* raw;                  // Start of the heap allocation
+    struct PoolHeader* next;    // Free-list link while the buffer is in the pool
+    size_t size_class;
+} PoolHeader;
+
+struct BufferPool {
+    PlatformMutex mutex;
+    PoolHeader* free_lists[POOL_CLASS_COUNT];
+};
+
+static size_t size_class_of(size_t size) {
+    size_t size_class = POOL_MIN_CLASS;
+    while (size_class < POOL_MIN_CLASS + POOL_CLASS_COUNT - 1 && ((size_t)1 << size_class) < size) size_class++;
+    return size_class;
+}
+
+static size_t pooled_allocation_size(size_t size_class) {
+    return ((size_t)1 << size_class) + sizeof(PoolHeader) + POOL_ALIGNMENT;
+}
+
+BufferPool* buffer_pool_create(void) {
+    BufferPool* pool = (BufferPool*)calloc(1, sizeof(BufferPool));
+    if (!pool) return NULL;
+    platform_mutex_init(&pool->mutex);
+    return pool;
+}
+
+void buffer_pool_destroy(BufferPool* pool) {
+    if (!pool) return;
+    for (size_t i = 0; i < POOL_CLASS_COUNT; i++) {
+        PoolHeader* header = pool->free_lists[i];
+        while (header) {
+            PoolHeader* next = header->next;
+            counted_free(header->raw, pooled_allocation_size(header->size_class), MEM_ARENAS);
+            header = next;
+        }
+    }
+    platform_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+void* buffer_pool_acquire(BufferPool* pool, size_t size) {
+    size_t size_class = size_class_of(size);
+    if (((size_t)1 << size_class) < size) {
+        log_error("Buffer of %zu bytes is too large for the pool.", size);
+        return NULL;
+    }
+
+    platform_mutex_lock(&pool->mutex);
+    PoolHeader* header = pool->free_lists[size_class - POOL_MIN_CLASS];
+    if (header) {
+        pool->free_lists[size_class - POOL_MIN_CLASS] = header->next;
+    }
+    platform_mutex_unlock(&pool->mutex);
+
+    if (header) {
+        atomic_fetch_add_explicit(&pool_hits, 1, memory_order_relaxed);
+        return header + 1;
+    }
+
+    atomic_fetch_add_explicit(&pool_misses, 1, memory_order_relaxed);
+    void* raw = counted_malloc(pooled_allocation_size(size_class), MEM_ARENAS);
+    if (!raw) {
+        log_error("Failed to allocate a pooled buffer of %zu bytes.", (size_t)1 << size_class);
+        return NULL;
+    }
+
+    // Align the buffer itself; the header sits right in front of it
+    uintptr_t buffer = ((uintptr_t)raw + sizeof(PoolHeader) + POOL_ALIGNMENT - 1) & ~(uintptr_t)(POOL_ALIGNMENT - 1);
+    header = (PoolHeader*)buffer - 1;
+    header->raw = raw;
+    header->next = NULL;
+    header->size_class = size_class;
+    return (void*)buffer;
+}
+
+size_t buffer_pool_capacity(const void* buffer) {
+    return buffer ? (size_t)1 << ((const PoolHeader*)buffer - 1)->size_class : 0;
+}
+
+void buffer_pool_release(BufferPool* pool, void* buffer) {
+    if (!buffer) return;
+    PoolHeader* header = (PoolHeader*)buffer - 1;
+
+    platform_mutex_lock(&pool->mutex);
+    header->next = pool->free_lists[header->size_class - POOL_MIN_CLASS];
+    pool->free_lists[header->size_class - POOL_MIN_CLASS] = header;
+    platform_mutex_unlock(&pool->mutex);
+}
@@ -0,0 +1,94 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "mem_track.h"
+
+#define ARENA_DEFAULT_BLOCK_SIZE (1u << 20)
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * Bump allocator for memory with a shared lifetime: load-scoped temporaries
+ * or the scratch buffers of one rendered frame. Allocations are never freed
+ * one by one; the whole arena is reset (or rolled back to a mark) instead.
+ *
+ * Memory is taken from the heap in blocks. A reset that finds more than one
+ * block replaces them with a single block of the combined size, so a
+ * workload that repeats settles into one block and stops allocating.
+ * An arena is not thread-safe.
+ */
+typedef struct {
+    ArenaBlock* current;   // Newest block, NULL before the first allocation
+    size_t block_size;     // Minimum size of a new block
+    size_t capacity;       // Bytes in all blocks
+    size_t peak;           // Largest number of bytes handed out between resets
+    MemSubsystem subsystem; // Where its blocks are counted; MEM_ARENAS unless the owner sets another
+} Arena;
+
+// Position to roll an arena back to
+typedef struct {
+    ArenaBlock* block;
+    size_t used;
+} ArenaMark;
+
+void arena_init(Arena* arena, size_t block_size);
+void arena_free(Arena* arena);
+
+// Returns size bytes aligned to alignment (a power of two), or NULL if the heap is exhausted
+void* arena_alloc(Arena* arena, size_t size, size_t alignment);
+
+// Discards every allocation; keeps (and coalesces) the memory for reuse
+void arena_reset(Arena* arena);
+
+ArenaMark arena_mark(const Arena* arena);
+
+// Discards the allocations made since the mark. Rolling back to an empty arena is a reset.
+void arena_release(Arena* arena, ArenaMark mark);
+
+/**
+ * @brief Per-thread arena for load-scoped temporaries.
+ *
+ * Callers take a mark on entry and release it before returning, so the
+ * memory is reused by the next load on the same thread.
+ */
+Arena* arena_scratch(void);
+
+// Releases the calling thread's scratch arena memory
+void arena_scratch_free(void);
+
+/**
+ * Size-classed pool for large buffers that are reused across scenes or
+ * frames (splat arrays, decoded frames). Buffers are rounded up to a power
+ * of two and returned buffers are kept on a free list of their class.
+ * A pool may be shared between threads.
+ */
+typedef struct BufferPool BufferPool;
+
+BufferPool* buffer_pool_create(void);
+
+// Frees the pool and every buffer on its free lists (buffers still acquired must be released first)
+void buffer_pool_destroy(BufferPool* pool);
+
+// Returns a 64-byte aligned buffer of at least size bytes, or NULL on failure
+void* buffer_pool_acquire(BufferPool* pool, size_t size);
+
+// Usable size of an acquired buffer
+size_t buffer_pool_capacity(const void* buffer);
+
+void buffer_pool_release(BufferPool* pool, void* buffer);
+
+// Heap activity of the arenas and pools, to check that steady-state work does not allocate
+typedef struct {
+    size_t heap_allocations;     // Blocks and buffers taken from the heap
+    size_t heap_frees;           // Blocks and buffers given back
+    size_t heap_bytes;           // Bytes currently held from the heap
+    size_t arena_allocations;    // arena_alloc calls
+    size_t pool_hits;            // buffer_pool_acquire calls served from a free list
+    size_t pool_misses;          // buffer_pool_acquire calls that had to allocate
+} AllocCounters;
+
+void alloc_counters_get(AllocCounters* counters);
+
+#endif // ARENA_H
@@ -1,66 +1,335 @@
-#include <stdio.h>  // For printf
+#include <stdio.h>  // For snprintf
 #include <stdlib.h> // For malloc, free
 #include "data_loader.h"
 #include "cnpy.h"   // Include cnpy.h for cnpy_array, cnpy_load_npz, cnpy_free
+#include "unproject.h"
+#include "decimate.h"
+#include "arena.h"
+#include "trace.h"
+#include "mem_track.h"
+#include "log.h"
+#include <stb_image.h>
+#include <string.h>
 
 int load_splats_from_npz(const char* filename, Splat** splats) {
     // Load the npz file using the cnpy library
     cnpy_array result = cnpy_load_npz(filename, "arr_0");
 
     if (result.data == NULL) {
-        printf("Failed to load 'arr_0' data from %s\n", filename);
+        log_error("Failed to load 'arr_0' data from %s", filename);
         return 0;
     }
 
-    // Debug: Print the number of dimensions and the shape
-    printf("Number of dimensions: %zu\n", result.ndim);
-    printf("Array shape: ");
-    for (size_t i = 0; i < result.ndim; ++i) {
-        printf("%zu ", result.shape[i]);
+#if LOG_COMPILE_LEVEL <= 0
+    // Debug: the number of dimensions and the shape
+    char shape[128] = "";
+    for (size_t i = 0, used = 0; i < result.ndim && used < sizeof(shape); ++i) {
+        used += (size_t)snprintf(shape + used, sizeof(shape) - used, i ? " x %zu" : "%zu", result.shape[i]);
     }
-    printf("\n");
+    log_debug("Array of %zu dimensions, shape %s", result.ndim, shape);
+#endif
 
     // Calculate the number of splats by multiplying all dimensions
-    size_t num_splats = 1;
-    for (size_t i = 0; i < result.ndim; ++i) {
-        num_splats *= result.shape[i];
-    }
-    printf("Calculated number of splats: %zu\n", num_splats);
+    size_t num_splats = cnpy_num_elements(&result);
+    log_debug("Calculated number of splats: %zu", num_splats);
 
     // Ensure that the number of elements is greater than zero
     if (num_splats == 0) {
-        printf("Error: No splats found. Exiting.\n");
+        log_error("No splats found. Exiting.");
         cnpy_free(&result);
         return 0;
     }
 
     // Allocate memory for the splats
-    *splats = (Splat*)malloc(num_splats * sizeof(Splat));
+    *splats = (Splat*)mem_malloc(MEM_LOADER, num_splats * sizeof(Splat));
     if (*splats == NULL) {
-        printf("Error: Failed to allocate memory for splats.\n");
+        log_error("Failed to allocate memory for splats.");
+        cnpy_free(&result);
+        return 0;
+    }
+
+    // Treat the first axis as rows and everything after it as one row of samples
+    size_t height = result.ndim > 1 ? result.shape[0] : 1;
+    size_t width = num_splats / height;
+
+    // Elements are converted to float one row at a time inside the build loop,
+    // so the converted values stay in L1 instead of costing a full extra pass
+    float* row_values = (float*)mem_malloc(MEM_LOADER, width * sizeof(float));
+    if (row_values == NULL) {
+        log_error("Failed to allocate memory for depth row.");
+        mem_free(MEM_LOADER, *splats);
+        *splats = NULL;
         cnpy_free(&result);
         return 0;
     }
 
     // Populate the splats with position and color data
-    for (size_t i = 0; i < num_splats; i++) {
-        size_t row = i / result.shape[1];
-        size_t col = i % result.shape[1];
+    for (size_t row = 0; row < height; row++) {
+        depth_row_to_float(&result, row, width, row_values);
 
-        (*splats)[i].x = (float)col;              // X = column index
-        (*splats)[i].y = (float)row;              // Y = row index
-        (*splats)[i].z = ((float*)result.data)[i]; // Z = depth value (from arr_0.npy)
-        (*splats)[i].r = 1.0f;                    // Default color: white
-        (*splats)[i].g = 1.0f;
-        (*splats)[i].b = 1.0f;
-        (*splats)[i].scale = 1.0f;                // Default scale
-        (*splats)[i].a = 1.0f;                    // Default opacity
+        Splat* out = *splats + row * width;
+        for (size_t col = 0; col < width; col++) {
+            out[col].x = (float)col;              // X = column index
+            out[col].y = (float)row;              // Y = row index
+            out[col].z = row_values[col];         // Z = depth value (from arr_0.npy)
+            out[col].dx = 0.0f;
+            out[col].dy = 0.0f;
+            out[col].dz = 0.0f;
+            out[col].r = 1.0f;                    // Default color: white
+            out[col].g = 1.0f;
+            out[col].b = 1.0f;
+            out[col].scale = 1.0f;                // Default scale
+            out[col].a = 1.0f;                    // Default opacity
+        }
     }
 
-    printf("Loaded %zu splats successfully from %s.\n", num_splats, filename);
+    mem_free(MEM_LOADER, row_values);
+
+    log_info("Loaded %zu splats successfully from %s.", num_splats, filename);
 
     // Free the array data
     cnpy_free(&result);
 
     return num_splats;
 }
+
+// Reads arr_0 of an npz file into the scratch arena; the caller releases the arena after use
+static bool read_depth_npz(const char* filename, Arena* scratch, cnpy_array* result) {
+    cnpy_npz* npz = cnpy_npz_open(filename);
+    if (npz == NULL) {
+        return false;
+    }
+
+    memset(result, 0, sizeof(*result));
+    if (cnpy_npz_info(npz, "arr_0", result)) {
+        size_t size = cnpy_num_elements(result) * result->word_size;
+        void* buffer = arena_alloc(scratch, size ? size : 1, 64);
+        cnpy_free(result);
+        if (buffer && cnpy_npz_load_into(npz, "arr_0", buffer, size, result)) {
+            result->data = buffer;
+        }
+    }
+    cnpy_npz_close(npz);
+
+    if (result->data == NULL) {
+        log_error("Failed to load 'arr_0' data from %s", filename);
+        return false;
+    }
+    return true;
+}
+
+// Turns a depth map into splats; decimate == NULL keeps one splat per valid pixel
+static int depth_to_splats(const cnpy_array* depth, const UnprojectParams* params, const DecimateOptions* decimate,
+                           const char* filename, Splat** splats) {
+    // Without calibration, assume the renderer's own 90 degree vertical field of view
+    UnprojectParams default_params = {0};
+    if (params == NULL || params->intrinsics.fx <= 0.0f) {
+        if (params) default_params = *params;
+        size_t height = depth->ndim > 1 ? depth->shape[0] : 1;
+        size_t width = cnpy_num_elements(depth) / height;
+        default_params.intrinsics = camera_intrinsics_from_fov((int)width, (int)height, 90.0f);
+        params = &default_params;
+    }
+
+    int splat_count = decimate ? decimate_depth_to_splats(depth, params, decimate, splats)
+                               : unproject_depth_to_splats(depth, params, splats);
+    if (splat_count > 0) {
+        mem_adopt(MEM_LOADER, *splats);   // Allocated by unproject or decimate with plain malloc
+        log_info("Unprojected %zu depth samples from %s into %d splats.", cnpy_num_elements(depth), filename, splat_count);
+    }
+    return splat_count;
+}
+
+// Shared by the camera loaders
+static int load_depth_npz(const char* filename, const UnprojectParams* params, const DecimateOptions* decimate,
+                          Splat** splats) {
+    // The raw depth only lives until it is unprojected, so it goes into the scratch arena
+    Arena* scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    cnpy_array result;
+    if (!read_depth_npz(filename, scratch, &result)) {
+        arena_release(scratch, mark);
+        return 0;
+    }
+
+    int splat_count = depth_to_splats(&result, params, decimate, filename, splats);
+
+    result.data = NULL;  // Owned by the arena
+    cnpy_free(&result);
+    arena_release(scratch, mark);
+    return splat_count;
+}
+
+int load_splats_from_npz_with_camera(const char* filename, const UnprojectParams* params, Splat** splats) {
+    return load_depth_npz(filename, params, NULL, splats);
+}
+
+int load_splats_from_npz_decimated(const char* filename, const UnprojectParams* params,
+                                   const DecimateOptions* options, Splat** splats) {
+    static const DecimateOptions defaults = {0};
+    return load_depth_npz(filename, params, options ? options : &defaults, splats);
+}
+
+// Color frame as RGBA8, from the cache or decoded and stored
+static bool load_rgba_cached(DecodeCache* cache, const char* png_path, CachedData* rgba) {
+    if (cache && decode_cache_lookup(cache, png_path, DECODE_RGBA8, 0, rgba)) {
+        return true;
+    }
+
+    int width, height, channels;
+    unsigned char* image = stbi_load(png_path, &width, &height, &channels, 4);
+    if (!image) {
+        log_error("Failed to load PNG image: %s", png_path);
+        return false;
+    }
+    if (cache) {
+        decode_cache_store(cache, png_path, DECODE_RGBA8, 0, image, (size_t)width * height * 4, width, height);
+    }
+
+    // stbi memory is freed with stbi_image_free, so the pixels move to a plain heap buffer
+    memset(rgba, 0, sizeof(*rgba));
+    rgba->owned = mem_malloc(MEM_LOADER, (size_t)width * height * 4);
+    if (!rgba->owned) {
+        stbi_image_free(image);
+        return false;
+    }
+    memcpy(rgba->owned, image, (size_t)width * height * 4);
+    stbi_image_free(image);
+    rgba->data = rgba->owned;
+    rgba->size = (size_t)width * height * 4;
+    rgba->width = width;
+    rgba->height = height;
+    return true;
+}
+
+// Depth map as row-major float, from the cache or inflated, converted and stored
+static bool load_depth_cached(DecodeCache* cache, const char* npz_path, CachedData* depth) {
+    if (cache && decode_cache_lookup(cache, npz_path, DECODE_DEPTH_F32, 0, depth)) {
+        return true;
+    }
+
+    Arena* scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    cnpy_array raw;
+    if (!read_depth_npz(npz_path, scratch, &raw)) {
+        arena_release(scratch, mark);
+        return false;
+    }
+
+    size_t height = raw.ndim > 1 ? raw.shape[0] : 1;
+    size_t width = cnpy_num_elements(&raw) / height;
+    memset(depth, 0, sizeof(*depth));
+    depth->owned = mem_malloc(MEM_LOADER, (width * height > 0 ? width * height : 1) * sizeof(float));
+    if (depth->owned) {
+        float* values = (float*)depth->owned;
+        #pragma omp parallel for schedule(static)
+        for (long long row = 0; row < (long long)height; row++) {
+            depth_row_to_float(&raw, (size_t)row, width, values + (size_t)row * width);
+        }
+        depth->data = values;
+        depth->size = width * height * sizeof(float);
+        depth->width = (int)width;
+        depth->height = (int)height;
+        if (cache) {
+            decode_cache_store(cache, npz_path, DECODE_DEPTH_F32, 0, values, depth->size, depth->width, depth->height);
+        }
+    }
+
+    raw.data = NULL;  // Owned by the arena
+    cnpy_free(&raw);
+    arena_release(scratch, mark);
+    return depth->owned != NULL;
+}
+
+bool splat_cache_variant(DecodeCache* cache, const char* png_path, const DecimateOptions* options,
+                         uint64_t* variant) {
+    // Finished splats also depend on the color frame and the decimation settings
+    DecimateOptions decimate = {0};
+    if (options) decimate = *options;
+    *variant = decode_cache_hash(&decimate, sizeof(decimate), 1);
+    if (cache && png_path) {
+        uint64_t rgb_hash;
+        if (!decode_cache_source_hash(cache, png_path, &rgb_hash)) {
+            log_error("Failed to load PNG image: %s", png_path);
+            return false;
+        }
+        *variant = decode_cache_hash(&rgb_hash, sizeof(rgb_hash), *variant);
+    }
+    return true;
+}
+
+bool load_depth_frame_cached(DecodeCache* cache, const char* npz_path, const char* png_path, DepthFrame* frame) {
+    memset(frame, 0, sizeof(*frame));
+    trace_begin("load rgba");
+    bool ok = !png_path || load_rgba_cached(cache, png_path, &frame->rgba);
+    trace_end("load rgba");
+    if (!ok) {
+        return false;
+    }
+    trace_begin("load depth");
+    ok = load_depth_cached(cache, npz_path, &frame->depth);
+    trace_end("load depth");
+    if (!ok) {
+        cached_data_release(&frame->rgba);
+        return false;
+    }
+
+    frame->shape[0] = (size_t)frame->depth.height;
+    frame->shape[1] = (size_t)frame->depth.width;
+    frame->view.data = (void*)frame->depth.data;
+    frame->view.shape = frame->shape;
+    frame->view.ndim = 2;
+    frame->view.datatype = 'f';
+    frame->view.dtype = CNPY_DTYPE_F4;
+    frame->view.word_size = sizeof(float);
+
+    // Without calibration, assume the renderer's own 90 degree vertical field of view
+    frame->params.intrinsics = camera_intrinsics_from_fov(frame->depth.width, frame->depth.height, 90.0f);
+    frame->params.rgb = (const unsigned char*)frame->rgba.data;
+    frame->params.rgb_width = frame->rgba.width;
+    frame->params.rgb_height = frame->rgba.height;
+    frame->params.rgb_channels = 4;
+    return true;
+}
+
+void depth_frame_release(DepthFrame* frame) {
+    cached_data_release(&frame->depth);
+    cached_data_release(&frame->rgba);
+    memset(frame, 0, sizeof(*frame));
+}
+
+int load_splats_from_npz_cached(DecodeCache* cache, const char* npz_path, const char* png_path,
+                                const DecimateOptions* options, CachedData* splats) {
+    memset(splats, 0, sizeof(*splats));
+
+    uint64_t variant;
+    if (!splat_cache_variant(cache, png_path, options, &variant)) {
+        return 0;
+    }
+    if (cache && decode_cache_lookup(cache, npz_path, DECODE_SPLATS, variant, splats)) {
+        log_info("Mapped %zu cached splats for %s.", splats->size / sizeof(Splat), npz_path);
+        return (int)(splats->size / sizeof(Splat));
+    }
+
+    DepthFrame frame;
+    if (!load_depth_frame_cached(cache, npz_path, png_path, &frame)) {
+        return 0;
+    }
+
+    DecimateOptions decimate = {0};
+    if (options) decimate = *options;
+    Splat* built = NULL;
+    int splat_count = depth_to_splats(&frame.view, &frame.params, &decimate, npz_path, &built);
+    depth_frame_release(&frame);
+    if (splat_count == 0) {
+        return 0;
+    }
+
+    if (cache) {
+        decode_cache_store(cache, npz_path, DECODE_SPLATS, variant, built, (size_t)splat_count * sizeof(Splat), 0, 0);
+    }
+    splats->owned = built;
+    splats->data = built;
+    splats->size = (size_t)splat_count * sizeof(Splat);
+    return splat_count;
+}
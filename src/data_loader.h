@@ -3,6 +3,9 @@
 
 #include <stddef.h>  // for size_t
 #include "splat.h"   // Assuming you define Splat here
+#include "unproject.h"
+#include "decimate.h"
+#include "decode_cache.h"
 
 // Function to load a specific .npy file from a .npz (ZIP) archive
 void* load_npy_from_zip(const char* zip_filename, const char* target_filename, size_t* file_size);
@@ -10,7 +13,51 @@ void* load_npy_from_zip(const char* zip_filename, const char* target_filename, s
 // Function to read the .npy array from the loaded file
 void* load_npy_array(void* npy_data, size_t npy_size, size_t* array_size);
 
-// Function to load splats from an .npz file
+// Function to load splats from an .npz file.
+// Splats returned by the loaders below are counted as MEM_LOADER memory; release them with mem_free.
 int load_splats_from_npz(const char* filename, Splat** splats);
 
+// Function to load a depth map from an .npz file as world-space splats seen through a pinhole camera
+// (params == NULL or zero intrinsics assume a centered camera with the renderer's 90 degree vertical field of view)
+int load_splats_from_npz_with_camera(const char* filename, const UnprojectParams* params, Splat** splats);
+
+// Same as load_splats_from_npz_with_camera, merging flat, uniformly colored blocks into larger splats
+// (options == NULL uses the DecimateOptions defaults)
+int load_splats_from_npz_decimated(const char* filename, const UnprojectParams* params,
+                                   const DecimateOptions* options, Splat** splats);
+
+/**
+ * @brief Decimated depth-map loading through a decode cache.
+ *
+ * The finished splats are looked up first, keyed by the depth file, the color
+ * file and the decimation options. On a miss the color frame (as RGBA8) and the
+ * depth map (as float) are each taken from the cache or decoded, and every
+ * decoded result is stored for the next run.
+ *
+ * @param cache Decode cache, or NULL to always decode.
+ * @param png_path Color frame, or NULL for white splats.
+ * @param splats Receives the splats, mapped from the cache or on the heap; release with cached_data_release.
+ * @return Number of splats, 0 on failure.
+ */
+int load_splats_from_npz_cached(DecodeCache* cache, const char* npz_path, const char* png_path,
+                                const DecimateOptions* options, CachedData* splats);
+
+// A depth map and its color frame, ready to unproject
+typedef struct {
+    CachedData depth;        // Row-major float, depth.width x depth.height
+    CachedData rgba;         // RGBA8, empty without a color frame
+    cnpy_array view;         // The depth as an array for the unproject and decimate functions (points into shape)
+    size_t shape[2];
+    UnprojectParams params;  // 90 degree vertical field of view, with the color frame attached
+} DepthFrame;
+
+// Loads a depth map (as float) and color frame (as RGBA8), each from the cache or decoded and stored.
+// png_path may be NULL. The frame refers to itself, so it must not be copied.
+bool load_depth_frame_cached(DecodeCache* cache, const char* npz_path, const char* png_path, DepthFrame* frame);
+void depth_frame_release(DepthFrame* frame);
+
+// Cache variant of the splats decimated from a depth file with the given color frame and options
+bool splat_cache_variant(DecodeCache* cache, const char* png_path, const DecimateOptions* options,
+                         uint64_t* variant);
+
 #endif // DATA_LOADER_H
@@ -0,0 +1,297 @@
+// File: src/dataset.c
+#include "dataset.h"
+#include "image_loader.h"
+#include "platform.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+static bool file_exists(const char* path) {
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode);
+#endif
+}
+
+bool dataset_open(Dataset* dataset, const char* root) {
+    dataset->entries = NULL;
+    dataset->count = 0;
+
+    char* depth_dir = platform_join_path(root, "depth");
+    char* rgb_dir = platform_join_path(root, "rgb");
+    if (!depth_dir || !rgb_dir) {
+        free(depth_dir);
+        free(rgb_dir);
+        return false;
+    }
+
+    size_t count = 0;
+    char** names = platform_list_dir(depth_dir, ".npz", &count);
+    if (!names) {
+        free(depth_dir);
+        free(rgb_dir);
+        return false;
+    }
+
+    dataset->entries = (DatasetEntry*)calloc(count ? count : 1, sizeof(DatasetEntry));
+    if (!dataset->entries) {
+        log_error("Failed to allocate memory for dataset entries.");
+        platform_free_list(names, count);
+        free(depth_dir);
+        free(rgb_dir);
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < count; i++) {
+        // Counted before it is filled, so dataset_free releases a partly built entry
+        DatasetEntry* entry = &dataset->entries[dataset->count++];
+        size_t stem_len = strlen(names[i]) - 4;  // Strip ".npz"
+
+        entry->name = (char*)malloc(stem_len + 5);
+        if (!entry->name) {
+            ok = false;
+            break;
+        }
+        memcpy(entry->name, names[i], stem_len);
+        strcpy(entry->name + stem_len, ".png");
+
+        entry->depth_path = platform_join_path(depth_dir, names[i]);
+        entry->rgb_path = platform_join_path(rgb_dir, entry->name);
+        entry->name[stem_len] = '\0';
+        ok = entry->depth_path && entry->rgb_path;
+
+        if (ok && !file_exists(entry->rgb_path)) {
+            free(entry->rgb_path);
+            entry->rgb_path = NULL;
+        }
+    }
+
+    platform_free_list(names, count);
+    free(depth_dir);
+    free(rgb_dir);
+    if (!ok) {
+        log_error("Failed to allocate memory for dataset entries.");
+        dataset_free(dataset);
+    }
+    return ok;
+}
+
+void dataset_free(Dataset* dataset) {
+    for (size_t i = 0; i < dataset->count; i++) {
+        free(dataset->entries[i].name);
+        free(dataset->entries[i].depth_path);
+        free(dataset->entries[i].rgb_path);
+    }
+    free(dataset->entries);
+    dataset->entries = NULL;
+    dataset->count = 0;
+}
+
+// Window slot for a frame between decode and delivery
+typedef struct {
+    DatasetFrame frame;
+    bool ready;
+} FrameSlot;
+
+struct DatasetLoader {
+    const Dataset* dataset;
+    DatasetLoaderOptions options;
+
+    PlatformThread* threads;
+    int thread_count;
+
+    PlatformMutex mutex;
+    PlatformCond changed;       // Signalled whenever any of the state below moves
+
+    FrameSlot* window;          // Ring of max_frames_in_flight slots, indexed by sequence number
+    size_t end;                 // One past the last frame to decode
+    size_t next_to_claim;       // Next frame a worker will start decoding
+    size_t next_to_deliver;     // Next frame the consumer will receive
+    size_t bytes_in_flight;     // Decoded bytes not yet released by the consumer
+    bool stopping;
+};
+
+static void decode_frame(const DatasetLoader* loader, size_t index, DatasetFrame* frame) {
+    const DatasetEntry* entry = &loader->dataset->entries[index];
+
+    memset(frame, 0, sizeof(*frame));
+    frame->index = index;
+    frame->entry = entry;
+
+    frame->depth = cnpy_load_npz(entry->depth_path, "arr_0");
+    if (frame->depth.data) {
+        frame->bytes += cnpy_num_elements(&frame->depth) * frame->depth.word_size;
+    }
+
+    if (loader->options.load_rgb && entry->rgb_path) {
+        frame->rgb = load_png_image(entry->rgb_path, &frame->rgb_width, &frame->rgb_height, &frame->rgb_channels);
+        if (frame->rgb) {
+            frame->bytes += (size_t)frame->rgb_width * frame->rgb_height * frame->rgb_channels;
+        }
+    }
+}
+
+// A worker may start a frame when it fits the window and the memory budget.
+// The frame the consumer is waiting on is always allowed, so progress is guaranteed.
+static bool can_claim(const DatasetLoader* loader) {
+    if (loader->next_to_claim >= loader->end) return false;
+    if (loader->next_to_claim == loader->next_to_deliver) return true;
+    if (loader->next_to_claim >= loader->next_to_deliver + loader->options.max_frames_in_flight) return false;
+    return loader->options.max_bytes_in_flight == 0 ||
+           loader->bytes_in_flight < loader->options.max_bytes_in_flight;
+}
+
+static void worker_main(void* arg) {
+    DatasetLoader* loader = (DatasetLoader*)arg;
+
+    platform_mutex_lock(&loader->mutex);
+    for (;;) {
+        while (!loader->stopping && !can_claim(loader)) {
+            if (loader->next_to_claim >= loader->end) break;
+            platform_cond_wait(&loader->changed, &loader->mutex);
+        }
+        if (loader->stopping || loader->next_to_claim >= loader->end) break;
+
+        size_t index = loader->next_to_claim++;
+        platform_mutex_unlock(&loader->mutex);
+
+        DatasetFrame frame;
+        decode_frame(loader, index, &frame);
+
+        platform_mutex_lock(&loader->mutex);
+        FrameSlot* slot = &loader->window[index % loader->options.max_frames_in_flight];
+        slot->frame = frame;
+        slot->ready = true;
+        loader->bytes_in_flight += frame.bytes;
+        platform_cond_broadcast(&loader->changed);
+    }
+    platform_mutex_unlock(&loader->mutex);
+}
+
+DatasetLoader* dataset_loader_start(const Dataset* dataset, const DatasetLoaderOptions* options) {
+    DatasetLoader* loader = (DatasetLoader*)calloc(1, sizeof(DatasetLoader));
+    if (!loader) return NULL;
+
+    loader->dataset = dataset;
+    if (options) {
+        loader->options = *options;
+    } else {
+        loader->options.load_rgb = true;
+    }
+
+    if (loader->options.thread_count <= 0) {
+        loader->options.thread_count = platform_cpu_count();
+    }
+    if (loader->options.max_frames_in_flight == 0) {
+        loader->options.max_frames_in_flight = (size_t)loader->options.thread_count * 2;
+    }
+
+    size_t first = loader->options.first < dataset->count ? loader->options.first : dataset->count;
+    size_t available = dataset->count - first;
+    size_t count = (loader->options.count == 0 || loader->options.count > available) ? available : loader->options.count;
+    loader->next_to_claim = first;
+    loader->next_to_deliver = first;
+    loader->end = first + count;
+
+    loader->window = (FrameSlot*)calloc(loader->options.max_frames_in_flight, sizeof(FrameSlot));
+    loader->threads = (PlatformThread*)calloc((size_t)loader->options.thread_count, sizeof(PlatformThread));
+    if (!loader->window || !loader->threads) {
+        log_error("Failed to allocate memory for dataset loader.");
+        free(loader->window);
+        free(loader->threads);
+        free(loader);
+        return NULL;
+    }
+
+    platform_mutex_init(&loader->mutex);
+    platform_cond_init(&loader->changed);
+
+    for (int i = 0; i < loader->options.thread_count; i++) {
+        if (!platform_thread_create(&loader->threads[loader->thread_count], worker_main, loader)) {
+            log_error("Failed to start dataset loader thread %d.", i);
+            break;
+        }
+        loader->thread_count++;
+    }
+
+    if (loader->thread_count == 0) {
+        dataset_loader_stop(loader);
+        return NULL;
+    }
+    return loader;
+}
+
+bool dataset_loader_next(DatasetLoader* loader, DatasetFrame* frame) {
+    platform_mutex_lock(&loader->mutex);
+
+    if (loader->next_to_deliver >= loader->end) {
+        platform_mutex_unlock(&loader->mutex);
+        return false;
+    }
+
+    FrameSlot* slot = &loader->window[loader->next_to_deliver % loader->options.max_frames_in_flight];
+    while (!slot->ready) {
+        platform_cond_wait(&loader->changed, &loader->mutex);
+    }
+
+    *frame = slot->frame;
+    slot->ready = false;
+    loader->next_to_deliver++;
+    platform_cond_broadcast(&loader->changed);
+
+    platform_mutex_unlock(&loader->mutex);
+    return true;
+}
+
+static void free_frame(DatasetFrame* frame) {
+    cnpy_free(&frame->depth);
+    if (frame->rgb) {
+        free_png_image(frame->rgb);
+        frame->rgb = NULL;
+    }
+}
+
+void dataset_loader_release(DatasetLoader* loader, DatasetFrame* frame) {
+    size_t bytes = frame->bytes;
+    free_frame(frame);
+    frame->bytes = 0;
+
+    platform_mutex_lock(&loader->mutex);
+    loader->bytes_in_flight -= bytes;
+    platform_cond_broadcast(&loader->changed);
+    platform_mutex_unlock(&loader->mutex);
+}
+
+void dataset_loader_stop(DatasetLoader* loader) {
+    if (!loader) return;
+
+    platform_mutex_lock(&loader->mutex);
+    loader->stopping = true;
+    platform_cond_broadcast(&loader->changed);
+    platform_mutex_unlock(&loader->mutex);
+
+    for (int i = 0; i < loader->thread_count; i++) {
+        platform_thread_join(loader->threads[i]);
+    }
+
+    for (size_t i = 0; i < loader->options.max_frames_in_flight; i++) {
+        if (loader->window[i].ready) {
+            free_frame(&loader->window[i].frame);
+        }
+    }
+
+    platform_cond_destroy(&loader->changed);
+    platform_mutex_destroy(&loader->mutex);
+    free(loader->window);
+    free(loader->threads);
+    free(loader);
+}
@@ -0,0 +1,79 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cnpy.h"
+
+// One frame of a sequence: depth/<name>.npz plus the matching rgb/<name>.png
+typedef struct {
+    char* name;        // Shared file stem, e.g. "midsize_muscle_02-000"
+    char* depth_path;
+    char* rgb_path;    // NULL when the frame has no RGB image
+} DatasetEntry;
+
+// Frames of a dataset directory such as ".../train", in sequence order
+typedef struct {
+    DatasetEntry* entries;
+    size_t count;
+} Dataset;
+
+/**
+ * @brief Enumerates the .npz files in root/depth and pairs each file with root/rgb/<stem>.png.
+ *
+ * @param dataset Dataset to fill.
+ * @param root Directory containing the depth and rgb subdirectories.
+ * @return true if the depth directory could be listed.
+ */
+bool dataset_open(Dataset* dataset, const char* root);
+void dataset_free(Dataset* dataset);
+
+// A decoded frame handed out by the loader, owned by the caller until released
+typedef struct {
+    size_t index;               // Position in the dataset
+    const DatasetEntry* entry;
+    cnpy_array depth;           // depth.data is NULL if the npz failed to load
+    unsigned char* rgb;         // NULL if there is no image or it failed to load
+    int rgb_width, rgb_height, rgb_channels;
+    size_t bytes;               // Decoded size counted against the memory budget
+} DatasetFrame;
+
+typedef struct {
+    int thread_count;            // Decoder threads, 0 = one per CPU
+    size_t max_frames_in_flight; // Decoded frames allowed ahead of the consumer, 0 = 2 per thread
+    size_t max_bytes_in_flight;  // Soft limit on decoded bytes not yet released, 0 = unlimited
+    size_t first;                // First frame to decode
+    size_t count;                // Number of frames, 0 = through the end of the dataset
+    bool load_rgb;               // Decode the PNG alongside the depth map
+} DatasetLoaderOptions;
+
+typedef struct DatasetLoader DatasetLoader;
+
+/**
+ * @brief Starts decoding frames on a bounded pool of worker threads.
+ *
+ * Workers decode ahead of the consumer, up to max_frames_in_flight frames and
+ * max_bytes_in_flight bytes. The frame the consumer is waiting for is always
+ * allowed to start, so the budget can never deadlock the sequence.
+ *
+ * @param dataset Dataset to decode; must outlive the loader.
+ * @param options Loader settings, or NULL for defaults.
+ * @return Loader handle, or NULL on failure.
+ */
+DatasetLoader* dataset_loader_start(const Dataset* dataset, const DatasetLoaderOptions* options);
+
+/**
+ * @brief Waits for the next frame in sequence order.
+ *
+ * @return false once every requested frame has been delivered.
+ */
+bool dataset_loader_next(DatasetLoader* loader, DatasetFrame* frame);
+
+// Frees a delivered frame and returns its bytes to the memory budget
+void dataset_loader_release(DatasetLoader* loader, DatasetFrame* frame);
+
+// Stops the workers, discarding frames that were not delivered.
+// Frames already handed out must be released before the loader is stopped.
+void dataset_loader_stop(DatasetLoader* loader);
+
+#endif // DATASET_H
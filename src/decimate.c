@@ -0,0 +1,242 @@
+// File: src/decimate.c
+#include "decimate.h"
+#include "arena.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>        // For OpenMP parallelization
+
+#define DECIMATE_DEFAULT_BLOCK 16
+#define DECIMATE_DEFAULT_PLANE_TOLERANCE 0.01f
+#define DECIMATE_DEFAULT_COLOR_TOLERANCE 0.05f
+
+typedef struct {
+    const float* depth;        // Raw depth, width * height
+    const float* rgba;         // 4 floats per pixel, NULL without a color frame
+    int width, height;         // Size of the rows being decimated
+    int first_row;             // Image row of the first of them
+    const UnprojectParams* params;
+    float footprint;           // Splat scale per unit of raw depth for a single pixel
+    float plane_tolerance;
+    float color_tolerance;
+} DecimateContext;
+
+static const float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+static inline bool valid_depth(float depth) {
+    return depth > 0.0f && depth < INFINITY;  // Also false for NaN
+}
+
+static void emit_splat(const DecimateContext* ctx, float u, float v, float depth, int size,
+                       const float color[4], Splat* out) {
+    float position[3];
+    unproject_pixel(ctx->params, u, v + ctx->first_row, depth, position);
+    out->x = position[0];
+    out->y = position[1];
+    out->z = position[2];
+    out->dx = 0.0f;
+    out->dy = 0.0f;
+    out->dz = 0.0f;
+    out->r = color[0];
+    out->g = color[1];
+    out->b = color[2];
+    out->a = color[3];
+    out->scale = ctx->footprint * depth * size;
+}
+
+// Fits inverse depth w = mean + gu * du + gv * dv around the block center. On a full square
+// grid the centered coordinates are orthogonal, so the least-squares fit needs no solve.
+static bool block_is_flat(const DecimateContext* ctx, int x0, int y0, int size,
+                          float* center_depth, float color[4]) {
+    float center = (size - 1) * 0.5f;
+    float sum_w = 0.0f, sum_uw = 0.0f, sum_vw = 0.0f;
+    float sum_color[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    for (int y = y0; y < y0 + size; y++) {
+        const float* depth = ctx->depth + (size_t)y * ctx->width;
+        for (int x = x0; x < x0 + size; x++) {
+            if (!valid_depth(depth[x])) return false;
+            float w = 1.0f / depth[x];
+            sum_w += w;
+            sum_uw += (x - x0 - center) * w;
+            sum_vw += (y - y0 - center) * w;
+            if (ctx->rgba) {
+                const float* c = ctx->rgba + ((size_t)y * ctx->width + x) * 4;
+                for (int ch = 0; ch < 4; ch++) sum_color[ch] += c[ch];
+            }
+        }
+    }
+
+    float n = (float)(size * size);
+    float sum_sq = size * (size * (float)(size * size - 1) / 12.0f);  // Sum of du^2 over the block
+    float mean_w = sum_w / n;
+    float gu = sum_uw / sum_sq;
+    float gv = sum_vw / sum_sq;
+    for (int ch = 0; ch < 4; ch++) color[ch] = ctx->rgba ? sum_color[ch] / n : 1.0f;
+
+    for (int y = y0; y < y0 + size; y++) {
+        const float* depth = ctx->depth + (size_t)y * ctx->width;
+        for (int x = x0; x < x0 + size; x++) {
+            // w_fit * depth - 1 is the relative depth error to first order
+            float fitted = mean_w + gu * (x - x0 - center) + gv * (y - y0 - center);
+            if (!(fitted > 0.0f) || fabsf(fitted * depth[x] - 1.0f) > ctx->plane_tolerance) return false;
+            if (ctx->rgba) {
+                const float* c = ctx->rgba + ((size_t)y * ctx->width + x) * 4;
+                for (int ch = 0; ch < 4; ch++) {
+                    if (fabsf(c[ch] - color[ch]) > ctx->color_tolerance) return false;
+                }
+            }
+        }
+    }
+
+    *center_depth = 1.0f / mean_w;
+    return true;
+}
+
+static int decimate_block(const DecimateContext* ctx, int x0, int y0, int size, Splat* out) {
+    if (x0 >= ctx->width || y0 >= ctx->height) return 0;
+
+    if (size == 1) {
+        size_t index = (size_t)y0 * ctx->width + x0;
+        float depth = ctx->depth[index];
+        if (!valid_depth(depth)) return 0;
+        emit_splat(ctx, (float)x0, (float)y0, depth, 1, ctx->rgba ? ctx->rgba + index * 4 : white, out);
+        return 1;
+    }
+
+    // Blocks cut off by the image border are always split
+    float depth, color[4];
+    if (x0 + size <= ctx->width && y0 + size <= ctx->height && block_is_flat(ctx, x0, y0, size, &depth, color)) {
+        float center = (size - 1) * 0.5f;
+        emit_splat(ctx, x0 + center, y0 + center, depth, size, color, out);
+        return 1;
+    }
+
+    int half = size / 2;
+    int written = decimate_block(ctx, x0, y0, half, out);
+    written += decimate_block(ctx, x0 + half, y0, half, out + written);
+    written += decimate_block(ctx, x0, y0 + half, half, out + written);
+    written += decimate_block(ctx, x0 + half, y0 + half, half, out + written);
+    return written;
+}
+
+// Decimates image rows [first_row, first_row + row_count) into out, which has room for one splat per pixel
+static size_t decimate_rows(const cnpy_array* depth, const UnprojectParams* params, const DecimateOptions* options,
+                            int first_row, int row_count, Splat* out) {
+    size_t num_pixels = cnpy_num_elements(depth);
+    int height = depth->ndim > 1 ? (int)depth->shape[0] : 1;
+    int width = height ? (int)(num_pixels / height) : 0;
+    size_t strip_pixels = (size_t)row_count * width;
+
+    int max_block = options && options->max_block > 0 ? options->max_block : DECIMATE_DEFAULT_BLOCK;
+    int block = 1;
+    while (block * 2 <= max_block) block *= 2;
+
+    DecimateContext ctx;
+    ctx.width = width;
+    ctx.height = row_count;
+    ctx.first_row = first_row;
+    ctx.params = params;
+    ctx.footprint = 0.5f * (1.0f / params->intrinsics.fx + 1.0f / params->intrinsics.fy) *
+                    (params->depth_scale > 0.0f ? params->depth_scale : 1.0f);
+    ctx.plane_tolerance = options && options->plane_tolerance > 0.0f
+                              ? options->plane_tolerance : DECIMATE_DEFAULT_PLANE_TOLERANCE;
+    ctx.color_tolerance = options && options->color_tolerance > 0.0f
+                              ? options->color_tolerance : DECIMATE_DEFAULT_COLOR_TOLERANCE;
+
+    // The float grids and band counts are load-scoped scratch
+    Arena* scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    float* depth_grid = (float*)arena_alloc(scratch, strip_pixels * sizeof(float), 64);
+    float* rgba_grid = params->rgb ? (float*)arena_alloc(scratch, strip_pixels * 4 * sizeof(float), 64) : NULL;
+    int band_count = (row_count + block - 1) / block;
+    int* band_counts = (int*)arena_alloc(scratch, (size_t)band_count * sizeof(int), 64);
+    if (!depth_grid || (params->rgb && !rgba_grid) || !band_counts) {
+        log_error("Failed to allocate memory for depth decimation.");
+        arena_release(scratch, mark);
+        return 0;
+    }
+
+    // Blocks read across rows, so depth and colors are expanded to float grids first.
+    // The first row of the colors doubles as the check that the color frame is usable.
+    bool has_color = rgba_grid && unproject_sample_colors(params, first_row, width, height, rgba_grid);
+
+    #pragma omp parallel for schedule(static)
+    for (int row = 0; row < row_count; row++) {
+        depth_row_to_float(depth, (size_t)(first_row + row), (size_t)width, depth_grid + (size_t)row * width);
+        if (has_color && row > 0) {
+            unproject_sample_colors(params, first_row + row, width, height, rgba_grid + (size_t)row * width * 4);
+        }
+    }
+
+    ctx.depth = depth_grid;
+    ctx.rgba = has_color ? rgba_grid : NULL;
+
+    // Each band of blocks writes at the start of its own pixel range, like unproject_depth_to_splats
+    #pragma omp parallel for schedule(dynamic)
+    for (int band = 0; band < band_count; band++) {
+        int y0 = band * block;
+        Splat* band_out = out + (size_t)y0 * width;
+        int written = 0;
+        for (int x0 = 0; x0 < width; x0 += block) {
+            written += decimate_block(&ctx, x0, y0, block, band_out + written);
+        }
+        band_counts[band] = written;
+    }
+
+    size_t total = 0;
+    for (int band = 0; band < band_count; band++) {
+        size_t start = (size_t)band * block * width;
+        if (total != start && band_counts[band] > 0) {
+            memmove(out + total, out + start, (size_t)band_counts[band] * sizeof(Splat));
+        }
+        total += (size_t)band_counts[band];
+    }
+
+    arena_release(scratch, mark);
+    return total;
+}
+
+int decimate_depth_to_splats(const cnpy_array* depth, const UnprojectParams* params,
+                             const DecimateOptions* options, Splat** splats) {
+    size_t num_pixels = cnpy_num_elements(depth);
+    int height = depth->ndim > 1 ? (int)depth->shape[0] : 1;
+    *splats = NULL;
+
+    if (num_pixels == 0 || depth->data == NULL) {
+        log_error("Depth map is empty.");
+        return 0;
+    }
+
+    *splats = (Splat*)malloc(num_pixels * sizeof(Splat));
+    if (!*splats) {
+        log_error("Failed to allocate memory for depth decimation.");
+        return 0;
+    }
+
+    size_t total = decimate_rows(depth, params, options, 0, height, *splats);
+    if (total == 0) {
+        log_error("Depth map has no valid samples.");
+        free(*splats);
+        *splats = NULL;
+        return 0;
+    }
+
+    // Give back the space of the merged pixels
+    Splat* shrunk = (Splat*)realloc(*splats, total * sizeof(Splat));
+    if (shrunk) *splats = shrunk;
+
+    return (int)total;
+}
+
+int decimate_depth_rows(const cnpy_array* depth, const UnprojectParams* params, const DecimateOptions* options,
+                        int first_row, int row_count, Splat* out) {
+    int height = depth->ndim > 1 ? (int)depth->shape[0] : 1;
+    if (depth->data == NULL || cnpy_num_elements(depth) == 0 || first_row < 0 || row_count <= 0 ||
+        first_row + row_count > height) {
+        return 0;
+    }
+    return (int)decimate_rows(depth, params, options, first_row, row_count, out);
+}
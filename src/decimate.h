@@ -0,0 +1,51 @@
+#ifndef DECIMATE_H
+#define DECIMATE_H
+
+#include <stdbool.h>
+#include "splat.h"
+#include "cnpy.h"
+#include "unproject.h"
+
+typedef struct {
+    int max_block;           // Largest block edge in pixels, a power of two (0 = 16)
+    float plane_tolerance;   // Largest depth deviation from the block's plane, relative to depth (0 = 0.01)
+    float color_tolerance;   // Largest per-channel deviation from the block's mean color in [0, 1] (0 = 0.05)
+} DecimateOptions;
+
+/**
+ * @brief Unprojects a depth map into variable-size splats using a quadtree.
+ *
+ * The image is tiled with max_block x max_block blocks. A block collapses
+ * into one splat, scaled to cover it, when all of its depths are valid, they
+ * lie on a plane within plane_tolerance, and its colors are uniform within
+ * color_tolerance. Otherwise it is split into four quadrants down to single
+ * pixels. Pixels with invalid depth (0, negative, NaN or infinite) are dropped.
+ *
+ * Planarity is tested on inverse depth, which is exactly affine in image
+ * coordinates for a plane seen through a pinhole camera.
+ *
+ * @param depth Depth array of shape (H, W) or (H, W, 1).
+ * @param params Camera intrinsics, pose, depth scale and optional color frame.
+ * @param options Decimation settings, or NULL for defaults.
+ * @param splats Receives a malloc'd array of splats.
+ * @return Number of splats, 0 on failure.
+ */
+int decimate_depth_to_splats(const cnpy_array* depth, const UnprojectParams* params,
+                             const DecimateOptions* options, Splat** splats);
+
+/**
+ * @brief Decimates a horizontal strip of a depth map, for loading it piece by piece.
+ *
+ * Blocks are tiled from first_row, so when first_row and row_count are
+ * multiples of the block edge the strips of an image together give the same
+ * splats as decimate_depth_to_splats.
+ *
+ * @param first_row First image row of the strip.
+ * @param row_count Number of rows in the strip.
+ * @param out Destination with room for row_count * width splats.
+ * @return Number of splats written.
+ */
+int decimate_depth_rows(const cnpy_array* depth, const UnprojectParams* params, const DecimateOptions* options,
+                        int first_row, int row_count, Splat* out);
+
+#endif // DECIMATE_H
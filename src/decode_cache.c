@@ -0,0 +1,328 @@
+// File: src/decode_cache.c
+#include "decode_cache.h"
+#include "mem_track.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_ENTRY_MAGIC "SPLATDEC"
+#define CACHE_KEY_MAGIC "SPLATKEY"
+#define CACHE_VERSION 1
+
+// Start of every entry file; the payload follows at a 64-byte offset
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t kind;
+    uint64_t content_hash;
+    uint64_t variant;
+    uint64_t payload_size;
+    int32_t width, height;
+    uint8_t reserved[16];
+} CacheEntryHeader;
+
+_Static_assert(sizeof(CacheEntryHeader) == 64, "entry payloads start 64-byte aligned");
+
+// Identity of a source file when its content hash was taken, followed by the path
+typedef struct {
+    char magic[8];
+    uint64_t size;
+    uint64_t modified;
+    uint64_t content_hash;
+    uint32_t path_length;
+    uint32_t reserved;
+} CacheKeyRecord;
+
+struct DecodeCache {
+    char* dir;
+    size_t max_bytes;
+    DecodeCacheStats stats;
+};
+
+typedef struct {
+    char* path;
+    unsigned long long size;
+    unsigned long long modified;
+} CacheFile;
+
+static inline uint64_t rotate_left(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t decode_cache_hash(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed ^ (size * 0x9e3779b97f4a7c15ull);
+
+    // Eight bytes per step, then a final avalanche
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash ^= rotate_left(word * 0x87c37b91114253d5ull, 31) * 0x4cf5ad432745937full;
+        hash = rotate_left(hash, 27) * 5 + 0x52dce729;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes, size);
+    hash ^= rotate_left(tail * 0x87c37b91114253d5ull, 31) * 0x4cf5ad432745937full;
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+void cached_data_release(CachedData* cached) {
+    platform_unmap_file(&cached->map);
+    mem_free(MEM_LOADER, cached->owned);
+    memset(cached, 0, sizeof(*cached));
+}
+
+DecodeCache* decode_cache_open(const char* dir, size_t max_bytes) {
+    if (!platform_make_dir(dir)) {
+        log_error("Unable to create cache directory %s", dir);
+        return NULL;
+    }
+
+    DecodeCache* cache = (DecodeCache*)calloc(1, sizeof(DecodeCache));
+    size_t length = strlen(dir);
+    char* copy = (char*)malloc(length + 1);
+    if (!cache || !copy) {
+        free(cache);
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy, dir, length + 1);
+    cache->dir = copy;
+    cache->max_bytes = max_bytes ? max_bytes : DECODE_CACHE_DEFAULT_BYTES;
+    return cache;
+}
+
+void decode_cache_close(DecodeCache* cache) {
+    if (!cache) return;
+    free(cache->dir);
+    free(cache);
+}
+
+void decode_cache_get_stats(const DecodeCache* cache, DecodeCacheStats* stats) {
+    *stats = cache->stats;
+}
+
+static char* cache_path(const DecodeCache* cache, const char* name) {
+    return platform_join_path(cache->dir, name);
+}
+
+// Writes a file under a temporary name and renames it into place, so readers never see a partial file
+static bool write_file(const char* path, const void* head, size_t head_size, const void* body, size_t body_size) {
+    size_t length = strlen(path);
+    char* temporary = (char*)malloc(length + 5);
+    if (!temporary) return false;
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+
+    FILE* file = fopen(temporary, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        ok = fwrite(head, 1, head_size, file) == head_size &&
+             (body_size == 0 || fwrite(body, 1, body_size, file) == body_size);
+        if (fclose(file) != 0) ok = false;
+    }
+    ok = ok && platform_replace_file(temporary, path);
+    if (!ok) remove(temporary);
+    free(temporary);
+    return ok;
+}
+
+static bool read_key(const char* key_path, const char* source, unsigned long long size, unsigned long long modified,
+                     uint64_t* hash) {
+    FILE* file = fopen(key_path, "rb");
+    if (!file) return false;
+
+    CacheKeyRecord record;
+    size_t path_length = strlen(source);
+    bool ok = fread(&record, sizeof(record), 1, file) == 1 &&
+              memcmp(record.magic, CACHE_KEY_MAGIC, sizeof(record.magic)) == 0 &&
+              record.size == size && record.modified == modified && record.path_length == path_length;
+
+    // The key file name is a hash of the path, so the stored path settles collisions
+    char buffer[512];
+    for (size_t done = 0; ok && done < path_length; ) {
+        size_t part = path_length - done < sizeof(buffer) ? path_length - done : sizeof(buffer);
+        ok = fread(buffer, 1, part, file) == part && memcmp(buffer, source + done, part) == 0;
+        done += part;
+    }
+    fclose(file);
+
+    if (ok) *hash = record.content_hash;
+    return ok;
+}
+
+bool decode_cache_source_hash(DecodeCache* cache, const char* source, uint64_t* hash) {
+    unsigned long long size, modified;
+    if (!platform_file_info(source, &size, &modified)) return false;
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.key", (unsigned long long)decode_cache_hash(source, strlen(source), 0));
+    char* key_path = cache_path(cache, name);
+    if (!key_path) return false;
+
+    if (read_key(key_path, source, size, modified, hash)) {
+        free(key_path);
+        return true;
+    }
+
+    // New or changed source: hash its content once and remember it with the identity
+    PlatformFileMap map;
+    if (size == 0) {
+        *hash = decode_cache_hash("", 0, 0);
+    } else if (platform_map_file(source, &map)) {
+        *hash = decode_cache_hash(map.data, map.size, 0);
+        cache->stats.hashed_bytes += map.size;
+        platform_unmap_file(&map);
+    } else {
+        free(key_path);
+        return false;
+    }
+
+    CacheKeyRecord record;
+    memset(&record, 0, sizeof(record));
+    memcpy(record.magic, CACHE_KEY_MAGIC, sizeof(record.magic));
+    record.size = size;
+    record.modified = modified;
+    record.content_hash = *hash;
+    record.path_length = (uint32_t)strlen(source);
+    write_file(key_path, &record, sizeof(record), source, record.path_length);
+    free(key_path);
+    return true;
+}
+
+static char* entry_path(const DecodeCache* cache, uint64_t content_hash, DecodeKind kind, uint64_t variant) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx-%d-%016llx.bin", (unsigned long long)content_hash, (int)kind,
+             (unsigned long long)variant);
+    return cache_path(cache, name);
+}
+
+// Image kinds are read as width x height elements, so the header must describe exactly the payload
+static bool payload_matches_dimensions(const CacheEntryHeader* header) {
+    size_t element_size;
+    switch ((DecodeKind)header->kind) {
+        case DECODE_DEPTH_F32: element_size = sizeof(float); break;
+        case DECODE_RGBA8: element_size = 4; break;
+        default: return true;
+    }
+    if (header->width <= 0 || header->height <= 0) return false;
+    uint64_t pixels = (uint64_t)header->width * (uint64_t)header->height;
+    return header->payload_size / element_size == pixels && header->payload_size % element_size == 0;
+}
+
+bool decode_cache_lookup(DecodeCache* cache, const char* source, DecodeKind kind, uint64_t variant, CachedData* out) {
+    memset(out, 0, sizeof(*out));
+
+    uint64_t content_hash;
+    char* path = decode_cache_source_hash(cache, source, &content_hash) ? entry_path(cache, content_hash, kind, variant) : NULL;
+    unsigned long long size, modified;
+    if (!path || !platform_file_info(path, &size, &modified) || size < sizeof(CacheEntryHeader) ||
+        !platform_map_file(path, &out->map)) {
+        cache->stats.misses++;
+        free(path);
+        return false;
+    }
+
+    const CacheEntryHeader* header = (const CacheEntryHeader*)out->map.data;
+    bool valid = memcmp(header->magic, CACHE_ENTRY_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == CACHE_VERSION && header->kind == (uint32_t)kind &&
+                 header->content_hash == content_hash && header->variant == variant &&
+                 header->payload_size <= out->map.size - sizeof(CacheEntryHeader) &&
+                 payload_matches_dimensions(header);
+    if (!valid) {
+        log_warn("Ignoring corrupt cache entry %s", path);
+        cached_data_release(out);
+        cache->stats.misses++;
+        free(path);
+        return false;
+    }
+
+    out->data = header + 1;
+    out->size = (size_t)header->payload_size;
+    out->width = header->width;
+    out->height = header->height;
+
+    // Eviction goes by modification time, so a hit marks the entry as recently used
+    platform_touch_file(path);
+    cache->stats.hits++;
+    free(path);
+    return true;
+}
+
+static int compare_oldest(const void* a, const void* b) {
+    unsigned long long ma = ((const CacheFile*)a)->modified, mb = ((const CacheFile*)b)->modified;
+    return ma < mb ? -1 : (ma > mb ? 1 : 0);
+}
+
+// Removes the least recently used entries until the directory fits the limit; keep is never removed
+static void evict(DecodeCache* cache, const char* keep) {
+    size_t count = 0;
+    char** names = platform_list_dir(cache->dir, ".bin", &count);
+    if (!names) return;
+
+    CacheFile* files = (CacheFile*)calloc(count ? count : 1, sizeof(CacheFile));
+    unsigned long long total = 0;
+    size_t listed = 0;
+    for (size_t i = 0; files && i < count; i++) {
+        char* path = cache_path(cache, names[i]);
+        if (path && platform_file_info(path, &files[listed].size, &files[listed].modified)) {
+            files[listed].path = path;
+            total += files[listed].size;
+            listed++;
+        } else {
+            free(path);
+        }
+    }
+    platform_free_list(names, count);
+    if (!files) return;
+
+    if (total > cache->max_bytes) {
+        qsort(files, listed, sizeof(CacheFile), compare_oldest);
+        for (size_t i = 0; i < listed && total > cache->max_bytes; i++) {
+            if (strcmp(files[i].path, keep) == 0) continue;
+            if (remove(files[i].path) == 0) {
+                total -= files[i].size;
+                cache->stats.evictions++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < listed; i++) free(files[i].path);
+    free(files);
+}
+
+bool decode_cache_store(DecodeCache* cache, const char* source, DecodeKind kind, uint64_t variant,
+                        const void* data, size_t size, int width, int height) {
+    uint64_t content_hash;
+    if (!decode_cache_source_hash(cache, source, &content_hash)) return false;
+    char* path = entry_path(cache, content_hash, kind, variant);
+    if (!path) return false;
+
+    CacheEntryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_ENTRY_MAGIC, sizeof(header.magic));
+    header.version = CACHE_VERSION;
+    header.kind = (uint32_t)kind;
+    header.content_hash = content_hash;
+    header.variant = variant;
+    header.payload_size = size;
+    header.width = width;
+    header.height = height;
+
+    bool ok = write_file(path, &header, sizeof(header), data, size);
+    if (ok) {
+        cache->stats.stores++;
+        evict(cache, path);
+    } else {
+        log_warn("Failed to write cache entry %s", path);
+    }
+    free(path);
+    return ok;
+}
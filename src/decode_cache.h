@@ -0,0 +1,75 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
+
+#define DECODE_CACHE_DEFAULT_BYTES ((size_t)2 << 30)
+
+// What a cache entry holds
+typedef enum {
+    DECODE_DEPTH_F32 = 1,   // Depth map as row-major float, width x height
+    DECODE_RGBA8 = 2,       // Image as 8-bit RGBA, width x height
+    DECODE_SPLATS = 3       // Finished Splat array
+} DecodeKind;
+
+// Decoded data, either mapped from a cache entry or held on the heap
+typedef struct {
+    const void* data;      // Payload, 64-byte aligned
+    size_t size;           // Payload bytes
+    int width, height;     // Image or depth map size, 0 for splat buffers
+    PlatformFileMap map;   // Mapping of the cache entry, if the data came from the cache
+    void* owned;           // Heap buffer otherwise, counted as MEM_LOADER memory (mem_track.h)
+} CachedData;
+
+void cached_data_release(CachedData* cached);
+
+typedef struct {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+    size_t hashed_bytes;   // Source bytes read to compute content hashes
+} DecodeCacheStats;
+
+/**
+ * On-disk cache of decoded source files, so that reopening a scene maps
+ * ready-to-use arrays instead of inflating npz members and decoding PNGs.
+ *
+ * Sources are identified by path, size and modification time; a content hash
+ * of the source is computed when that identity is new or has changed, and
+ * entries are stored under the content hash. A touched or copied file
+ * therefore costs one hashing pass rather than a decode. Entries are evicted
+ * least recently used first when the directory exceeds its size limit.
+ *
+ * A cache handle is not thread-safe.
+ */
+typedef struct DecodeCache DecodeCache;
+
+// Opens (creating if needed) a cache directory. max_bytes == 0 uses DECODE_CACHE_DEFAULT_BYTES.
+DecodeCache* decode_cache_open(const char* dir, size_t max_bytes);
+void decode_cache_close(DecodeCache* cache);
+
+// Content hash of a source file, reusing the stored hash while its size and modification time are unchanged
+bool decode_cache_source_hash(DecodeCache* cache, const char* source, uint64_t* hash);
+
+/**
+ * @brief Maps the entry decoded from source with the given kind and variant.
+ *
+ * @param variant Hash of every other input the decoded data depends on (e.g. decoding options), 0 if none.
+ * @return true on a hit; release out with cached_data_release.
+ */
+bool decode_cache_lookup(DecodeCache* cache, const char* source, DecodeKind kind, uint64_t variant, CachedData* out);
+
+// Stores decoded data for source, then evicts old entries beyond the size limit
+bool decode_cache_store(DecodeCache* cache, const char* source, DecodeKind kind, uint64_t variant,
+                        const void* data, size_t size, int width, int height);
+
+void decode_cache_get_stats(const DecodeCache* cache, DecodeCacheStats* stats);
+
+// 64-bit hash for content and variant keys
+uint64_t decode_cache_hash(const void* data, size_t size, uint64_t seed);
+
+#endif // DECODE_CACHE_H
@@ -0,0 +1,300 @@
+// File: src/fusion.c
+#include "fusion.h"
+#include "arena.h"
+#include "log.h"
+#include "mem_track.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>        // For OpenMP parallelization
+
+#define FUSION_AXIS_BITS 21
+#define FUSION_AXIS_OFFSET (1 << (FUSION_AXIS_BITS - 1))
+#define FUSION_MIN_CAPACITY 1024
+
+// Weighted sums of everything merged into one voxel
+typedef struct {
+    atomic_uint_least64_t key;   // Packed voxel coordinates + 1, 0 = empty
+    float weight;
+    float x, y, z;
+    float r, g, b, a;
+    float scale;
+} Voxel;
+
+struct VoxelFusion {
+    float voxel_size;
+    float inv_voxel_size;
+    Voxel* table;
+    size_t capacity;             // Power of two
+    atomic_size_t voxel_count;
+    atomic_size_t dropped;
+};
+
+// splitmix64 finalizer; voxel keys are highly regular, so they need a strong mix
+static inline uint64_t hash_key(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    key ^= key >> 31;
+    return key;
+}
+
+static bool voxel_key(const VoxelFusion* fusion, const Splat* splat, uint64_t* key) {
+    float fx = floorf(splat->x * fusion->inv_voxel_size);
+    float fy = floorf(splat->y * fusion->inv_voxel_size);
+    float fz = floorf(splat->z * fusion->inv_voxel_size);
+    // Negated comparisons also reject NaN
+    if (!(fabsf(fx) < FUSION_AXIS_OFFSET && fabsf(fy) < FUSION_AXIS_OFFSET && fabsf(fz) < FUSION_AXIS_OFFSET)) {
+        return false;
+    }
+
+    uint64_t ix = (uint64_t)((int64_t)fx + FUSION_AXIS_OFFSET);
+    uint64_t iy = (uint64_t)((int64_t)fy + FUSION_AXIS_OFFSET);
+    uint64_t iz = (uint64_t)((int64_t)fz + FUSION_AXIS_OFFSET);
+    *key = (ix | iy << FUSION_AXIS_BITS | iz << (2 * FUSION_AXIS_BITS)) + 1;
+    return true;
+}
+
+// Finds the voxel for a key, claiming an empty slot if it is new. Safe to call from many threads.
+static Voxel* find_or_claim(VoxelFusion* fusion, uint64_t key) {
+    size_t mask = fusion->capacity - 1;
+    for (size_t slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+        Voxel* voxel = &fusion->table[slot];
+        uint64_t current = atomic_load_explicit(&voxel->key, memory_order_acquire);
+        if (current == 0) {
+            uint64_t expected = 0;
+            if (atomic_compare_exchange_strong_explicit(&voxel->key, &expected, key,
+                                                        memory_order_acq_rel, memory_order_acquire)) {
+                atomic_fetch_add_explicit(&fusion->voxel_count, 1, memory_order_relaxed);
+                return voxel;
+            }
+            current = expected;  // Another thread claimed the slot first
+        }
+        if (current == key) return voxel;
+    }
+}
+
+// Rehashes into a larger table. Single-threaded; only called between integrations.
+static bool grow_table(VoxelFusion* fusion, size_t capacity) {
+    Voxel* table = (Voxel*)calloc(capacity, sizeof(Voxel));
+    if (!table) {
+        log_error("Failed to allocate memory for %zu fusion voxels.", capacity);
+        return false;
+    }
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < fusion->capacity; i++) {
+        Voxel* old = &fusion->table[i];
+        uint64_t key = atomic_load_explicit(&old->key, memory_order_relaxed);
+        if (key == 0) continue;
+
+        size_t slot = hash_key(key) & mask;
+        while (atomic_load_explicit(&table[slot].key, memory_order_relaxed) != 0) slot = (slot + 1) & mask;
+        Voxel* voxel = &table[slot];
+        atomic_store_explicit(&voxel->key, key, memory_order_relaxed);
+        voxel->weight = old->weight;
+        voxel->x = old->x;
+        voxel->y = old->y;
+        voxel->z = old->z;
+        voxel->r = old->r;
+        voxel->g = old->g;
+        voxel->b = old->b;
+        voxel->a = old->a;
+        voxel->scale = old->scale;
+    }
+
+    free(fusion->table);
+    fusion->table = table;
+    fusion->capacity = capacity;
+    return true;
+}
+
+VoxelFusion* fusion_create(float voxel_size, size_t expected_voxels) {
+    if (!(voxel_size > 0.0f)) {
+        log_error("Fusion voxel size must be positive.");
+        return NULL;
+    }
+
+    VoxelFusion* fusion = (VoxelFusion*)calloc(1, sizeof(VoxelFusion));
+    if (!fusion) return NULL;
+
+    size_t capacity = FUSION_MIN_CAPACITY;
+    while (capacity < expected_voxels * 2) capacity *= 2;
+
+    fusion->voxel_size = voxel_size;
+    fusion->inv_voxel_size = 1.0f / voxel_size;
+    fusion->table = (Voxel*)calloc(capacity, sizeof(Voxel));
+    fusion->capacity = capacity;
+    atomic_init(&fusion->voxel_count, 0);
+    atomic_init(&fusion->dropped, 0);
+
+    if (!fusion->table) {
+        log_error("Failed to allocate memory for %zu fusion voxels.", capacity);
+        free(fusion);
+        return NULL;
+    }
+    return fusion;
+}
+
+void fusion_free(VoxelFusion* fusion) {
+    if (!fusion) return;
+    free(fusion->table);
+    free(fusion);
+}
+
+bool fusion_integrate(VoxelFusion* fusion, const Splat* splats, size_t count) {
+    // Keep the load factor at or below one half even if every splat opens a new voxel
+    size_t needed = atomic_load(&fusion->voxel_count) + count;
+    if (needed * 2 > fusion->capacity) {
+        size_t capacity = fusion->capacity;
+        while (capacity < needed * 2) capacity *= 2;
+        if (!grow_table(fusion, capacity)) return false;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)count; i++) {
+        const Splat* splat = &splats[i];
+        uint64_t key;
+        if (!voxel_key(fusion, splat, &key)) {
+            atomic_fetch_add_explicit(&fusion->dropped, 1, memory_order_relaxed);
+            continue;
+        }
+
+        float weight = splat->scale > 0.0f ? splat->a / splat->scale : splat->a;
+        if (!(weight > 0.0f)) continue;
+
+        Voxel* voxel = find_or_claim(fusion, key);
+        #pragma omp atomic
+        voxel->weight += weight;
+        #pragma omp atomic
+        voxel->x += weight * splat->x;
+        #pragma omp atomic
+        voxel->y += weight * splat->y;
+        #pragma omp atomic
+        voxel->z += weight * splat->z;
+        #pragma omp atomic
+        voxel->r += weight * splat->r;
+        #pragma omp atomic
+        voxel->g += weight * splat->g;
+        #pragma omp atomic
+        voxel->b += weight * splat->b;
+        #pragma omp atomic
+        voxel->a += weight * splat->a;
+        #pragma omp atomic
+        voxel->scale += weight * splat->scale;
+    }
+
+    return true;
+}
+
+size_t fusion_voxel_count(const VoxelFusion* fusion) {
+    return atomic_load(&fusion->voxel_count);
+}
+
+size_t fusion_dropped_count(const VoxelFusion* fusion) {
+    return atomic_load(&fusion->dropped);
+}
+
+int fusion_extract(const VoxelFusion* fusion, Splat** splats) {
+    size_t count = fusion_voxel_count(fusion);
+    *splats = NULL;
+    if (count == 0) return 0;
+
+    *splats = (Splat*)mem_malloc(MEM_LOADER, count * sizeof(Splat));
+    if (!*splats) {
+        log_error("Failed to allocate memory for fused splats.");
+        return 0;
+    }
+
+    size_t written = 0;
+    for (size_t i = 0; i < fusion->capacity && written < count; i++) {
+        const Voxel* voxel = &fusion->table[i];
+        if (atomic_load_explicit(&voxel->key, memory_order_relaxed) == 0 || !(voxel->weight > 0.0f)) {
+            continue;
+        }
+
+        float inv_weight = 1.0f / voxel->weight;
+        Splat* out = &(*splats)[written++];
+        out->x = voxel->x * inv_weight;
+        out->y = voxel->y * inv_weight;
+        out->z = voxel->z * inv_weight;
+        out->dx = 0.0f;
+        out->dy = 0.0f;
+        out->dz = 0.0f;
+        out->r = voxel->r * inv_weight;
+        out->g = voxel->g * inv_weight;
+        out->b = voxel->b * inv_weight;
+        out->a = voxel->a * inv_weight;
+        // A merged splat has to cover its voxel even when the observations were finer
+        out->scale = fmaxf(voxel->scale * inv_weight, fusion->voxel_size * 0.5f);
+    }
+
+    return (int)written;
+}
+
+int fuse_dataset(const Dataset* dataset, const UnprojectParams* params, const float* poses,
+                 float voxel_size, Splat** splats) {
+    *splats = NULL;
+
+    DatasetLoaderOptions options = {0};
+    options.load_rgb = true;
+    DatasetLoader* loader = dataset_loader_start(dataset, &options);
+    if (!loader) return 0;
+
+    // Every frame unprojects into the same pooled buffer
+    BufferPool* pool = buffer_pool_create();
+    VoxelFusion* fusion = NULL;
+    size_t frames = 0, observed = 0;
+    bool ok = true;
+
+    DatasetFrame frame;
+    while (dataset_loader_next(loader, &frame)) {
+        if (ok && frame.depth.data) {
+            size_t height = frame.depth.ndim > 1 ? frame.depth.shape[0] : 1;
+            size_t width = cnpy_num_elements(&frame.depth) / height;
+
+            UnprojectParams frame_params = {0};
+            if (params) frame_params = *params;
+            if (frame_params.intrinsics.fx <= 0.0f) {
+                frame_params.intrinsics = camera_intrinsics_from_fov((int)width, (int)height, 90.0f);
+            }
+            frame_params.pose = poses ? poses + frame.index * 12 : NULL;
+            frame_params.rgb = frame.rgb;
+            frame_params.rgb_width = frame.rgb_width;
+            frame_params.rgb_height = frame.rgb_height;
+            frame_params.rgb_channels = frame.rgb_channels;
+
+            Splat* frame_splats = pool ? (Splat*)buffer_pool_acquire(pool, width * height * sizeof(Splat)) : NULL;
+            int frame_count = frame_splats
+                ? unproject_depth_into(&frame.depth, &frame_params, frame_splats, width * height)
+                : 0;
+
+            // Size the table for one frame of distinct voxels up front
+            if (!fusion) {
+                fusion = fusion_create(voxel_size, (size_t)frame_count);
+                ok = fusion != NULL;
+            }
+            if (ok && frame_count > 0) {
+                ok = fusion_integrate(fusion, frame_splats, (size_t)frame_count);
+                observed += (size_t)frame_count;
+                frames++;
+            }
+            if (frame_splats) buffer_pool_release(pool, frame_splats);
+        }
+        dataset_loader_release(loader, &frame);
+    }
+    dataset_loader_stop(loader);
+    buffer_pool_destroy(pool);
+
+    int fused = 0;
+    if (ok && fusion) {
+        fused = fusion_extract(fusion, splats);
+        log_info("Fused %zu splats from %zu frames into %d voxels (%.1f%%), %zu dropped outside the volume.",
+               observed, frames, fused, observed ? 100.0 * fused / observed : 0.0, fusion_dropped_count(fusion));
+    }
+    fusion_free(fusion);
+    return fused;
+}
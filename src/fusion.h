@@ -0,0 +1,72 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "splat.h"
+#include "dataset.h"
+#include "unproject.h"
+
+/**
+ * Global splat cloud built from many frames. Space is divided into cubic
+ * voxels and every splat landing in a voxel is merged into a single
+ * weighted average of position, color, opacity and scale.
+ *
+ * The voxel table is an open-addressing hash keyed by packed voxel
+ * coordinates. fusion_integrate inserts from all OpenMP threads at once:
+ * voxels are claimed with a compare-and-swap on the key and accumulated with
+ * atomic adds, so no locks are taken.
+ */
+typedef struct VoxelFusion VoxelFusion;
+
+/**
+ * @brief Creates an empty fusion volume.
+ *
+ * @param voxel_size Edge length of a voxel in world units.
+ * @param expected_voxels Initial capacity hint; the table grows between integrations.
+ * @return Fusion handle, or NULL on failure.
+ */
+VoxelFusion* fusion_create(float voxel_size, size_t expected_voxels);
+void fusion_free(VoxelFusion* fusion);
+
+/**
+ * @brief Merges splats into the volume in parallel.
+ *
+ * Each splat is weighted by its opacity over its footprint, so close,
+ * well-resolved observations dominate distant ones.
+ *
+ * @return false if the table could not grow to hold the new splats.
+ */
+bool fusion_integrate(VoxelFusion* fusion, const Splat* splats, size_t count);
+
+size_t fusion_voxel_count(const VoxelFusion* fusion);
+
+// Splats that fell outside the addressable volume (about 2^20 voxels per axis) and were dropped
+size_t fusion_dropped_count(const VoxelFusion* fusion);
+
+/**
+ * @brief Produces one splat per voxel from the accumulated averages.
+ *
+ * @param splats Receives an array of splats, counted as MEM_LOADER; release it with mem_free.
+ * @return Number of splats, 0 on failure or if the volume is empty.
+ */
+int fusion_extract(const VoxelFusion* fusion, Splat** splats);
+
+/**
+ * @brief Unprojects and fuses every frame of a dataset.
+ *
+ * Frames are decoded on the dataset loader's worker threads while the
+ * previous frame is being integrated.
+ *
+ * @param dataset Frames to fuse.
+ * @param params Intrinsics and depth scale; zero intrinsics use a 90 degree vertical field of view.
+ *               The pose and color fields are ignored and taken per frame.
+ * @param poses Row-major 3x4 camera-to-world pose per frame (12 floats each), NULL for identity.
+ * @param voxel_size Voxel edge length in world units.
+ * @param splats Receives an array of fused splats, counted as MEM_LOADER; release it with mem_free.
+ * @return Number of fused splats, 0 on failure.
+ */
+int fuse_dataset(const Dataset* dataset, const UnprojectParams* params, const float* poses,
+                 float voxel_size, Splat** splats);
+
+#endif // FUSION_H
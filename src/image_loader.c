@@ -1,10 +1,15 @@
 #include "image_loader.h"
+#include "log.h"
 #include <stb_image.h>  // stb_image.h needs to be added to your project
 
 unsigned char* load_png_image(const char* file_path, int* width, int* height, int* channels) {
     unsigned char* image_data = stbi_load(file_path, width, height, channels, 0);
     if (!image_data) {
-        printf("Failed to load PNG image: %s\n", file_path);
+        log_error("Failed to load PNG image: %s", file_path);
     }
     return image_data;
 }
+
+void free_png_image(unsigned char* image_data) {
+    stbi_image_free(image_data);
+}
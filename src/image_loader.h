@@ -2,5 +2,6 @@
 #define IMAGE_LOADER_H
 
 unsigned char* load_png_image(const char* file_path, int* width, int* height, int* channels);
+void free_png_image(unsigned char* image_data);
 
 #endif
@@ -0,0 +1,231 @@
+// File: src/image_quality.c
+#include "image_quality.h"
+#include "log.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <immintrin.h>  // For SSE intrinsics
+
+#define SSIM_C1 (0.01f * 255.0f * 0.01f * 255.0f)
+#define SSIM_C2 (0.03f * 255.0f * 0.03f * 255.0f)
+#define ERROR_CHUNK_BYTES 4096   // Squared sums per 32-bit lane stay below 2^27 over one chunk
+
+// Squared and absolute differences over n samples, 16 per iteration
+static void error_sums(const unsigned char* a, const unsigned char* b, size_t n, uint64_t* squared,
+                       uint64_t* absolute, int* max_error) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i max_diff = zero, abs_sum = zero;
+    uint64_t squared_sum = 0;
+    size_t i = 0;
+
+    while (i + 16 <= n) {
+        size_t chunk_end = i + ERROR_CHUNK_BYTES < n ? i + ERROR_CHUNK_BYTES : n;
+        __m128i squares = zero;
+        for (; i + 16 <= chunk_end; i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+            max_diff = _mm_max_epu8(max_diff, diff);
+            abs_sum = _mm_add_epi64(abs_sum, _mm_sad_epu8(diff, zero));
+            __m128i low = _mm_unpacklo_epi8(diff, zero), high = _mm_unpackhi_epi8(diff, zero);
+            squares = _mm_add_epi32(squares, _mm_add_epi32(_mm_madd_epi16(low, low), _mm_madd_epi16(high, high)));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, squares);
+        squared_sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    uint64_t abs_lanes[2];
+    unsigned char max_lanes[16];
+    _mm_storeu_si128((__m128i*)abs_lanes, abs_sum);
+    _mm_storeu_si128((__m128i*)max_lanes, max_diff);
+    uint64_t abs_total = abs_lanes[0] + abs_lanes[1];
+    int max_value = 0;
+    for (int lane = 0; lane < 16; lane++) {
+        if (max_lanes[lane] > max_value) max_value = max_lanes[lane];
+    }
+
+    for (; i < n; i++) {
+        int diff = abs((int)a[i] - (int)b[i]);
+        squared_sum += (uint64_t)(diff * diff);
+        abs_total += (uint64_t)diff;
+        if (diff > max_value) max_value = diff;
+    }
+
+    *squared = squared_sum;
+    *absolute = abs_total;
+    *max_error = max_value;
+}
+
+static void to_luma(const unsigned char* rgb, size_t pixels, float* luma) {
+    #pragma omp parallel for
+    for (long long i = 0; i < (long long)pixels; i++) {
+        const unsigned char* p = rgb + i * 3;
+        luma[i] = 0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2];
+    }
+}
+
+static float ssim_value(float mu_a, float mu_b, float aa, float bb, float ab) {
+    float var_a = aa - mu_a * mu_a, var_b = bb - mu_b * mu_b, cov = ab - mu_a * mu_b;
+    return ((2.0f * mu_a * mu_b + SSIM_C1) * (2.0f * cov + SSIM_C2)) /
+           ((mu_a * mu_a + mu_b * mu_b + SSIM_C1) * (var_a + var_b + SSIM_C2));
+}
+
+static __m128 ssim_vector(__m128 mu_a, __m128 mu_b, __m128 aa, __m128 bb, __m128 ab) {
+    __m128 two = _mm_set1_ps(2.0f), c1 = _mm_set1_ps(SSIM_C1), c2 = _mm_set1_ps(SSIM_C2);
+    __m128 mu_ab = _mm_mul_ps(mu_a, mu_b);
+    __m128 mu_aa = _mm_mul_ps(mu_a, mu_a), mu_bb = _mm_mul_ps(mu_b, mu_b);
+    __m128 cov = _mm_sub_ps(ab, mu_ab);
+    __m128 variance = _mm_add_ps(_mm_sub_ps(aa, mu_aa), _mm_sub_ps(bb, mu_bb));
+    __m128 numerator = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(two, mu_ab), c1), _mm_add_ps(_mm_mul_ps(two, cov), c2));
+    __m128 denominator = _mm_mul_ps(_mm_add_ps(_mm_add_ps(mu_aa, mu_bb), c1), _mm_add_ps(variance, c2));
+    return _mm_div_ps(numerator, denominator);
+}
+
+// One window over the whole image, for images smaller than the Gaussian window
+static double global_ssim(const float* a, const float* b, size_t pixels) {
+    double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+    for (size_t i = 0; i < pixels; i++) {
+        sa += a[i];
+        sb += b[i];
+        saa += (double)a[i] * a[i];
+        sbb += (double)b[i] * b[i];
+        sab += (double)a[i] * b[i];
+    }
+    return ssim_value((float)(sa / pixels), (float)(sb / pixels), (float)(saa / pixels), (float)(sbb / pixels),
+                      (float)(sab / pixels));
+}
+
+static bool mean_ssim(const float* a, const float* b, int width, int height, double* ssim) {
+    const int window = IMAGE_QUALITY_SSIM_WINDOW;
+    if (width < window || height < window) {
+        *ssim = global_ssim(a, b, (size_t)width * height);
+        return true;
+    }
+
+    float weights[IMAGE_QUALITY_SSIM_WINDOW];
+    float total = 0.0f;
+    for (int k = 0; k < window; k++) {
+        float offset = (float)(k - window / 2);
+        weights[k] = expf(-offset * offset / (2.0f * 1.5f * 1.5f));
+        total += weights[k];
+    }
+    for (int k = 0; k < window; k++) weights[k] /= total;
+
+    // Horizontal pass: means and second moments of every row, valid columns only
+    int out_width = width - window + 1, out_height = height - window + 1;
+    size_t map_size = (size_t)out_width * height;
+    float* maps = (float*)malloc(map_size * 5 * sizeof(float));
+    if (!maps) {
+        log_error("Failed to allocate SSIM buffers for %dx%d.", width, height);
+        return false;
+    }
+    float *map_a = maps, *map_b = maps + map_size, *map_aa = maps + 2 * map_size;
+    float *map_bb = maps + 3 * map_size, *map_ab = maps + 4 * map_size;
+
+    #pragma omp parallel for
+    for (int y = 0; y < height; y++) {
+        const float* row_a = a + (size_t)y * width;
+        const float* row_b = b + (size_t)y * width;
+        size_t out = (size_t)y * out_width;
+        int x = 0;
+        for (; x + 4 <= out_width; x += 4) {
+            __m128 sa = _mm_setzero_ps(), sb = sa, saa = sa, sbb = sa, sab = sa;
+            for (int k = 0; k < window; k++) {
+                __m128 w = _mm_set1_ps(weights[k]);
+                __m128 va = _mm_loadu_ps(row_a + x + k), vb = _mm_loadu_ps(row_b + x + k);
+                __m128 wa = _mm_mul_ps(w, va), wb = _mm_mul_ps(w, vb);
+                sa = _mm_add_ps(sa, wa);
+                sb = _mm_add_ps(sb, wb);
+                saa = _mm_add_ps(saa, _mm_mul_ps(wa, va));
+                sbb = _mm_add_ps(sbb, _mm_mul_ps(wb, vb));
+                sab = _mm_add_ps(sab, _mm_mul_ps(wa, vb));
+            }
+            _mm_storeu_ps(map_a + out + x, sa);
+            _mm_storeu_ps(map_b + out + x, sb);
+            _mm_storeu_ps(map_aa + out + x, saa);
+            _mm_storeu_ps(map_bb + out + x, sbb);
+            _mm_storeu_ps(map_ab + out + x, sab);
+        }
+        for (; x < out_width; x++) {
+            float sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int k = 0; k < window; k++) {
+                float va = row_a[x + k], vb = row_b[x + k];
+                sa += weights[k] * va;
+                sb += weights[k] * vb;
+                saa += weights[k] * va * va;
+                sbb += weights[k] * vb * vb;
+                sab += weights[k] * va * vb;
+            }
+            map_a[out + x] = sa;
+            map_b[out + x] = sb;
+            map_aa[out + x] = saa;
+            map_bb[out + x] = sbb;
+            map_ab[out + x] = sab;
+        }
+    }
+
+    // Vertical pass, reduced to the SSIM sum without storing the map
+    double sum = 0.0;
+    #pragma omp parallel for reduction(+:sum)
+    for (int y = 0; y < out_height; y++) {
+        __m128 row_sum = _mm_setzero_ps();
+        float tail_sum = 0.0f;
+        int x = 0;
+        for (; x + 4 <= out_width; x += 4) {
+            __m128 sa = _mm_setzero_ps(), sb = sa, saa = sa, sbb = sa, sab = sa;
+            for (int k = 0; k < window; k++) {
+                __m128 w = _mm_set1_ps(weights[k]);
+                size_t index = (size_t)(y + k) * out_width + x;
+                sa = _mm_add_ps(sa, _mm_mul_ps(w, _mm_loadu_ps(map_a + index)));
+                sb = _mm_add_ps(sb, _mm_mul_ps(w, _mm_loadu_ps(map_b + index)));
+                saa = _mm_add_ps(saa, _mm_mul_ps(w, _mm_loadu_ps(map_aa + index)));
+                sbb = _mm_add_ps(sbb, _mm_mul_ps(w, _mm_loadu_ps(map_bb + index)));
+                sab = _mm_add_ps(sab, _mm_mul_ps(w, _mm_loadu_ps(map_ab + index)));
+            }
+            row_sum = _mm_add_ps(row_sum, ssim_vector(sa, sb, saa, sbb, sab));
+        }
+        for (; x < out_width; x++) {
+            float sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int k = 0; k < window; k++) {
+                size_t index = (size_t)(y + k) * out_width + x;
+                sa += weights[k] * map_a[index];
+                sb += weights[k] * map_b[index];
+                saa += weights[k] * map_aa[index];
+                sbb += weights[k] * map_bb[index];
+                sab += weights[k] * map_ab[index];
+            }
+            tail_sum += ssim_value(sa, sb, saa, sbb, sab);
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, row_sum);
+        sum += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3] + tail_sum;
+    }
+
+    free(maps);
+    *ssim = sum / ((double)out_width * out_height);
+    return true;
+}
+
+bool image_quality_compare(const unsigned char* reference, const unsigned char* image, int width, int height,
+                           ImageQuality* quality) {
+    size_t pixels = (size_t)width * height;
+    size_t samples = pixels * 3;
+    uint64_t squared, absolute;
+    error_sums(reference, image, samples, &squared, &absolute, &quality->max_error);
+    quality->mse = samples ? (double)squared / samples : 0.0;
+    quality->mean_error = samples ? (double)absolute / samples : 0.0;
+    quality->psnr = quality->mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / quality->mse) : INFINITY;
+
+    float* luma = (float*)malloc(pixels * 2 * sizeof(float));
+    if (!luma) {
+        log_error("Failed to allocate luma buffers for %dx%d.", width, height);
+        return false;
+    }
+    to_luma(reference, pixels, luma);
+    to_luma(image, pixels, luma + pixels);
+    bool ok = mean_ssim(luma, luma + pixels, width, height, &quality->ssim);
+    free(luma);
+    return ok;
+}
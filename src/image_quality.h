@@ -0,0 +1,31 @@
+#ifndef IMAGE_QUALITY_H
+#define IMAGE_QUALITY_H
+
+#include <stdbool.h>
+
+#define IMAGE_QUALITY_SSIM_WINDOW 11   // Gaussian window edge in pixels (sigma 1.5)
+
+// Differences between two images of the same size
+typedef struct {
+    double psnr;          // Over all RGB samples in dB; INFINITY for identical images
+    double mse;           // Mean squared error per sample, 0-255 scale
+    double mean_error;    // Mean absolute error per sample, 0-255 scale
+    int max_error;        // Largest absolute difference of any sample
+    double ssim;          // Mean SSIM of the luma over every full window, 1 for identical images
+} ImageQuality;
+
+/**
+ * @brief Compares an image with a reference.
+ *
+ * Both images are interleaved RGB8, row-major, of the same size. The error
+ * sums run over 16 samples per SSE iteration. SSIM uses the usual constants
+ * (K1 = 0.01, K2 = 0.03) on BT.601 luma, filtered with a separable Gaussian
+ * four pixels at a time; images smaller than the window are treated as a
+ * single window.
+ *
+ * @return false if the scratch buffers could not be allocated.
+ */
+bool image_quality_compare(const unsigned char* reference, const unsigned char* image, int width, int height,
+                           ImageQuality* quality);
+
+#endif // IMAGE_QUALITY_H
@@ -0,0 +1,139 @@
+// File: src/log.c
+#include "log.h"
+#include "platform.h"
+#include "trace.h"
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    atomic_size_t sequence;   // position + 1 once written, position + LOG_RING_RECORDS once free again
+    LogLevel level;
+    char text[LOG_MESSAGE_SIZE];
+} LogRecord;
+
+static LogRecord ring[LOG_RING_RECORDS];
+static atomic_size_t write_position;
+static size_t read_position;            // Writer thread only
+static atomic_size_t dropped;
+
+static atomic_bool queueing = false;    // Writer thread running and accepting records
+static atomic_int producers = 0;        // Threads between checking queueing and publishing
+static atomic_bool stopping = false;
+static PlatformThread writer_thread;
+
+static const char* level_prefix[] = {"Debug: ", "", "Warning: ", "Error: "};
+
+static void write_line(LogLevel level, const char* text) {
+    fprintf(stdout, "%s%s\n", level_prefix[level], text);
+}
+
+// Claims the slot at the write position; NULL when the writer has not freed it yet
+static LogRecord* claim_record(size_t* position) {
+    size_t pos = atomic_load_explicit(&write_position, memory_order_relaxed);
+    for (;;) {
+        LogRecord* record = &ring[pos % LOG_RING_RECORDS];
+        size_t sequence = atomic_load_explicit(&record->sequence, memory_order_acquire);
+        intptr_t lag = (intptr_t)sequence - (intptr_t)pos;
+        if (lag == 0) {
+            if (atomic_compare_exchange_weak_explicit(&write_position, &pos, pos + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                *position = pos;
+                return record;
+            }
+        } else if (lag < 0) {
+            return NULL;
+        } else {
+            pos = atomic_load_explicit(&write_position, memory_order_relaxed);
+        }
+    }
+}
+
+void log_write(LogLevel level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    // Counted before checking queueing, so log_stop can wait for records still being written
+    atomic_fetch_add(&producers, 1);
+    if (atomic_load(&queueing)) {
+        size_t position;
+        LogRecord* record = claim_record(&position);
+        if (record) {
+            record->level = level;
+            vsnprintf(record->text, sizeof(record->text), format, args);
+            atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+        } else {
+            atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        }
+        atomic_fetch_sub(&producers, 1);
+    } else {
+        atomic_fetch_sub(&producers, 1);
+        char text[LOG_MESSAGE_SIZE];
+        vsnprintf(text, sizeof(text), format, args);
+        write_line(level, text);
+    }
+
+    va_end(args);
+}
+
+// Writes the published records in order; stops at the first one still being formatted
+static size_t drain_records(void) {
+    size_t written = 0;
+    for (;;) {
+        LogRecord* record = &ring[read_position % LOG_RING_RECORDS];
+        if (atomic_load_explicit(&record->sequence, memory_order_acquire) != read_position + 1) break;
+        write_line(record->level, record->text);
+        atomic_store_explicit(&record->sequence, read_position + LOG_RING_RECORDS, memory_order_release);
+        read_position++;
+        written++;
+    }
+
+    size_t lost = atomic_exchange_explicit(&dropped, 0, memory_order_relaxed);
+    if (lost > 0) fprintf(stdout, "%s%zu log messages dropped; the log buffer was full\n", level_prefix[LOG_WARN], lost);
+    return written + lost;
+}
+
+static void writer_loop(void* arg) {
+    (void)arg;
+    trace_set_thread_name("log writer");
+    for (;;) {
+        // Read before draining: once stopping is set no producer can publish, so an empty drain is final
+        bool stop = atomic_load(&stopping);
+        if (drain_records() > 0) {
+            fflush(stdout);
+        } else if (stop) {
+            break;
+        } else {
+            platform_sleep_ms(LOG_DRAIN_INTERVAL_MS);
+        }
+    }
+}
+
+bool log_start(void) {
+    if (atomic_load(&queueing)) return true;
+
+    size_t position = atomic_load(&write_position);
+    for (size_t i = 0; i < LOG_RING_RECORDS; i++) {
+        atomic_store_explicit(&ring[(position + i) % LOG_RING_RECORDS].sequence, position + i, memory_order_relaxed);
+    }
+    read_position = position;
+    atomic_store(&stopping, false);
+
+    if (!platform_thread_create(&writer_thread, writer_loop, NULL)) {
+        log_error("Failed to start the log writer thread; logging synchronously.");
+        return false;
+    }
+    atomic_store(&queueing, true);
+    return true;
+}
+
+void log_stop(void) {
+    if (!atomic_exchange(&queueing, false)) return;
+
+    // Producers that saw queueing still set finish their record; later ones write synchronously
+    while (atomic_load(&producers) > 0) platform_sleep_ms(1);
+    atomic_store(&stopping, true);
+    platform_thread_join(writer_thread);
+    fflush(stdout);
+}
@@ -0,0 +1,76 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdbool.h>
+
+#define LOG_RING_RECORDS 1024       // Records waiting for the writer thread; more are counted as dropped
+#define LOG_MESSAGE_SIZE 256        // Longer messages are truncated
+#define LOG_DRAIN_INTERVAL_MS 2     // Writer thread sleep while the ring is empty
+
+typedef enum {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARN = 2,
+    LOG_ERROR = 3
+} LogLevel;
+
+// Lowest level compiled in (0 debug .. 3 error); debug logs are removed from NDEBUG builds unless overridden
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 1
+#else
+#define LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(format_index, first_arg) __attribute__((format(printf, format_index, first_arg)))
+#else
+#define LOG_PRINTF_FORMAT(format_index, first_arg)
+#endif
+
+/**
+ * @brief Formats a message and hands it to the writer thread.
+ *
+ * The message is formatted straight into a slot of a bounded ring that any
+ * number of threads fill without a lock: a slot is claimed with a CAS on
+ * the write position and published with a release store of its sequence
+ * number. The caller never waits for the terminal; if the ring is full the
+ * message is dropped and counted, and the writer reports the count.
+ *
+ * Before log_start and after log_stop messages are written synchronously,
+ * so tools that never start the writer still see every message.
+ *
+ * Each message becomes one line on stdout, prefixed with its level
+ * ("Error: ", "Warning: ", "Debug: "; info has no prefix). Pass the text
+ * without a trailing newline.
+ */
+void log_write(LogLevel level, const char* format, ...) LOG_PRINTF_FORMAT(2, 3);
+
+#if LOG_COMPILE_LEVEL <= 0
+#define log_debug(...) log_write(LOG_DEBUG, __VA_ARGS__)
+#else
+#define log_debug(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define log_info(...) log_write(LOG_INFO, __VA_ARGS__)
+#else
+#define log_info(...) ((void)0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 2
+#define log_warn(...) log_write(LOG_WARN, __VA_ARGS__)
+#else
+#define log_warn(...) ((void)0)
+#endif
+
+#define log_error(...) log_write(LOG_ERROR, __VA_ARGS__)
+
+// Starts the writer thread; false if it could not be created, in which case logging stays synchronous
+bool log_start(void);
+
+// Writes every queued message and joins the writer thread. Safe to call when it is not running.
+void log_stop(void);
+
+#endif // LOG_H
@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdarg.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "splat.h"
@@ -8,18 +10,48 @@
 #include "data_loader.h"
 #include "camera.h"
 #include "image_loader.h"  // Include image loading utility
+#include "scene_file.h"
+#include "splat_quant.h"
+#include "ply_file.h"
+#include "dataset.h"
+#include "prefetch.h"
+#include "fusion.h"
+#include "arena.h"
+#include "numa.h"
+#include "paged_scene.h"
+#include "splat_stream.h"
+#include "platform.h"
+#include "perf_counters.h"
+#include "render_debug.h"
+#include "trace.h"
+#include <omp.h>
+#include "mem_track.h"
+#include "log.h"
+
+// Image decodes are counted as MEM_IMAGE; stb frees what it allocates, so every stb call matches
+#define STBI_MALLOC(size) mem_malloc(MEM_IMAGE, size)
+#define STBI_REALLOC(block, size) mem_realloc(MEM_IMAGE, block, size)
+#define STBI_FREE(block) mem_free(MEM_IMAGE, block)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 
 #define WIDTH 800
 #define HEIGHT 600
+#define PROFILE_REPORT_SECONDS 5.0   // Interval between rolling frame profile reports
 
 Camera camera;
 float lastX = WIDTH / 2.0f;
 float lastY = HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// Heatmap drawn instead of the splats (--debug, cycled with H) and the value drawn hottest (--debug-limit)
+DebugMode debug_mode = DEBUG_NONE;
+int debug_limit = 10;
+
+// Chrome trace written at exit (--trace), NULL when not tracing
+const char* trace_path = NULL;
+
 void processInput(GLFWwindow *window, Camera *camera);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 
@@ -36,6 +68,15 @@ void processInput(GLFWwindow *window, Camera *camera) {
         camera_move(camera, CAMERA_LEFT, cameraSpeed);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera_move(camera, CAMERA_RIGHT, cameraSpeed);
+
+    // One step per press, not per frame the key is held
+    static bool debug_key_down = false;
+    bool debug_key = glfwGetKey(window, GLFW_KEY_H) == GLFW_PRESS;
+    if (debug_key && !debug_key_down) {
+        debug_mode = (DebugMode)((debug_mode + 1) % DEBUG_MODE_COUNT);
+        log_info("Debug view: %s", debug_mode_name(debug_mode));
+    }
+    debug_key_down = debug_key;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos)
@@ -56,17 +97,306 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
     camera_process_mouse_movement(&camera, xoffset, yoffset, true);
 }
 
-int main() {
+static bool has_extension(const char* path, const char* extension) {
+    size_t len = strlen(path), extension_len = strlen(extension);
+    return len > extension_len && strcmp(path + len - extension_len, extension) == 0;
+}
+
+static bool has_flag(int argc, char** argv, const char* flag) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) return true;
+    }
+    return false;
+}
+
+// Value following a flag, or NULL when the flag is absent
+static const char* flag_value(int argc, char** argv, const char* flag) {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], flag) == 0) return argv[i + 1];
+    }
+    return NULL;
+}
+
+// Names the main thread and the OpenMP workers in the timeline, then starts recording
+static void start_trace(void) {
+    trace_set_thread_name("main");
+    #pragma omp parallel
+    {
+        int thread = omp_get_thread_num();
+        if (thread > 0) {
+            char name[32];
+            snprintf(name, sizeof(name), "worker %d", thread);
+            trace_set_thread_name(name);
+        }
+    }
+    trace_start();
+}
+
+// Called once loader threads have been joined, so their events are complete
+static void finish_trace(void) {
+    if (!trace_path) return;
+    trace_stop(trace_path);
+    trace_shutdown();
+}
+
+// Appends to a line that is logged as one record once complete; text past the end is cut off
+static void line_append(char* line, size_t size, const char* format, ...) {
+    size_t used = strlen(line);
+    if (used + 1 >= size) return;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line + used, size - used, format, args);
+    va_end(args);
+}
+
+// One line of counter totals: cycles and IPC per frame, misses per thousand instructions
+static void report_perf_sample(const PerfCounters* perf, const char* label, const PerfSample* sample, uint64_t frames) {
+    const uint64_t* v = sample->values;
+    char line[LOG_MESSAGE_SIZE] = "";
+    line_append(line, sizeof(line), "    %-10s", label);
+    if (perf_counters_has(perf, PERF_CYCLES)) line_append(line, sizeof(line), " %8.2fM cycles", v[PERF_CYCLES] / 1e6 / frames);
+    bool per_instruction = perf_counters_has(perf, PERF_INSTRUCTIONS) && v[PERF_INSTRUCTIONS] > 0;
+    if (per_instruction && v[PERF_CYCLES] > 0) {
+        line_append(line, sizeof(line), "  ipc %5.2f", (double)v[PERF_INSTRUCTIONS] / v[PERF_CYCLES]);
+    }
+    for (int e = PERF_L1D_MISSES; e < PERF_EVENT_COUNT; e++) {
+        if (!perf_counters_has(perf, (PerfEvent)e)) continue;
+        if (per_instruction) {
+            line_append(line, sizeof(line), "  %s %6.2f", perf_event_name((PerfEvent)e), v[e] * 1000.0 / v[PERF_INSTRUCTIONS]);
+        } else {
+            line_append(line, sizeof(line), "  %s %.0f", perf_event_name((PerfEvent)e), (double)v[e] / frames);
+        }
+    }
+    if (sample->running < 0.999) line_append(line, sizeof(line), "  (multiplexed, counted %.0f%%)", sample->running * 100.0);
+    log_info("%s", line);
+}
+
+// Counter totals of every stage since the last reset, and per thread for the parallel stages
+static void report_perf_counters(const PerfCounters* perf) {
+    uint64_t frames = perf_counters_frames(perf);
+    if (frames == 0) return;
+
+    log_info("  Hardware counters per frame over %llu frames (misses per 1000 instructions):",
+             (unsigned long long)frames);
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        PerfSample total;
+        perf_counters_get(perf, (ProfileStage)stage, -1, &total);
+        if (total.values[PERF_CYCLES] == 0 && total.values[PERF_INSTRUCTIONS] == 0) continue;
+        report_perf_sample(perf, profile_stage_name((ProfileStage)stage), &total, frames);
+
+        if ((stage == PROFILE_PROJECT || stage == PROFILE_RASTERIZE) && perf_counters_threads(perf) > 1) {
+            for (int thread = 0; thread < perf_counters_threads(perf); thread++) {
+                PerfSample sample;
+                char label[32];
+                perf_counters_get(perf, (ProfileStage)stage, thread, &sample);
+                snprintf(label, sizeof(label), "  thread %d", thread);
+                report_perf_sample(perf, label, &sample, frames);
+            }
+        }
+    }
+}
+
+// Rolling stage timings of the last frames, one log record per stage
+static void report_profile(const Renderer* renderer) {
+    ProfileReport report;
+    profiler_get_report(&renderer->profiler, &report);
+    if (report.frames == 0) return;
+
+    log_info("Frame time over %zu frames: p50 %.2f ms, p95 %.2f ms, p99 %.2f ms (%d visible, %d behind camera, %d off screen)",
+             report.frames, report.frame.p50, report.frame.p95, report.frame.p99,
+             report.counters.visible, report.counters.behind_camera, report.counters.outside_screen);
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        const ProfileStats* stats = &report.stages[stage];
+        log_info("  %-9s p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f ms", profile_stage_name((ProfileStage)stage),
+                 stats->p50, stats->p95, stats->p99, stats->max);
+    }
+    if (renderer->profiler.perf) report_perf_counters(renderer->profiler.perf);
+
+    const DebugStats* debug = &renderer->debug_stats;
+    if (debug->mode != DEBUG_NONE) {
+        log_info("  Debug %s: %llu samples covered, %llu blended, %llu depth rejected; max %.1f, hottest at %.1f",
+                 debug_mode_name(debug->mode), debug->covered, debug->shaded, debug->rejected,
+                 debug->max_value, debug->saturation);
+        char line[LOG_MESSAGE_SIZE] = "  Splat radii (px):";
+        for (int bucket = 0; bucket < DEBUG_RADIUS_BUCKETS; bucket++) {
+            line_append(line, sizeof(line), " %g+:%d", debug_radius_bucket_floor(bucket), debug->radius_histogram[bucket]);
+        }
+        log_info("%s", line);
+    }
+}
+
+// Swaps buffers as the present stage of the frame, printing the profile every few seconds
+static void present_frame(GLFWwindow* window, Renderer* renderer) {
+    static double next_report = 0.0;
+    double start = profiler_begin(&renderer->profiler, PROFILE_PRESENT);
+    glfwSwapBuffers(window);
+    profiler_end(&renderer->profiler, PROFILE_PRESENT, start);
+
+    if (start >= next_report) {
+        if (next_report > 0.0) {
+            report_profile(renderer);
+            if (renderer->profiler.perf) perf_counters_reset(renderer->profiler.perf);  // Each report covers its interval
+        }
+        next_report = start + PROFILE_REPORT_SECONDS;
+    }
+}
+
+// Copies the scene into huge-page memory, each page first touched by the thread that projects it.
+// With replicate, keeps one copy per NUMA node instead so no thread reads across sockets.
+// Returns false, leaving the splats where they are, if no copy could be made; *local stays NULL when replicated.
+static bool place_scene(const Splat* splats, int splat_count, bool replicate, NumaReplicas* replicas, Splat** local) {
+    static const char* page_kinds[] = {"regular", "transparent huge", "explicit huge"};
+    *local = NULL;
+    if (replicate && numa_replicas_create(replicas, MEM_SCENE, splats, (size_t)splat_count * sizeof(Splat))) {
+        log_info("Replicated %d splats on %d NUMA node(s) in %s pages.", splat_count, replicas->node_count,
+                 page_kinds[large_page_kind(replicas->copies[0])]);
+        return true;
+    }
+    *local = (Splat*)numa_place_copy(MEM_SCENE, splats, sizeof(Splat), (size_t)splat_count, PROJECT_BLOCK_SIZE);
+    if (*local) {
+        log_info("Placed %d splats across %d NUMA node(s) in %s pages.", splat_count, numa_node_count(),
+                 page_kinds[large_page_kind(*local)]);
+        return true;
+    }
+    return false;
+}
+
+// Once the scene lives in its placed copy, every loader buffer should have been released
+static void check_loader_released(void) {
+    MemUsage loader;
+    mem_usage_get(MEM_LOADER, &loader);
+    if (loader.current != 0) log_warn("%zu bytes of loader memory still held after placing the scene.", loader.current);
+}
+
+// Plays a dataset directory frame by frame; frames are decoded ahead on a background thread
+static int play_sequence(GLFWwindow* window, Renderer* renderer, const char* root) {
+    Dataset dataset;
+    if (!dataset_open(&dataset, root) || dataset.count == 0) {
+        log_error("No depth frames found in %s. Exiting.", root);
+        dataset_free(&dataset);
+        return 1;
+    }
+
+    PrefetchOptions options = {0};
+    options.load_rgb = true;
+    options.loop = true;
+    FramePrefetcher* prefetcher = prefetcher_start(&dataset, &options);
+
+    // Frame splat arrays cycle through a pool instead of the heap
+    BufferPool* pool = buffer_pool_create();
+    if (!prefetcher || !pool) {
+        prefetcher_stop(prefetcher);
+        buffer_pool_destroy(pool);
+        dataset_free(&dataset);
+        return 1;
+    }
+    log_info("Playing %zu frames from %s.", dataset.count, root);
+
+    const PrefetchedFrame* frame = NULL;
+    Splat* splats = NULL;
+    int splat_count = 0;
+
+    while (!glfwWindowShouldClose(window)) {
+        processInput(window, &camera);
+
+        // Stepping is a queue pop; if the next frame is not decoded yet the current one stays up
+        if (prefetcher_advance(prefetcher, &frame) && frame->depth.data) {
+            size_t height = frame->depth.ndim > 1 ? frame->depth.shape[0] : 1;
+            size_t width = cnpy_num_elements(&frame->depth) / height;
+
+            UnprojectParams unproject = {0};
+            unproject.intrinsics = camera_intrinsics_from_fov((int)width, (int)height, 90.0f);
+            unproject.rgb = frame->rgb;
+            unproject.rgb_width = frame->rgb_width;
+            unproject.rgb_height = frame->rgb_height;
+            unproject.rgb_channels = frame->rgb_channels;
+
+            buffer_pool_release(pool, splats);
+            splats = (Splat*)buffer_pool_acquire(pool, width * height * sizeof(Splat));
+            splat_count = splats ? unproject_depth_into(&frame->depth, &unproject, splats, width * height) : 0;
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (splat_count > 0) {
+            render_scene(renderer, splats, splat_count, &camera, debug_mode, debug_limit);
+        }
+        draw_fullscreen_quad(renderer);
+
+        present_frame(window, renderer);
+        glfwPollEvents();
+    }
+    log_stop();
+
+    PrefetchStats stats;
+    prefetcher_get_stats(prefetcher, &stats);
+    printf("Prefetch: %zu frames decoded (%.1f ms each), %zu shown, %zu stalls\n",
+           stats.decoded, stats.decoded ? stats.decode_seconds * 1000.0 / stats.decoded : 0.0,
+           stats.delivered, stats.stalls);
+
+    buffer_pool_release(pool, splats);
+    buffer_pool_destroy(pool);
+    prefetcher_stop(prefetcher);
+    dataset_free(&dataset);
+    return 0;
+}
+
+// Renders a scene file larger than memory; chunks stream in while coarse data stands in for them
+static int play_paged_scene(GLFWwindow* window, Renderer* renderer, const char* path, const char* budget_mib) {
+    PagedSceneOptions options = {0};
+    options.memory_budget = budget_mib ? (size_t)atof(budget_mib) * (1u << 20) : 0;
+    options.aspect_ratio = (float)renderer->width / (float)renderer->height;
+    PagedScene* scene = paged_scene_open(path, &options);
+    if (!scene) {
+        log_error("Failed to open scene %s. Exiting.", path);
+        return 1;
+    }
+
+    while (!glfwWindowShouldClose(window)) {
+        processInput(window, &camera);
+
+        const SplatArrays* chunks;
+        size_t chunk_count = paged_scene_update(scene, &camera, platform_time_seconds(), &chunks);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        render_scene_chunks(renderer, chunks, chunk_count, &camera, debug_mode, debug_limit);
+        draw_fullscreen_quad(renderer);
+
+        present_frame(window, renderer);
+        glfwPollEvents();
+    }
+    log_stop();
+
+    PagedSceneStats stats;
+    paged_scene_get_stats(scene, &stats);
+    printf("Paging: %zu chunk loads (%.1f MiB), %zu evictions, %zu of %zu chunks resident\n",
+           stats.loads, stats.bytes_read / (1024.0 * 1024.0), stats.evictions, stats.resident, stats.chunk_count);
+
+    paged_scene_close(scene);
+    return 0;
+}
+
+int main(int argc, char** argv) {
     printf("Gaussian Splats Renderer\n");
+    double start_time = platform_time_seconds();
+
+    // Loaders and the render loop queue their messages; the writer thread prints them and is flushed at exit
+    if (log_start()) atexit(log_stop);
+
+    // Opened before the first parallel region so the OpenMP worker threads are counted too
+    memory_counters_open();
+
+    // Started before loading so the loader threads' first events are on the timeline
+    trace_path = flag_value(argc, argv, "--trace");
+    if (trace_path) start_trace();
 
     if (!glfwInit()) {
-        printf("Failed to initialize GLFW\n");
+        log_error("Failed to initialize GLFW");
         return -1;
     }
 
     GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Gaussian Splats Renderer", NULL, NULL);
     if (!window) {
-        printf("Failed to create GLFW window\n");
+        log_error("Failed to create GLFW window");
         glfwTerminate();
         return -1;
     }
@@ -74,12 +404,12 @@ int main() {
     glfwMakeContextCurrent(window);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        printf("Failed to initialize GLAD\n");
+        log_error("Failed to initialize GLAD");
         return -1;
     }
 
-    printf("OpenGL version: %s\n", glGetString(GL_VERSION));
-    printf("GLSL version: %s\n", glGetString(GL_SHADING_LANGUAGE_VERSION));
+    log_info("OpenGL version: %s", glGetString(GL_VERSION));
+    log_info("GLSL version: %s", glGetString(GL_SHADING_LANGUAGE_VERSION));
 
     camera_init(&camera);
     camera.position = (vec3){0.0f, 0.0f, 3.0f};
@@ -91,62 +421,295 @@ int main() {
     Renderer renderer;
     init_renderer(&renderer, WIDTH, HEIGHT);
 
-    const char* npz_file_path = "B:\\splats\\data\\SF_6thAndMission_medium0\\train\\depth\\midsize_muscle_02-000.npz";
+    const char* debug_name = flag_value(argc, argv, "--debug");
+    if (debug_name && (debug_mode = debug_mode_from_name(debug_name)) == DEBUG_NONE && strcmp(debug_name, "none") != 0) {
+        log_warn("Unknown debug view %s; use overdraw, tiles, reject or radius.", debug_name);
+    }
+    const char* limit_text = flag_value(argc, argv, "--debug-limit");
+    if (limit_text) debug_limit = atoi(limit_text);
+
+    // Hardware counters around the render stages; without perf access the profiler runs without them
+    if (has_flag(argc, argv, "--perf") && (renderer.profiler.perf = perf_counters_open()) != NULL) {
+        char line[LOG_MESSAGE_SIZE] = "";
+        line_append(line, sizeof(line), "Hardware counters on %d thread(s):", perf_counters_threads(renderer.profiler.perf));
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            if (perf_counters_has(renderer.profiler.perf, (PerfEvent)e)) {
+                line_append(line, sizeof(line), " %s", perf_event_name((PerfEvent)e));
+            }
+        }
+        log_info("%s", line);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--sequence") == 0) {
+        int result = play_sequence(window, &renderer, argv[2]);
+        free_renderer(&renderer);
+        mem_usage_report();
+        finish_trace();
+        glfwTerminate();
+        return result;
+    }
 
-    Splat* splats;
-    int splat_count = load_splats_from_npz(npz_file_path, &splats);
+    bool fuse = argc > 2 && strcmp(argv[1], "--fuse") == 0;
 
-    if (splat_count == 0) {
-        printf("Failed to load splats from %s. Exiting.\n", npz_file_path);
+    // --out-of-core streams a scene that does not fit in memory, within --budget <MiB>
+    if (argc > 1 && has_extension(argv[1], ".splatscene") && has_flag(argc, argv, "--out-of-core")) {
+        int result = play_paged_scene(window, &renderer, argv[1], flag_value(argc, argv, "--budget"));
+        free_renderer(&renderer);
+        mem_usage_report();
+        finish_trace();
         glfwTerminate();
-        return 1;
+        return result;
     }
 
-    printf("Loaded %d splats successfully from %s.\n", splat_count, npz_file_path);
+    // Pre-converted scenes are mapped directly instead of being rebuilt from npz data
+    if (!fuse && argc > 1 && has_extension(argv[1], ".splatscene")) {
+        SceneFile scene;
+        if (!scene_file_open(&scene, argv[1])) {
+            log_error("Failed to open scene %s. Exiting.", argv[1]);
+            free_renderer(&renderer);
+            glfwTerminate();
+            return 1;
+        }
+        log_info("Mapped %zu splats from %s.", scene.arrays.count, argv[1]);
+
+        // --quantized keeps only the compressed copy resident and decodes it per frame
+        bool quantized = argc > 2 && strcmp(argv[2], "--quantized") == 0;
+        QuantizedScene quant;
+        if (quantized) {
+            if (!quant_scene_build(&quant, &scene.arrays)) {
+                scene_file_close(&scene);
+                free_renderer(&renderer);
+                glfwTerminate();
+                return 1;
+            }
+
+            QuantErrorStats error;
+            quant_scene_measure_error(&quant, &scene.arrays, &error);
+            log_info("Quantized scene: %zu bytes (%.1f bytes/splat, %.2fx smaller than Splat)",
+                     quant_scene_bytes(&quant), (double)quant_scene_bytes(&quant) / quant.count,
+                     (double)(quant.count * sizeof(Splat)) / quant_scene_bytes(&quant));
+            log_info("Quantization error: position max %g (bound %g) mean %g, color max %g, scale max %.4f (bound %.4f)",
+                     error.max_position_error, error.position_error_bound, error.mean_position_error,
+                     error.max_color_error, error.max_scale_error, error.scale_error_bound);
+
+            // Rendering reads only the compressed copy from here on
+            scene_file_close(&scene);
+        }
 
-    // Load the corresponding RGB image for the first frame
-    int image_width, image_height, image_channels;
+        while (!glfwWindowShouldClose(window)) {
+            processInput(window, &camera);
 
-    // Extract the base name from the .npz file path to create the RGB image path
-    char rgb_image_path[512];
-    snprintf(rgb_image_path, sizeof(rgb_image_path), 
-            "B:\\splats\\data\\SF_6thAndMission_medium0\\train\\rgb\\%s.png", 
-            "midsize_muscle_02-000");  // Use the correct naming format
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (quantized) {
+                render_scene_quantized(&renderer, &quant, &camera, debug_mode, debug_limit);
+            } else {
+                render_scene_arrays(&renderer, &scene.arrays, &camera, debug_mode, debug_limit);
+            }
+            draw_fullscreen_quad(&renderer);
 
-    unsigned char* rgb_image = load_png_image(rgb_image_path, &image_width, &image_height, &image_channels);
+            present_frame(window, &renderer);
+            glfwPollEvents();
+        }
+        log_stop();
 
-    if (!rgb_image) {
-        printf("Failed to load corresponding RGB image: %s. Exiting.\n", rgb_image_path);
+        if (quantized) {
+            quant_scene_free(&quant);
+        } else {
+            scene_file_close(&scene);
+        }
+        free_renderer(&renderer);
+        mem_usage_report();
+        finish_trace();
         glfwTerminate();
-        return 1;
+        return 0;
+    }
+
+    Splat* splats = NULL;
+    int splat_count = 0;
+    SplatStream* stream = NULL;   // Scene still arriving from the loader thread
+    DecodeCache* cache = NULL;
+    const char* scene_path = NULL;
+
+    // --fuse merges a whole sequence into one static cloud
+    if (fuse) {
+        Dataset dataset;
+        if (dataset_open(&dataset, argv[2])) {
+            float voxel_size = argc > 3 && argv[3][0] != '-' ? (float)atof(argv[3]) : 0.05f;
+            splat_count = fuse_dataset(&dataset, NULL, NULL, voxel_size, &splats);
+        }
+        dataset_free(&dataset);
+        if (splat_count == 0) {
+            log_error("Failed to fuse frames from %s. Exiting.", argv[2]);
+            free_renderer(&renderer);
+            glfwTerminate();
+            return 1;
+        }
+    } else {
+        scene_path = "B:\\splats\\data\\SF_6thAndMission_medium0\\train\\depth\\midsize_muscle_02-000.npz";
+        bool is_ply = argc > 1 && has_extension(argv[1], ".ply");
+
+        // The scene loads on a background thread and is drawn as it arrives, so the first
+        // frame does not wait for decoding however large the scene is
+        if (is_ply) {
+            // PLY assets carry their own colors
+            scene_path = argv[1];
+            stream = splat_stream_open_ply(scene_path);
+        } else {
+            // Extract the base name from the .npz file path to create the RGB image path
+            char rgb_image_path[512];
+            snprintf(rgb_image_path, sizeof(rgb_image_path), 
+                    "B:\\splats\\data\\SF_6thAndMission_medium0\\train\\rgb\\%s.png", 
+                    "midsize_muscle_02-000");  // Use the correct naming format
+
+            // Decoded frames and finished splats are kept on disk, so the next start maps them
+            // instead of inflating the depth map and decoding the image again
+            const char* cache_dir = flag_value(argc, argv, "--cache-dir");
+            cache = has_flag(argc, argv, "--no-cache")
+                        ? NULL : decode_cache_open(cache_dir ? cache_dir : "splat_cache", 0);
+
+            // Splats take their colors from the image while they are built from the depth map;
+            // flat, evenly colored regions are merged into larger splats
+            stream = splat_stream_open_npz(cache, scene_path, rgb_image_path, NULL);
+        }
+
+        if (!stream) {
+            decode_cache_close(cache);
+            free_renderer(&renderer);
+            glfwTerminate();
+            return 1;
+        }
+        log_info("Loading splats from %s in the background.", scene_path);
     }
 
-    printf("Loaded RGB image successfully: %s (Width: %d, Height: %d, Channels: %d)\n",
-        rgb_image_path, image_width, image_height, image_channels);
+    bool replicate = has_flag(argc, argv, "--replicate");
+    NumaReplicas replicas;
+    bool replicated = false;
+    bool placed = false;
+    if (!stream) {
+        Splat* local;
+        if (place_scene(splats, splat_count, replicate, &replicas, &local)) {
+            mem_free(MEM_LOADER, splats);
+            check_loader_released();
+            splats = local;
+            replicated = local == NULL;
+            placed = local != NULL;
+        }
+    }
+
+    // Heap activity of the allocators after the first frame of the complete scene;
+    // steady-state rendering should add none
+    AllocCounters first_frame;
+    bool first_frame_done = false;
+    MemoryCounters memory_start;
+    int frame_count = 0;
+    bool first_presented = false;
+    bool stream_done = false;
+    int result = 0;
 
     while (!glfwWindowShouldClose(window)) {
         processInput(window, &camera);
 
         glClear(GL_COLOR_BUFFER_BIT);
 
+        if (stream) {
+            size_t published;
+            splats = (Splat*)splat_stream_view(stream, &published);
+            splat_count = (int)published;
+
+            if (!stream_done && splat_stream_complete(stream)) {
+                stream_done = true;
+                SplatStreamStats stats;
+                splat_stream_get_stats(stream, &stats);
+                if (stats.failed) {
+                    log_error("Failed to load splats from %s. Exiting.", scene_path);
+                    result = 1;
+                    break;
+                }
+                log_info("Loaded %d splats successfully from %s: first splats after %.1f ms, complete after %.1f ms "
+                         "(%zu pieces).", splat_count, scene_path,
+                         (stats.first_chunk_time - start_time) * 1000.0, (stats.complete_time - start_time) * 1000.0,
+                         stats.chunks);
+                if (cache) {
+                    DecodeCacheStats cache_stats;
+                    decode_cache_get_stats(cache, &cache_stats);
+                    log_info("Decode cache: %zu hits, %zu misses, %zu source bytes hashed.",
+                             cache_stats.hits, cache_stats.misses, cache_stats.hashed_bytes);
+                    decode_cache_close(cache);
+                    cache = NULL;
+                }
+
+                // The stream's buffer was first touched by the loader thread; the placed copy is local to the renderer
+                Splat* local;
+                if (place_scene(splats, splat_count, replicate, &replicas, &local)) {
+                    splat_stream_close(stream);
+                    stream = NULL;
+                    check_loader_released();
+                    splats = local;
+                    replicated = local == NULL;
+                    placed = local != NULL;
+                }
+            }
+        }
+
         // Render splats and apply the RGB texture as needed
-        render_scene(&renderer, splats, splat_count, &camera, DEBUG_NONE, 10);
+        if (replicated) {
+            render_scene_replicated(&renderer, &replicas, splat_count, &camera, debug_mode, debug_limit);
+        } else {
+            render_scene(&renderer, splats, splat_count, &camera, debug_mode, debug_limit);
+        }
+        frame_count++;
+        if (!first_frame_done && (!stream || stream_done)) {
+            alloc_counters_get(&first_frame);
+            memory_counters_read(&memory_start);
+            frame_count = 0;
+            first_frame_done = true;
+        }
 
         draw_fullscreen_quad(&renderer);
 
         GLenum error = glGetError();
         if (error != GL_NO_ERROR) {
-            printf("OpenGL error: 0x%x\n", error);
+            log_error("OpenGL error: 0x%x", error);
         }
 
-        glfwSwapBuffers(window);
+        present_frame(window, &renderer);
+        if (!first_presented) {
+            log_info("First frame after %.1f ms with %d splats.", (platform_time_seconds() - start_time) * 1000.0,
+                     splat_count);
+            first_presented = true;
+        }
         glfwPollEvents();
     }
+    log_stop();   // Writes what the loop queued; from here on messages are synchronous, in order with the reports
+
+    if (first_frame_done) {
+        AllocCounters last_frame;
+        alloc_counters_get(&last_frame);
+        printf("Heap allocations after the first frame: %zu (%zu arena allocations)\n",
+               last_frame.heap_allocations - first_frame.heap_allocations,
+               last_frame.arena_allocations - first_frame.arena_allocations);
+
+        MemoryCounters memory_end;
+        memory_counters_read(&memory_end);
+        memory_counters_report(&memory_start, &memory_end, frame_count);
+    }
+    memory_counters_close();
+    report_profile(&renderer);
 
-    stbi_image_free(rgb_image);  // Free the loaded image memory
     free_renderer(&renderer);
-    free(splats);
+    if (replicated) {
+        numa_replicas_free(&replicas);
+    } else if (placed) {
+        large_free(splats);
+    } else if (!stream) {
+        mem_free(MEM_LOADER, splats);
+    }
+    // Joins the loader before its cache is closed
+    splat_stream_close(stream);
+    decode_cache_close(cache);
+    mem_usage_report();
+    finish_trace();
     glfwTerminate();
 
-    return 0;
+    return result;
 }
@@ -0,0 +1,106 @@
+// File: src/mem_track.c
+#include "mem_track.h"
+#include "platform.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char* subsystem_names[MEM_SUBSYSTEM_COUNT] = {"cnpy", "loader", "scene", "image", "renderer", "arenas"};
+
+// One slot per subsystem plus the total at MEM_SUBSYSTEM_COUNT
+static atomic_size_t current_bytes[MEM_SUBSYSTEM_COUNT + 1];
+static atomic_size_t peak_bytes[MEM_SUBSYSTEM_COUNT + 1];
+static atomic_size_t allocation_count[MEM_SUBSYSTEM_COUNT + 1];
+
+static void raise_peak(int slot, size_t bytes) {
+    size_t now = atomic_fetch_add_explicit(&current_bytes[slot], bytes, memory_order_relaxed) + bytes;
+    size_t peak = atomic_load_explicit(&peak_bytes[slot], memory_order_relaxed);
+    while (now > peak && !atomic_compare_exchange_weak_explicit(&peak_bytes[slot], &peak, now, memory_order_relaxed,
+                                                                memory_order_relaxed)) {
+    }
+}
+
+void mem_track(MemSubsystem subsystem, size_t bytes) {
+    raise_peak(subsystem, bytes);
+    raise_peak(MEM_SUBSYSTEM_COUNT, bytes);
+    atomic_fetch_add_explicit(&allocation_count[subsystem], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&allocation_count[MEM_SUBSYSTEM_COUNT], 1, memory_order_relaxed);
+}
+
+void mem_untrack(MemSubsystem subsystem, size_t bytes) {
+    atomic_fetch_sub_explicit(&current_bytes[subsystem], bytes, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&current_bytes[MEM_SUBSYSTEM_COUNT], bytes, memory_order_relaxed);
+}
+
+void* mem_malloc(MemSubsystem subsystem, size_t size) {
+    void* block = malloc(size);
+    if (block) mem_track(subsystem, platform_heap_block_size(block));
+    return block;
+}
+
+void* mem_calloc(MemSubsystem subsystem, size_t count, size_t size) {
+    void* block = calloc(count, size);
+    if (block) mem_track(subsystem, platform_heap_block_size(block));
+    return block;
+}
+
+void* mem_realloc(MemSubsystem subsystem, void* block, size_t size) {
+    size_t old_size = platform_heap_block_size(block);
+    void* grown = realloc(block, size);
+    if (!grown) return NULL;   // The old block is unchanged and still counted
+    mem_untrack(subsystem, old_size);
+    mem_track(subsystem, platform_heap_block_size(grown));
+    return grown;
+}
+
+void mem_free(MemSubsystem subsystem, void* block) {
+    if (!block) return;
+    mem_untrack(subsystem, platform_heap_block_size(block));
+    free(block);
+}
+
+void mem_adopt(MemSubsystem subsystem, void* block) {
+    if (block) mem_track(subsystem, platform_heap_block_size(block));
+}
+
+static void read_slot(int slot, MemUsage* usage) {
+    usage->current = atomic_load_explicit(&current_bytes[slot], memory_order_relaxed);
+    usage->peak = atomic_load_explicit(&peak_bytes[slot], memory_order_relaxed);
+    usage->allocations = atomic_load_explicit(&allocation_count[slot], memory_order_relaxed);
+}
+
+void mem_usage_get(MemSubsystem subsystem, MemUsage* usage) {
+    read_slot(subsystem, usage);
+}
+
+void mem_usage_total(MemUsage* usage) {
+    read_slot(MEM_SUBSYSTEM_COUNT, usage);
+}
+
+void mem_usage_reset_peaks(void) {
+    for (int slot = 0; slot <= MEM_SUBSYSTEM_COUNT; slot++) {
+        atomic_store_explicit(&peak_bytes[slot], atomic_load_explicit(&current_bytes[slot], memory_order_relaxed),
+                              memory_order_relaxed);
+    }
+}
+
+const char* mem_subsystem_name(MemSubsystem subsystem) {
+    return subsystem >= 0 && subsystem < MEM_SUBSYSTEM_COUNT ? subsystem_names[subsystem] : "unknown";
+}
+
+static void print_usage_line(const char* name, const MemUsage* usage) {
+    printf("    %-10s %10.2f MiB now, %10.2f MiB peak, %zu allocations\n", name, usage->current / (1024.0 * 1024.0),
+           usage->peak / (1024.0 * 1024.0), usage->allocations);
+}
+
+void mem_usage_report(void) {
+    printf("Tracked memory by subsystem:\n");
+    for (int subsystem = 0; subsystem < MEM_SUBSYSTEM_COUNT; subsystem++) {
+        MemUsage usage;
+        mem_usage_get((MemSubsystem)subsystem, &usage);
+        print_usage_line(subsystem_names[subsystem], &usage);
+    }
+    MemUsage total;
+    mem_usage_total(&total);
+    print_usage_line("total", &total);
+}
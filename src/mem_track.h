@@ -0,0 +1,59 @@
+#ifndef MEM_TRACK_H
+#define MEM_TRACK_H
+
+#include <stddef.h>
+
+// Owners of the heap memory that is counted
+typedef enum {
+    MEM_CNPY = 0,       // npy headers, npz directories and arrays
+    MEM_LOADER,         // Splat arrays and decoded depth and color frames (CachedData.owned)
+    MEM_SCENE,          // Placed and replicated scene copies in large pages (numa.h)
+    MEM_IMAGE,          // stb_image decode buffers
+    MEM_RENDERER,       // Framebuffer, depth buffer and frame arena
+    MEM_ARENAS,         // Scratch arenas and buffer pools
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+typedef struct {
+    size_t current;       // Bytes held now
+    size_t peak;          // Most bytes held at once since start or the last mem_usage_reset_peaks
+    size_t allocations;   // Blocks counted since start
+} MemUsage;
+
+/**
+ * Byte counters per subsystem, kept by wrappers around the heap functions.
+ *
+ * A block is counted at its usable size (malloc_usable_size, _msize), so the
+ * counters follow what the heap really hands out and a block does not carry
+ * a header. Blocks therefore stay compatible with plain free(): a block freed
+ * that way is simply never subtracted. Memory that does not come from these
+ * wrappers (mapped buffers, arena blocks) is added with mem_track.
+ *
+ * The counters are relaxed atomics, safe from any thread.
+ */
+void* mem_malloc(MemSubsystem subsystem, size_t size);
+void* mem_calloc(MemSubsystem subsystem, size_t count, size_t size);
+void* mem_realloc(MemSubsystem subsystem, void* block, size_t size);
+void mem_free(MemSubsystem subsystem, void* block);
+
+// Counts a block from plain malloc, e.g. one returned by another module; release it with mem_free
+void mem_adopt(MemSubsystem subsystem, void* block);
+
+// Counts memory allocated some other way, in bytes
+void mem_track(MemSubsystem subsystem, size_t bytes);
+void mem_untrack(MemSubsystem subsystem, size_t bytes);
+
+void mem_usage_get(MemSubsystem subsystem, MemUsage* usage);
+
+// Sum over every subsystem; the peak is of the sum, not a sum of peaks
+void mem_usage_total(MemUsage* usage);
+
+// Restarts every peak from the current bytes, e.g. to measure one load
+void mem_usage_reset_peaks(void);
+
+const char* mem_subsystem_name(MemSubsystem subsystem);
+
+// Prints current and peak bytes of every subsystem
+void mem_usage_report(void);
+
+#endif // MEM_TRACK_H
@@ -0,0 +1,359 @@
+// File: src/numa.c
+#include "numa.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>        // For OpenMP parallelization
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601  // GetCurrentProcessorNumberEx and GetNumaProcessorNodeEx
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+#define LARGE_HEADER_SIZE 64
+#define COPY_CHUNK ((size_t)1 << 20)
+
+// Stored in front of every large allocation
+typedef struct {
+    void* base;              // Start of the OS mapping
+    size_t length;           // Length of the OS mapping
+    LargePageKind kind;
+    MemSubsystem subsystem;  // Where length is counted
+} LargeHeader;
+
+_Static_assert(sizeof(LargeHeader) <= LARGE_HEADER_SIZE, "large allocation header must fit its slot");
+
+static size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef _WIN32
+
+static void* map_pages(size_t size, int node, LargePageKind* kind, size_t* length) {
+    DWORD type = MEM_RESERVE | MEM_COMMIT;
+    HANDLE process = GetCurrentProcess();
+
+    // Large pages need SeLockMemoryPrivilege; without it the call fails and regular pages are used
+    size_t large_page = GetLargePageMinimum();
+    if (large_page && size >= large_page / 2) {
+        size_t large_length = round_up(size, large_page);
+        void* memory = node >= 0
+            ? VirtualAllocExNuma(process, NULL, large_length, type | MEM_LARGE_PAGES, PAGE_READWRITE, (DWORD)node)
+            : VirtualAlloc(NULL, large_length, type | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (memory) {
+            *kind = PAGES_EXPLICIT;
+            *length = large_length;
+            return memory;
+        }
+    }
+
+    *length = size;
+    *kind = PAGES_SMALL;
+    return node >= 0 ? VirtualAllocExNuma(process, NULL, size, type, PAGE_READWRITE, (DWORD)node)
+                     : VirtualAlloc(NULL, size, type, PAGE_READWRITE);
+}
+
+static void unmap_pages(void* base, size_t length) {
+    (void)length;
+    VirtualFree(base, 0, MEM_RELEASE);
+}
+
+int numa_node_count(void) {
+    static int node_count;
+    if (!node_count) {
+        ULONG highest = 0;
+        node_count = GetNumaHighestNodeNumber(&highest) ? (int)highest + 1 : 1;
+        if (node_count > NUMA_MAX_NODES) node_count = NUMA_MAX_NODES;
+    }
+    return node_count;
+}
+
+int numa_current_node(void) {
+    PROCESSOR_NUMBER processor;
+    USHORT node = 0;
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node)) return 0;
+    return node < numa_node_count() ? (int)node : 0;
+}
+
+#else
+
+#define MPOL_BIND_MODE 2   // MPOL_BIND from <numaif.h>, which needs libnuma headers
+
+// Restricts the mapping's pages to one node; must happen before the pages are touched
+static bool bind_to_node(void* address, size_t length, int node) {
+#ifdef SYS_mbind
+    unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    mask[node / (8 * sizeof(unsigned long))] |= 1ul << (node % (8 * sizeof(unsigned long)));
+    return syscall(SYS_mbind, address, length, MPOL_BIND_MODE, mask, (unsigned long)NUMA_MAX_NODES + 1, 0) == 0;
+#else
+    (void)address; (void)length; (void)node;
+    return false;
+#endif
+}
+
+static void* map_pages(size_t size, int node, LargePageKind* kind, size_t* length) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* memory = MAP_FAILED;
+
+    if (size >= HUGE_PAGE_SIZE / 2) {
+        *length = round_up(size, HUGE_PAGE_SIZE);
+
+#ifdef MAP_HUGETLB
+        // Fails immediately unless huge pages are reserved in /proc/sys/vm/nr_hugepages
+        memory = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+        *kind = PAGES_EXPLICIT;
+#endif
+
+        if (memory == MAP_FAILED) {
+            // Over-map and trim so the region starts on a huge page boundary
+            char* raw = (char*)mmap(NULL, *length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (raw == MAP_FAILED) return NULL;
+            char* aligned = (char*)round_up((size_t)raw, HUGE_PAGE_SIZE);
+            if (aligned > raw) munmap(raw, (size_t)(aligned - raw));
+            size_t tail = (size_t)(raw + *length + HUGE_PAGE_SIZE - (aligned + *length));
+            if (tail) munmap(aligned + *length, tail);
+            memory = aligned;
+
+#ifdef MADV_HUGEPAGE
+            *kind = madvise(memory, *length, MADV_HUGEPAGE) == 0 ? PAGES_TRANSPARENT : PAGES_SMALL;
+#else
+            *kind = PAGES_SMALL;
+#endif
+        }
+    } else {
+        *length = round_up(size, (size_t)sysconf(_SC_PAGESIZE));
+        memory = mmap(NULL, *length, PROT_READ | PROT_WRITE, flags, -1, 0);
+        *kind = PAGES_SMALL;
+        if (memory == MAP_FAILED) return NULL;
+    }
+
+    if (node >= 0 && numa_node_count() > 1 && !bind_to_node(memory, *length, node)) {
+        log_warn("Could not bind %zu bytes to NUMA node %d.", *length, node);
+    }
+    return memory;
+}
+
+static void unmap_pages(void* base, size_t length) {
+    munmap(base, length);
+}
+
+int numa_node_count(void) {
+    static int node_count;
+    if (!node_count) {
+        // Node directories may be sparse; the highest one present decides the count
+        node_count = 1;
+        for (int node = 1; node < NUMA_MAX_NODES; node++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", node);
+            if (access(path, F_OK) == 0) node_count = node + 1;
+        }
+    }
+    return node_count;
+}
+
+int numa_current_node(void) {
+#ifdef SYS_getcpu
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < (unsigned)numa_node_count()) return (int)node;
+#endif
+    return 0;
+}
+
+#endif
+
+// node < 0 leaves placement to first touch
+static void* large_alloc_on(MemSubsystem subsystem, size_t size, int node) {
+    LargePageKind kind;
+    size_t length;
+    void* base = map_pages(size + LARGE_HEADER_SIZE, node, &kind, &length);
+    if (!base) {
+        log_error("Failed to map %zu bytes of large memory.", size);
+        return NULL;
+    }
+
+    LargeHeader* header = (LargeHeader*)base;
+    header->base = base;
+    header->length = length;
+    header->kind = kind;
+    header->subsystem = subsystem;
+    mem_track(subsystem, length);
+    return (char*)base + LARGE_HEADER_SIZE;
+}
+
+static LargeHeader* header_of(const void* memory) {
+    return (LargeHeader*)((char*)memory - LARGE_HEADER_SIZE);
+}
+
+void* large_alloc(MemSubsystem subsystem, size_t size) {
+    return large_alloc_on(subsystem, size, -1);
+}
+
+void large_free(void* memory) {
+    if (!memory) return;
+    LargeHeader* header = header_of(memory);
+    mem_untrack(header->subsystem, header->length);
+    unmap_pages(header->base, header->length);
+}
+
+LargePageKind large_page_kind(const void* memory) {
+    return memory ? header_of(memory)->kind : PAGES_SMALL;
+}
+
+void* numa_place_copy(MemSubsystem subsystem, const void* data, size_t element_size, size_t count,
+                      size_t block_elements) {
+    size_t size = element_size * count;
+    char* copy = (char*)large_alloc(subsystem, size ? size : 1);
+    if (!copy) return NULL;
+
+    if (block_elements == 0) block_elements = 1;
+    long long block_count = (long long)((count + block_elements - 1) / block_elements);
+    size_t block_bytes = block_elements * element_size;
+
+    #pragma omp parallel for schedule(static)
+    for (long long block = 0; block < block_count; block++) {
+        size_t offset = (size_t)block * block_bytes;
+        size_t bytes = offset + block_bytes <= size ? block_bytes : size - offset;
+        memcpy(copy + offset, (const char*)data + offset, bytes);
+    }
+    return copy;
+}
+
+bool numa_replicas_create(NumaReplicas* replicas, MemSubsystem subsystem, const void* data, size_t size) {
+    memset(replicas, 0, sizeof(*replicas));
+    replicas->node_count = numa_node_count();
+    replicas->size = size;
+
+    long long chunk_count = (long long)((size + COPY_CHUNK - 1) / COPY_CHUNK);
+    for (int node = 0; node < replicas->node_count; node++) {
+        // The node policy is set before any page is touched, so the parallel copy cannot misplace pages
+        char* copy = (char*)large_alloc_on(subsystem, size ? size : 1, replicas->node_count > 1 ? node : -1);
+        if (!copy) {
+            numa_replicas_free(replicas);
+            return false;
+        }
+
+        #pragma omp parallel for schedule(static)
+        for (long long chunk = 0; chunk < chunk_count; chunk++) {
+            size_t offset = (size_t)chunk * COPY_CHUNK;
+            size_t bytes = offset + COPY_CHUNK <= size ? COPY_CHUNK : size - offset;
+            memcpy(copy + offset, (const char*)data + offset, bytes);
+        }
+        replicas->copies[node] = copy;
+    }
+    return true;
+}
+
+void numa_replicas_free(NumaReplicas* replicas) {
+    for (int node = 0; node < NUMA_MAX_NODES; node++) {
+        large_free(replicas->copies[node]);
+        replicas->copies[node] = NULL;
+    }
+    replicas->node_count = 0;
+}
+
+const void* numa_replicas_local(const NumaReplicas* replicas) {
+    const void* local = replicas->copies[numa_current_node()];
+    return local ? local : replicas->copies[0];
+}
+
+#ifdef _WIN32
+
+void memory_counters_open(void) {}
+void memory_counters_close(void) {}
+
+void memory_counters_read(MemoryCounters* counters) {
+    memset(counters, 0, sizeof(*counters));
+}
+
+#else
+
+static int tlb_fd = -1;
+static int remote_fd = -1;
+
+// Counts the calling thread and every thread it creates afterwards
+static int open_cache_counter(unsigned cache, unsigned op, unsigned result) {
+#ifdef SYS_perf_event_open
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (op << 8) | (result << 16);
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    (void)cache; (void)op; (void)result;
+    return -1;
+#endif
+}
+
+void memory_counters_open(void) {
+    if (tlb_fd < 0) tlb_fd = open_cache_counter(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+    if (remote_fd < 0) remote_fd = open_cache_counter(PERF_COUNT_HW_CACHE_NODE, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS);
+}
+
+void memory_counters_close(void) {
+    if (tlb_fd >= 0) close(tlb_fd);
+    if (remote_fd >= 0) close(remote_fd);
+    tlb_fd = remote_fd = -1;
+}
+
+static bool read_counter(int fd, uint64_t* value) {
+    return fd >= 0 && read(fd, value, sizeof(*value)) == (ssize_t)sizeof(*value);
+}
+
+void memory_counters_read(MemoryCounters* counters) {
+    memset(counters, 0, sizeof(*counters));
+    counters->has_tlb = read_counter(tlb_fd, &counters->dtlb_load_misses);
+    counters->has_remote = read_counter(remote_fd, &counters->remote_loads);
+
+    FILE* vmstat = fopen("/proc/vmstat", "r");
+    if (!vmstat) return;
+    char name[64];
+    unsigned long long value;
+    while (fscanf(vmstat, "%63s %llu", name, &value) == 2) {
+        if (strcmp(name, "numa_local") == 0) {
+            counters->numa_local_pages = value;
+            counters->has_vmstat = true;
+        } else if (strcmp(name, "numa_other") == 0) {
+            counters->numa_remote_pages = value;
+        } else if (strcmp(name, "thp_fault_alloc") == 0) {
+            counters->thp_faults = value;
+        }
+    }
+    fclose(vmstat);
+}
+
+#endif
+
+void memory_counters_report(const MemoryCounters* before, const MemoryCounters* after, int frames) {
+    double per_frame = frames > 0 ? 1.0 / frames : 1.0;
+    if (before->has_tlb && after->has_tlb) {
+        printf("dTLB load misses per frame: %.0f\n", (after->dtlb_load_misses - before->dtlb_load_misses) * per_frame);
+    } else {
+        printf("dTLB load misses: unavailable (no perf counter access)\n");
+    }
+    if (before->has_remote && after->has_remote) {
+        printf("Remote node loads per frame: %.0f\n", (after->remote_loads - before->remote_loads) * per_frame);
+    } else {
+        printf("Remote node loads: unavailable (no perf counter access)\n");
+    }
+    if (before->has_vmstat && after->has_vmstat) {
+        printf("Page allocations (system-wide): %llu local, %llu remote, %llu transparent huge page faults\n",
+               (unsigned long long)(after->numa_local_pages - before->numa_local_pages),
+               (unsigned long long)(after->numa_remote_pages - before->numa_remote_pages),
+               (unsigned long long)(after->thp_faults - before->thp_faults));
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "mem_track.h"
+
+#define NUMA_MAX_NODES 64
+
+// Page size that backs a large allocation
+typedef enum {
+    PAGES_SMALL = 0,         // Regular pages
+    PAGES_TRANSPARENT = 1,   // Regular mapping advised for transparent huge pages (Linux)
+    PAGES_EXPLICIT = 2       // Reserved huge pages (Linux hugetlbfs pool, Windows large pages)
+} LargePageKind;
+
+/**
+ * @brief Allocates a large buffer directly from the OS, backed by huge pages where possible.
+ *
+ * Explicit huge pages are tried first and silently fall back to transparent
+ * huge pages, then to regular pages. The memory is reserved but not touched:
+ * each page lands on the NUMA node of the thread that first writes it, so
+ * callers should initialize the buffer with the same thread partitioning that
+ * later reads it. The returned pointer is 64-byte aligned. The whole mapping
+ * is counted against subsystem until large_free.
+ *
+ * @return The buffer, or NULL on failure. Release with large_free.
+ */
+void* large_alloc(MemSubsystem subsystem, size_t size);
+void large_free(void* memory);
+LargePageKind large_page_kind(const void* memory);
+
+// Number of NUMA nodes of the machine (1 when unknown) and the node the calling thread runs on
+int numa_node_count(void);
+int numa_current_node(void);
+
+/**
+ * @brief Copies an array into large_alloc memory with parallel first touch.
+ *
+ * The array is split into blocks of block_elements and copied with an OpenMP
+ * static schedule, so each block is first touched by the thread that reads it
+ * when the consumer loops over the same blocks with schedule(static) and the
+ * same thread count. With OMP_PROC_BIND set, the pages then stay local.
+ *
+ * @return The copy (release with large_free), or NULL on failure.
+ */
+void* numa_place_copy(MemSubsystem subsystem, const void* data, size_t element_size, size_t count,
+                      size_t block_elements);
+
+/**
+ * Read-only copies of one array, one per NUMA node, so that every thread reads
+ * scene data from its own socket's memory. Memory use grows with the node count.
+ */
+typedef struct {
+    void* copies[NUMA_MAX_NODES];
+    int node_count;
+    size_t size;
+} NumaReplicas;
+
+// Every copy is counted against subsystem until numa_replicas_free
+bool numa_replicas_create(NumaReplicas* replicas, MemSubsystem subsystem, const void* data, size_t size);
+void numa_replicas_free(NumaReplicas* replicas);
+
+// The copy on the calling thread's node
+const void* numa_replicas_local(const NumaReplicas* replicas);
+
+/**
+ * Process-wide memory system counters for reporting deltas around a workload.
+ * Values that the platform or permissions do not provide are marked invalid.
+ */
+typedef struct {
+    bool has_tlb;
+    bool has_remote;
+    bool has_vmstat;
+    uint64_t dtlb_load_misses;     // Data TLB load misses of all threads
+    uint64_t remote_loads;         // Loads served from another node's memory (node-load-misses)
+    uint64_t numa_local_pages;     // System-wide page allocations on the local node (/proc/vmstat numa_local)
+    uint64_t numa_remote_pages;    // System-wide page allocations on a remote node (numa_other)
+    uint64_t thp_faults;           // Transparent huge pages allocated on fault (thp_fault_alloc)
+} MemoryCounters;
+
+// Opens the hardware counters; call before the first OpenMP parallel region so worker threads are counted
+void memory_counters_open(void);
+void memory_counters_close(void);
+void memory_counters_read(MemoryCounters* counters);
+
+// Prints the differences between two readings, divided by the number of frames in between
+void memory_counters_report(const MemoryCounters* before, const MemoryCounters* after, int frames);
+
+#endif // NUMA_H
@@ -0,0 +1,488 @@
+// File: src/paged_scene.c
+#include "paged_scene.h"
+#include "scene_file.h"
+#include "platform.h"
+#include "trace.h"
+#include "log.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGED_DEFAULT_PREFETCH_SECONDS 0.5f
+#define PAGED_DEFAULT_ASPECT (4.0f / 3.0f)
+#define PAGED_LOD_BATCH 1024   // Chunks of coarse records converted per read at open
+
+// A slot holding one full-resolution chunk
+typedef struct {
+    int chunk;                 // Chunk held, -1 when free
+    bool loading;              // Being filled by the loader; not drawable yet
+    unsigned long long last_used;  // Last frame that drew the chunk
+    float* attributes[SCENE_ATTRIBUTE_COUNT];
+    SplatArrays view;
+} ChunkSlot;
+
+// A chunk selected by the visibility pass
+typedef struct {
+    int chunk;
+    float distance;
+} ChunkCandidate;
+
+struct PagedScene {
+    PlatformFile file;
+    SceneFileHeader header;
+    SceneChunk* chunks;
+    size_t chunk_count;
+    float* margins;            // Per chunk: how far splats may reach outside the box
+
+    // Coarse level of detail, always resident, as attribute arrays
+    float* lod_storage;
+    SplatArrays* lod_views;
+
+    float* slot_storage;
+    ChunkSlot* slots;
+    size_t slot_count;
+    int* chunk_slot;           // Slot of each chunk, -1 when not loaded or loading
+
+    SplatArrays* draw_list;
+    ChunkCandidate* candidates;
+    float aspect_ratio;
+    float prefetch_seconds;
+
+    // Camera motion for the prefetch
+    vec3 last_position;
+    double last_time;
+    vec3 velocity;
+    bool has_motion;
+
+    // Shared with the loader thread, guarded by mutex
+    PlatformMutex mutex;
+    PlatformCond cond;
+    PlatformThread thread;
+    bool thread_started;
+    bool stopping;
+    int* requests;
+    size_t request_count;
+    size_t request_next;
+    unsigned long long frame;
+    PagedSceneStats stats;
+};
+
+static void free_scene(PagedScene* scene) {
+    platform_file_close(&scene->file);
+    free(scene->chunks);
+    free(scene->margins);
+    free(scene->lod_storage);
+    free(scene->lod_views);
+    free(scene->slot_storage);
+    free(scene->slots);
+    free(scene->chunk_slot);
+    free(scene->draw_list);
+    free(scene->candidates);
+    free(scene->requests);
+    free(scene);
+}
+
+static void set_view(SplatArrays* view, float* const attributes[SCENE_ATTRIBUTE_COUNT], size_t count) {
+    view->x = attributes[SCENE_SECTION_X];
+    view->y = attributes[SCENE_SECTION_Y];
+    view->z = attributes[SCENE_SECTION_Z];
+    view->dx = attributes[SCENE_SECTION_DX];
+    view->dy = attributes[SCENE_SECTION_DY];
+    view->dz = attributes[SCENE_SECTION_DZ];
+    view->r = attributes[SCENE_SECTION_R];
+    view->g = attributes[SCENE_SECTION_G];
+    view->b = attributes[SCENE_SECTION_B];
+    view->a = attributes[SCENE_SECTION_A];
+    view->scale = attributes[SCENE_SECTION_SCALE];
+    view->count = count;
+}
+
+// Reads the coarse records and regroups them into per-chunk attribute arrays
+static bool load_coarse_level(PagedScene* scene) {
+    size_t records = scene->chunk_count * SCENE_LOD_PER_CHUNK;
+    scene->lod_storage = (float*)malloc(records * SCENE_ATTRIBUTE_COUNT * sizeof(float));
+    scene->lod_views = (SplatArrays*)calloc(scene->chunk_count, sizeof(SplatArrays));
+    Splat* batch = (Splat*)malloc(PAGED_LOD_BATCH * SCENE_LOD_PER_CHUNK * sizeof(Splat));
+    if (!scene->lod_storage || !scene->lod_views || !batch) {
+        log_error("Failed to allocate memory for the coarse level of detail.");
+        free(batch);
+        return false;
+    }
+
+    uint64_t offset = scene->header.sections[SCENE_SECTION_LOD].offset;
+    for (size_t first = 0; first < scene->chunk_count; first += PAGED_LOD_BATCH) {
+        size_t count = scene->chunk_count - first < PAGED_LOD_BATCH ? scene->chunk_count - first : PAGED_LOD_BATCH;
+        size_t bytes = count * SCENE_LOD_PER_CHUNK * sizeof(Splat);
+        if (!platform_file_read_at(&scene->file, offset + first * SCENE_LOD_PER_CHUNK * sizeof(Splat), batch, bytes)) {
+            log_error("Failed to read the coarse level of detail.");
+            free(batch);
+            return false;
+        }
+
+        for (size_t c = 0; c < count; c++) {
+            size_t chunk = first + c;
+            float* attributes[SCENE_ATTRIBUTE_COUNT];
+            for (int a = 0; a < SCENE_ATTRIBUTE_COUNT; a++) {
+                attributes[a] = scene->lod_storage + (size_t)a * records + chunk * SCENE_LOD_PER_CHUNK;
+            }
+
+            // Records after the chunk's last run have zero opacity
+            const Splat* lod = batch + c * SCENE_LOD_PER_CHUNK;
+            size_t runs = 0;
+            float margin = 0.0f;
+            while (runs < SCENE_LOD_PER_CHUNK && lod[runs].a > 0.0f) {
+                const Splat* s = &lod[runs];
+                const float values[SCENE_ATTRIBUTE_COUNT] = { s->x, s->y, s->z, s->dx, s->dy, s->dz, s->r, s->g, s->b, s->a, s->scale };
+                for (int a = 0; a < SCENE_ATTRIBUTE_COUNT; a++) attributes[a][runs] = values[a];
+                if (s->scale > margin) margin = s->scale;
+                runs++;
+            }
+            set_view(&scene->lod_views[chunk], attributes, runs);
+            scene->margins[chunk] = margin;
+        }
+    }
+
+    free(batch);
+    return true;
+}
+
+static bool read_chunk(PagedScene* scene, int chunk, ChunkSlot* slot) {
+    const SceneChunk* info = &scene->chunks[chunk];
+    for (int a = 0; a < SCENE_ATTRIBUTE_COUNT; a++) {
+        uint64_t offset = scene->header.sections[a].offset + (uint64_t)info->first * sizeof(float);
+        if (!platform_file_read_at(&scene->file, offset, slot->attributes[a], info->count * sizeof(float))) {
+            log_error("Failed to read chunk %d of the scene.", chunk);
+            return false;
+        }
+    }
+    slot->view.count = info->count;
+    return true;
+}
+
+// A free slot, or the least recently drawn one that the current frame does not use. Called with the mutex held.
+static int pick_slot(PagedScene* scene) {
+    int best = -1;
+    for (size_t i = 0; i < scene->slot_count; i++) {
+        const ChunkSlot* slot = &scene->slots[i];
+        if (slot->chunk < 0) return (int)i;
+        if (slot->loading || slot->last_used >= scene->frame) continue;
+        if (best < 0 || slot->last_used < scene->slots[best].last_used) best = (int)i;
+    }
+    return best;
+}
+
+static void loader_main(void* arg) {
+    PagedScene* scene = (PagedScene*)arg;
+    trace_set_thread_name("chunk loader");
+
+    platform_mutex_lock(&scene->mutex);
+    while (!scene->stopping) {
+        if (scene->request_next == scene->request_count) {
+            platform_cond_wait(&scene->cond, &scene->mutex);
+            continue;
+        }
+
+        int chunk = scene->requests[scene->request_next++];
+        if (scene->chunk_slot[chunk] >= 0) continue;
+
+        // With every slot in view, the chunk stays on the coarse level until the view changes
+        int index = pick_slot(scene);
+        if (index < 0) continue;
+
+        ChunkSlot* slot = &scene->slots[index];
+        if (slot->chunk >= 0) {
+            scene->chunk_slot[slot->chunk] = -1;
+            scene->stats.evictions++;
+            scene->stats.resident--;
+        }
+        slot->chunk = chunk;
+        slot->loading = true;
+        scene->chunk_slot[chunk] = index;
+
+        platform_mutex_unlock(&scene->mutex);
+        trace_begin("read chunk");
+        bool ok = read_chunk(scene, chunk, slot);
+        trace_end("read chunk");
+        platform_mutex_lock(&scene->mutex);
+
+        slot->loading = false;
+        slot->last_used = scene->frame;
+        if (ok) {
+            scene->stats.loads++;
+            scene->stats.resident++;
+            scene->stats.bytes_read += (size_t)scene->chunks[chunk].count * SCENE_ATTRIBUTE_COUNT * sizeof(float);
+        } else {
+            slot->chunk = -1;
+            scene->chunk_slot[chunk] = -1;
+        }
+    }
+    platform_mutex_unlock(&scene->mutex);
+}
+
+PagedScene* paged_scene_open(const char* path, const PagedSceneOptions* options) {
+    PagedScene* scene = (PagedScene*)calloc(1, sizeof(PagedScene));
+    if (!scene) return NULL;
+    if (!platform_file_open(&scene->file, path)) {
+        free(scene);
+        return NULL;
+    }
+
+    SceneFileHeader* header = &scene->header;
+    if (!platform_file_read_at(&scene->file, 0, header, sizeof(*header)) ||
+        memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != SCENE_FILE_VERSION || header->header_size != sizeof(SceneFileHeader)) {
+        log_error("%s is not a supported splat scene file", path);
+        free_scene(scene);
+        return NULL;
+    }
+
+    // The count comes from the file; bounding it keeps the section size products from wrapping
+    uint64_t attribute_size = header->splat_count * sizeof(float);
+    bool ok = header->splat_count <= SCENE_FILE_MAX_SPLATS &&
+              header->sections[SCENE_SECTION_CHUNKS].size == (uint64_t)header->chunk_count * sizeof(SceneChunk);
+    for (int a = 0; ok && a < SCENE_ATTRIBUTE_COUNT; a++) {
+        ok = header->sections[a].size == attribute_size && header->sections[a].offset <= scene->file.size &&
+             attribute_size <= scene->file.size - header->sections[a].offset;
+    }
+    if (!ok) {
+        log_error("Corrupt section table in scene file %s", path);
+        free_scene(scene);
+        return NULL;
+    }
+
+    scene->chunk_count = header->chunk_count;
+    scene->chunks = (SceneChunk*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(SceneChunk));
+    scene->margins = (float*)calloc(scene->chunk_count ? scene->chunk_count : 1, sizeof(float));
+    scene->chunk_slot = (int*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(int));
+    scene->draw_list = (SplatArrays*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(SplatArrays));
+    scene->candidates = (ChunkCandidate*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(ChunkCandidate));
+    scene->requests = (int*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(int));
+    if (!scene->chunks || !scene->margins || !scene->chunk_slot || !scene->draw_list || !scene->candidates || !scene->requests ||
+        !platform_file_read_at(&scene->file, header->sections[SCENE_SECTION_CHUNKS].offset, scene->chunks,
+                               scene->chunk_count * sizeof(SceneChunk))) {
+        log_error("Failed to read the chunk table of %s", path);
+        free_scene(scene);
+        return NULL;
+    }
+
+    size_t max_chunk = 0;
+    for (size_t c = 0; c < scene->chunk_count; c++) {
+        const SceneChunk* chunk = &scene->chunks[c];
+        if ((uint64_t)chunk->first + chunk->count > header->splat_count) {
+            log_error("Corrupt chunk table in scene file %s", path);
+            free_scene(scene);
+            return NULL;
+        }
+        if (chunk->count > max_chunk) max_chunk = chunk->count;
+        scene->chunk_slot[c] = -1;
+    }
+
+    bool has_lod = (header->flags & SCENE_FLAG_COARSE_LOD) &&
+                   header->sections[SCENE_SECTION_LOD].size == (uint64_t)scene->chunk_count * SCENE_LOD_PER_CHUNK * sizeof(Splat);
+    if (has_lod && !load_coarse_level(scene)) {
+        free_scene(scene);
+        return NULL;
+    }
+    if (!has_lod) {
+        log_warn("%s has no coarse level of detail; chunks appear only once loaded.", path);
+    }
+
+    // Every slot holds the largest chunk
+    size_t budget = options && options->memory_budget ? options->memory_budget : PAGED_DEFAULT_BUDGET;
+    size_t slot_floats = (max_chunk ? max_chunk : 1) * SCENE_ATTRIBUTE_COUNT;
+    scene->slot_count = budget / (slot_floats * sizeof(float));
+    if (scene->slot_count == 0) scene->slot_count = 1;
+    if (scene->slot_count > scene->chunk_count) scene->slot_count = scene->chunk_count ? scene->chunk_count : 1;
+
+    scene->slot_storage = (float*)malloc(scene->slot_count * slot_floats * sizeof(float));
+    scene->slots = (ChunkSlot*)calloc(scene->slot_count, sizeof(ChunkSlot));
+    if (!scene->slot_storage || !scene->slots) {
+        log_error("Failed to allocate %zu chunk slots.", scene->slot_count);
+        free_scene(scene);
+        return NULL;
+    }
+    for (size_t i = 0; i < scene->slot_count; i++) {
+        ChunkSlot* slot = &scene->slots[i];
+        slot->chunk = -1;
+        for (int a = 0; a < SCENE_ATTRIBUTE_COUNT; a++) {
+            slot->attributes[a] = scene->slot_storage + i * slot_floats + (size_t)a * max_chunk;
+        }
+        set_view(&slot->view, slot->attributes, 0);
+    }
+
+    scene->aspect_ratio = options && options->aspect_ratio > 0.0f ? options->aspect_ratio : PAGED_DEFAULT_ASPECT;
+    scene->prefetch_seconds = options && options->prefetch_seconds != 0.0f ? options->prefetch_seconds
+                                                                           : PAGED_DEFAULT_PREFETCH_SECONDS;
+    scene->stats.chunk_count = scene->chunk_count;
+    scene->stats.slot_count = scene->slot_count;
+    scene->frame = 1;
+
+    platform_mutex_init(&scene->mutex);
+    platform_cond_init(&scene->cond);
+    if (!platform_thread_create(&scene->thread, loader_main, scene)) {
+        log_error("Failed to start the chunk loader thread.");
+        paged_scene_close(scene);
+        return NULL;
+    }
+    scene->thread_started = true;
+
+    log_info("Paging %zu chunks through %zu slots (%.1f MiB budget, %s coarse level).", scene->chunk_count,
+           scene->slot_count, scene->slot_count * slot_floats * sizeof(float) / (1024.0 * 1024.0),
+           has_lod ? "with" : "no");
+    return scene;
+}
+
+void paged_scene_close(PagedScene* scene) {
+    if (!scene) return;
+    if (scene->thread_started) {
+        platform_mutex_lock(&scene->mutex);
+        scene->stopping = true;
+        platform_cond_broadcast(&scene->cond);
+        platform_mutex_unlock(&scene->mutex);
+        platform_thread_join(scene->thread);
+    }
+    platform_cond_destroy(&scene->cond);
+    platform_mutex_destroy(&scene->mutex);
+    free_scene(scene);
+}
+
+// Frustum test of the box grown by margin, matching the renderer's 90 degree vertical field of view
+static bool chunk_visible(const PagedScene* scene, const SceneChunk* chunk, float margin, vec3 position, const Camera* camera) {
+    const float fov_tan = 1.0f;  // tan(45 degrees)
+    float center[3], extent[3];
+    for (int axis = 0; axis < 3; axis++) {
+        center[axis] = 0.5f * (chunk->min[axis] + chunk->max[axis]);
+        extent[axis] = 0.5f * (chunk->max[axis] - chunk->min[axis]) + margin;
+    }
+
+    // Inward normals of the near, left, right, bottom and top planes through the camera position
+    float h = fov_tan * scene->aspect_ratio, v = fov_tan;
+    const vec3 f = camera->front, r = camera->right, u = camera->up;
+    const vec3 normals[5] = {
+        f,
+        { f.x * h + r.x, f.y * h + r.y, f.z * h + r.z },
+        { f.x * h - r.x, f.y * h - r.y, f.z * h - r.z },
+        { f.x * v + u.x, f.y * v + u.y, f.z * v + u.z },
+        { f.x * v - u.x, f.y * v - u.y, f.z * v - u.z },
+    };
+
+    for (int p = 0; p < 5; p++) {
+        const vec3 n = normals[p];
+        float distance = n.x * (center[0] - position.x) + n.y * (center[1] - position.y) + n.z * (center[2] - position.z);
+        float reach = fabsf(n.x) * extent[0] + fabsf(n.y) * extent[1] + fabsf(n.z) * extent[2];
+        if (distance + reach < 0.0f) return false;
+    }
+    return true;
+}
+
+static int compare_candidates(const void* a, const void* b) {
+    float da = ((const ChunkCandidate*)a)->distance, db = ((const ChunkCandidate*)b)->distance;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// Visible chunks from position, nearest first
+static size_t collect_visible(PagedScene* scene, vec3 position, const Camera* camera, ChunkCandidate* out) {
+    size_t count = 0;
+    for (size_t c = 0; c < scene->chunk_count; c++) {
+        const SceneChunk* chunk = &scene->chunks[c];
+        // A splat of scale s is drawn with a radius of 2 * s * aspect in world units at any depth
+        if (!chunk_visible(scene, chunk, 2.0f * scene->aspect_ratio * scene->margins[c], position, camera)) continue;
+        float dx = 0.5f * (chunk->min[0] + chunk->max[0]) - position.x;
+        float dy = 0.5f * (chunk->min[1] + chunk->max[1]) - position.y;
+        float dz = 0.5f * (chunk->min[2] + chunk->max[2]) - position.z;
+        out[count].chunk = (int)c;
+        out[count].distance = dx * dx + dy * dy + dz * dz;
+        count++;
+    }
+    qsort(out, count, sizeof(ChunkCandidate), compare_candidates);
+    return count;
+}
+
+size_t paged_scene_update(PagedScene* scene, const Camera* camera, double time, const SplatArrays** draw_list) {
+    // Smoothed camera velocity for the look-ahead
+    if (scene->last_time > 0.0 && time > scene->last_time) {
+        float dt = (float)(time - scene->last_time);
+        vec3 current = {
+            (camera->position.x - scene->last_position.x) / dt,
+            (camera->position.y - scene->last_position.y) / dt,
+            (camera->position.z - scene->last_position.z) / dt,
+        };
+        float keep = scene->has_motion ? 0.7f : 0.0f;
+        scene->velocity.x = keep * scene->velocity.x + (1.0f - keep) * current.x;
+        scene->velocity.y = keep * scene->velocity.y + (1.0f - keep) * current.y;
+        scene->velocity.z = keep * scene->velocity.z + (1.0f - keep) * current.z;
+        scene->has_motion = true;
+    }
+    scene->last_position = camera->position;
+    scene->last_time = time;
+
+    size_t visible = collect_visible(scene, camera->position, camera, scene->candidates);
+
+    platform_mutex_lock(&scene->mutex);
+    scene->frame++;
+
+    size_t draw_count = 0, coarse = 0, missing = 0;
+    scene->request_count = 0;
+    scene->request_next = 0;
+    for (size_t i = 0; i < visible; i++) {
+        int chunk = scene->candidates[i].chunk;
+        int index = scene->chunk_slot[chunk];
+        if (index >= 0 && !scene->slots[index].loading) {
+            scene->slots[index].last_used = scene->frame;
+            scene->draw_list[draw_count++] = scene->slots[index].view;
+            continue;
+        }
+
+        if (scene->lod_views && scene->lod_views[chunk].count > 0) {
+            scene->draw_list[draw_count++] = scene->lod_views[chunk];
+            coarse++;
+        } else {
+            missing++;
+        }
+        if (index < 0 && scene->request_count < scene->slot_count) {
+            scene->requests[scene->request_count++] = chunk;
+        }
+    }
+    platform_mutex_unlock(&scene->mutex);
+
+    // Then whatever comes into view along the motion, if there is room left in the budget
+    float ahead = scene->prefetch_seconds;
+    float speed_sq = scene->velocity.x * scene->velocity.x + scene->velocity.y * scene->velocity.y +
+                     scene->velocity.z * scene->velocity.z;
+    size_t predicted = 0;
+    if (ahead > 0.0f && scene->has_motion && speed_sq > 1e-8f && visible < scene->slot_count) {
+        vec3 future = {
+            camera->position.x + scene->velocity.x * ahead,
+            camera->position.y + scene->velocity.y * ahead,
+            camera->position.z + scene->velocity.z * ahead,
+        };
+        predicted = collect_visible(scene, future, camera, scene->candidates);
+    }
+
+    platform_mutex_lock(&scene->mutex);
+    for (size_t i = 0; i < predicted && scene->request_count < scene->slot_count - visible; i++) {
+        int chunk = scene->candidates[i].chunk;
+        if (scene->chunk_slot[chunk] >= 0) continue;
+        bool queued = false;
+        for (size_t j = 0; j < scene->request_count && !queued; j++) queued = scene->requests[j] == chunk;
+        if (!queued) scene->requests[scene->request_count++] = chunk;
+    }
+
+    scene->stats.visible = visible;
+    scene->stats.coarse = coarse;
+    scene->stats.missing = missing;
+    scene->stats.pending = scene->request_count;
+    if (scene->request_count > 0) platform_cond_broadcast(&scene->cond);
+    platform_mutex_unlock(&scene->mutex);
+
+    *draw_list = scene->draw_list;
+    return draw_count;
+}
+
+void paged_scene_get_stats(PagedScene* scene, PagedSceneStats* stats) {
+    platform_mutex_lock(&scene->mutex);
+    *stats = scene->stats;
+    stats->pending = scene->request_count - scene->request_next;
+    platform_mutex_unlock(&scene->mutex);
+}
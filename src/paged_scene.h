@@ -0,0 +1,61 @@
+#ifndef PAGED_SCENE_H
+#define PAGED_SCENE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "splat.h"
+#include "camera.h"
+
+#define PAGED_DEFAULT_BUDGET ((size_t)256 << 20)
+
+typedef struct {
+    size_t memory_budget;     // Bytes of full-resolution chunk data kept in memory, 0 = 256 MiB
+    float prefetch_seconds;   // How far ahead along the camera's motion to load chunks, 0 = 0.5, negative = off
+    float aspect_ratio;       // Viewport width over height, 0 = 4:3
+} PagedSceneOptions;
+
+typedef struct {
+    size_t chunk_count;       // Chunks in the file
+    size_t slot_count;        // Chunks that fit in the memory budget
+    size_t resident;          // Chunks currently loaded
+    size_t visible;           // Chunks in view on the last update
+    size_t coarse;            // Visible chunks drawn from the coarse level of detail
+    size_t missing;           // Visible chunks not drawn at all (file without a coarse level)
+    size_t pending;           // Requests waiting for the loader
+    size_t loads;             // Chunks read from disk
+    size_t evictions;         // Chunks dropped to make room
+    size_t bytes_read;
+} PagedSceneStats;
+
+/**
+ * Out-of-core view of a scene file that may be larger than memory.
+ *
+ * Only the chunk table and the coarse level of detail are read up front.
+ * Full-resolution chunks are read on demand by a background thread into a
+ * fixed set of slots sized by the memory budget; when the slots are full the
+ * least recently drawn chunk is evicted. Chunks that are in view but not yet
+ * loaded are drawn from the coarse level instead, so rendering never waits
+ * for the disk.
+ */
+typedef struct PagedScene PagedScene;
+
+PagedScene* paged_scene_open(const char* path, const PagedSceneOptions* options);
+void paged_scene_close(PagedScene* scene);
+
+/**
+ * @brief Selects the chunks to draw for a camera and schedules the loads.
+ *
+ * Visible chunks are requested nearest first, followed by the chunks visible
+ * from where the camera will be prefetch_seconds ahead at its current
+ * velocity. Requests from earlier updates that are no longer wanted are dropped.
+ *
+ * @param camera Camera of the frame about to be drawn.
+ * @param time Current time in seconds, used to estimate the camera's velocity.
+ * @param draw_list Receives one attribute view per chunk to draw, valid until the next update.
+ * @return Number of views in *draw_list, for render_scene_chunks.
+ */
+size_t paged_scene_update(PagedScene* scene, const Camera* camera, double time, const SplatArrays** draw_list);
+
+void paged_scene_get_stats(PagedScene* scene, PagedSceneStats* stats);
+
+#endif // PAGED_SCENE_H
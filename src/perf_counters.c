@@ -0,0 +1,238 @@
+// File: src/perf_counters.c
+#include "perf_counters.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const char* event_names[PERF_EVENT_COUNT] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"
+};
+
+// One thread's counter group, read with a single syscall
+typedef struct {
+    int leader;                        // Group leader fd, -1 if nothing could be opened
+    int fds[PERF_EVENT_COUNT];
+    int members;
+    PerfEvent order[PERF_EVENT_COUNT]; // Events in the order a group read returns them
+    uint64_t start[PERF_EVENT_COUNT];
+    uint64_t start_enabled, start_running;
+    bool started;
+} ThreadCounters;
+
+struct PerfCounters {
+    int thread_count;
+    ThreadCounters* threads;
+    bool has[PERF_EVENT_COUNT];
+    uint64_t frames;
+    uint64_t* sums;                    // [stage][thread][event]
+    uint64_t* enabled;                 // [stage][thread] nanoseconds the group was enabled
+    uint64_t* running;                 // [stage][thread] nanoseconds it was counting
+};
+
+#ifdef __linux__
+static int open_event(PerfEvent event, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    unsigned read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    switch (event) {
+        case PERF_CYCLES:        attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+        case PERF_INSTRUCTIONS:  attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+        case PERF_L1D_MISSES:    attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_L1D | read_miss; break;
+        case PERF_LLC_MISSES:    attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_LL | read_miss; break;
+        case PERF_DTLB_MISSES:   attr.type = PERF_TYPE_HW_CACHE; attr.config = PERF_COUNT_HW_CACHE_DTLB | read_miss; break;
+        case PERF_BRANCH_MISSES: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+        default: return -1;
+    }
+    // pid 0 and cpu -1: the calling thread, on whichever CPU it runs
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+// Opens what the CPU provides, in one group led by the first event that opens
+static void open_thread(ThreadCounters* thread) {
+    thread->leader = -1;
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        thread->fds[e] = open_event((PerfEvent)e, thread->leader);
+        if (thread->fds[e] < 0) continue;
+        if (thread->leader < 0) thread->leader = thread->fds[e];
+        thread->order[thread->members++] = (PerfEvent)e;
+    }
+}
+
+static void close_thread(ThreadCounters* thread) {
+    for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+        if (thread->fds[e] >= 0) close(thread->fds[e]);
+    }
+}
+
+static bool read_thread(const ThreadCounters* thread, uint64_t values[PERF_EVENT_COUNT], uint64_t* enabled,
+                        uint64_t* running) {
+    uint64_t buffer[3 + PERF_EVENT_COUNT];
+    if (thread->leader < 0) return false;
+    ssize_t size = read(thread->leader, buffer, sizeof(buffer));
+    if (size < (ssize_t)(3 * sizeof(uint64_t)) || buffer[0] != (uint64_t)thread->members) return false;
+
+    *enabled = buffer[1];
+    *running = buffer[2];
+    for (int m = 0; m < thread->members; m++) {
+        values[thread->order[m]] = buffer[3 + m];
+    }
+    return true;
+}
+#else
+static void close_thread(ThreadCounters* thread) {
+    (void)thread;
+}
+
+static bool read_thread(const ThreadCounters* thread, uint64_t values[PERF_EVENT_COUNT], uint64_t* enabled,
+                        uint64_t* running) {
+    (void)thread; (void)values; (void)enabled; (void)running;
+    return false;
+}
+#endif
+
+PerfCounters* perf_counters_open(void) {
+#ifndef __linux__
+    fprintf(stderr, "Hardware counters are only supported on Linux.\n");
+    return NULL;
+#else
+    PerfCounters* perf = (PerfCounters*)calloc(1, sizeof(PerfCounters));
+    if (!perf) return NULL;
+    perf->thread_count = omp_get_max_threads();
+    size_t slots = (size_t)PROFILE_STAGE_COUNT * perf->thread_count;
+    perf->threads = (ThreadCounters*)calloc((size_t)perf->thread_count, sizeof(ThreadCounters));
+    perf->sums = (uint64_t*)calloc(slots * PERF_EVENT_COUNT, sizeof(uint64_t));
+    perf->enabled = (uint64_t*)calloc(slots, sizeof(uint64_t));
+    perf->running = (uint64_t*)calloc(slots, sizeof(uint64_t));
+    if (!perf->threads || !perf->sums || !perf->enabled || !perf->running) {
+        log_error("Failed to allocate hardware counter state.");
+        perf_counters_close(perf);
+        return NULL;
+    }
+    for (int t = 0; t < perf->thread_count; t++) {
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) perf->threads[t].fds[e] = -1;
+        perf->threads[t].leader = -1;
+    }
+
+    // Each worker opens its own group; the counters follow that thread for the rest of its life
+    int error = 0;
+    #pragma omp parallel num_threads(perf->thread_count)
+    {
+        open_thread(&perf->threads[omp_get_thread_num()]);
+        if (perf->threads[omp_get_thread_num()].leader < 0) {
+            #pragma omp atomic write
+            error = errno;
+        }
+    }
+
+    bool any = false;
+    for (int t = 0; t < perf->thread_count; t++) {
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            if (perf->threads[t].fds[e] >= 0) perf->has[e] = any = true;
+        }
+    }
+    if (!any) {
+        // Stderr, so that tools writing results to stdout stay parseable
+        fprintf(stderr, "Hardware counters unavailable: %s (no PMU access, or see /proc/sys/kernel/perf_event_paranoid)\n", strerror(error));
+        perf_counters_close(perf);
+        return NULL;
+    }
+
+    return perf;
+#endif
+}
+
+void perf_counters_close(PerfCounters* perf) {
+    if (!perf) return;
+    if (perf->threads) {
+        for (int t = 0; t < perf->thread_count; t++) close_thread(&perf->threads[t]);
+    }
+    free(perf->threads);
+    free(perf->sums);
+    free(perf->enabled);
+    free(perf->running);
+    free(perf);
+}
+
+void perf_counters_begin(PerfCounters* perf) {
+    for (int t = 0; t < perf->thread_count; t++) {
+        ThreadCounters* thread = &perf->threads[t];
+        thread->started = read_thread(thread, thread->start, &thread->start_enabled, &thread->start_running);
+    }
+}
+
+void perf_counters_end(PerfCounters* perf, ProfileStage stage) {
+    for (int t = 0; t < perf->thread_count; t++) {
+        ThreadCounters* thread = &perf->threads[t];
+        uint64_t values[PERF_EVENT_COUNT] = {0}, enabled, running;
+        if (!thread->started || !read_thread(thread, values, &enabled, &running)) continue;
+
+        size_t slot = (size_t)stage * perf->thread_count + t;
+        uint64_t* sums = perf->sums + slot * PERF_EVENT_COUNT;
+        for (int m = 0; m < thread->members; m++) {
+            PerfEvent event = thread->order[m];
+            sums[event] += values[event] - thread->start[event];
+        }
+        perf->enabled[slot] += enabled - thread->start_enabled;
+        perf->running[slot] += running - thread->start_running;
+        thread->started = false;
+    }
+}
+
+void perf_counters_frame(PerfCounters* perf) {
+    perf->frames++;
+}
+
+void perf_counters_reset(PerfCounters* perf) {
+    size_t slots = (size_t)PROFILE_STAGE_COUNT * perf->thread_count;
+    memset(perf->sums, 0, slots * PERF_EVENT_COUNT * sizeof(uint64_t));
+    memset(perf->enabled, 0, slots * sizeof(uint64_t));
+    memset(perf->running, 0, slots * sizeof(uint64_t));
+    perf->frames = 0;
+}
+
+int perf_counters_threads(const PerfCounters* perf) {
+    return perf->thread_count;
+}
+
+bool perf_counters_has(const PerfCounters* perf, PerfEvent event) {
+    return event >= 0 && event < PERF_EVENT_COUNT && perf->has[event];
+}
+
+uint64_t perf_counters_frames(const PerfCounters* perf) {
+    return perf->frames;
+}
+
+void perf_counters_get(const PerfCounters* perf, ProfileStage stage, int thread, PerfSample* sample) {
+    memset(sample, 0, sizeof(*sample));
+    int first = thread < 0 ? 0 : thread;
+    int last = thread < 0 ? perf->thread_count : thread + 1;
+    uint64_t enabled = 0, running = 0;
+
+    for (int t = first; t < last; t++) {
+        size_t slot = (size_t)stage * perf->thread_count + t;
+        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+            sample->values[e] += perf->sums[slot * PERF_EVENT_COUNT + e];
+        }
+        enabled += perf->enabled[slot];
+        running += perf->running[slot];
+    }
+    sample->running = enabled > 0 ? (double)running / enabled : 1.0;
+}
+
+const char* perf_event_name(PerfEvent event) {
+    return event >= 0 && event < PERF_EVENT_COUNT ? event_names[event] : "unknown";
+}
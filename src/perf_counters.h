@@ -0,0 +1,66 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "profiler.h"
+
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,       // L1 data cache read misses
+    PERF_LLC_MISSES,       // Last level cache read misses
+    PERF_DTLB_MISSES,      // Data TLB read misses
+    PERF_BRANCH_MISSES,
+    PERF_EVENT_COUNT
+} PerfEvent;
+
+// Counts of one stage, summed over the frames since the last reset
+typedef struct {
+    uint64_t values[PERF_EVENT_COUNT];
+    double running;        // Fraction of the time the counters were on the PMU; below 1 when the kernel multiplexed them
+} PerfSample;
+
+/**
+ * Hardware performance counters read around the frame profiler's stages.
+ *
+ * Every OpenMP worker opens a counter group for itself, so a stage's counts
+ * are kept per thread. The thread driving the frames reads all groups when
+ * a stage begins and ends; worker counts include time spent waiting at the
+ * end of a parallel loop, which shows up as cycles with few instructions.
+ *
+ * Linux only (perf_event_open). Events the CPU or hypervisor does not
+ * provide are left out; if none can be opened, or perf_event_paranoid
+ * forbids it, opening fails with a message and the profiler runs without
+ * counters.
+ */
+typedef struct PerfCounters PerfCounters;
+
+// Opens counters on the calling thread and every OpenMP worker; NULL if none are available
+PerfCounters* perf_counters_open(void);
+void perf_counters_close(PerfCounters* perf);
+
+// Snapshot at the start of a stage; stages do not nest
+void perf_counters_begin(PerfCounters* perf);
+
+// Adds the counts since perf_counters_begin to a stage
+void perf_counters_end(PerfCounters* perf, ProfileStage stage);
+
+// Counts a completed frame, for per-frame averages
+void perf_counters_frame(PerfCounters* perf);
+
+// Clears the sums, e.g. after a report
+void perf_counters_reset(PerfCounters* perf);
+
+int perf_counters_threads(const PerfCounters* perf);
+bool perf_counters_has(const PerfCounters* perf, PerfEvent event);
+
+// Frames counted since the last reset
+uint64_t perf_counters_frames(const PerfCounters* perf);
+
+// Sums of a stage for one thread, or over all threads with thread == -1
+void perf_counters_get(const PerfCounters* perf, ProfileStage stage, int thread, PerfSample* sample);
+
+const char* perf_event_name(PerfEvent event);
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,476 @@
+// File: src/platform.c
+#include "platform.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#ifdef _WIN32
+#include <malloc.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+// Start block handed to the native thread entry point
+typedef struct {
+    PlatformThreadFunc func;
+    void* arg;
+} ThreadStart;
+
+#ifdef _WIN32
+static DWORD WINAPI thread_entry(LPVOID param) {
+#else
+static void* thread_entry(void* param) {
+#endif
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.func(start.arg);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+bool platform_thread_create(PlatformThread* thread, PlatformThreadFunc func, void* arg) {
+    ThreadStart* start = (ThreadStart*)malloc(sizeof(ThreadStart));
+    if (!start) return false;
+    start->func = func;
+    start->arg = arg;
+
+#ifdef _WIN32
+    *thread = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+    if (*thread == NULL) {
+#else
+    if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+#endif
+        free(start);
+        return false;
+    }
+    return true;
+}
+
+void platform_thread_join(PlatformThread thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+int platform_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+void platform_sleep_ms(int milliseconds) {
+#ifdef _WIN32
+    Sleep((DWORD)milliseconds);
+#else
+    struct timespec ts = { milliseconds / 1000, (long)(milliseconds % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+#ifdef _WIN32
+void platform_mutex_init(PlatformMutex* mutex) { InitializeCriticalSection(mutex); }
+void platform_mutex_destroy(PlatformMutex* mutex) { DeleteCriticalSection(mutex); }
+void platform_mutex_lock(PlatformMutex* mutex) { EnterCriticalSection(mutex); }
+void platform_mutex_unlock(PlatformMutex* mutex) { LeaveCriticalSection(mutex); }
+void platform_cond_init(PlatformCond* cond) { InitializeConditionVariable(cond); }
+void platform_cond_destroy(PlatformCond* cond) { (void)cond; }
+void platform_cond_wait(PlatformCond* cond, PlatformMutex* mutex) { SleepConditionVariableCS(cond, mutex, INFINITE); }
+void platform_cond_broadcast(PlatformCond* cond) { WakeAllConditionVariable(cond); }
+#else
+void platform_mutex_init(PlatformMutex* mutex) { pthread_mutex_init(mutex, NULL); }
+void platform_mutex_destroy(PlatformMutex* mutex) { pthread_mutex_destroy(mutex); }
+void platform_mutex_lock(PlatformMutex* mutex) { pthread_mutex_lock(mutex); }
+void platform_mutex_unlock(PlatformMutex* mutex) { pthread_mutex_unlock(mutex); }
+void platform_cond_init(PlatformCond* cond) { pthread_cond_init(cond, NULL); }
+void platform_cond_destroy(PlatformCond* cond) { pthread_cond_destroy(cond); }
+void platform_cond_wait(PlatformCond* cond, PlatformMutex* mutex) { pthread_cond_wait(cond, mutex); }
+void platform_cond_broadcast(PlatformCond* cond) { pthread_cond_broadcast(cond); }
+#endif
+
+double platform_time_seconds(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Natural order: runs of digits compare by numeric value
+static int natural_compare(const void* a, const void* b) {
+    const char* s = *(const char* const*)a;
+    const char* t = *(const char* const*)b;
+
+    while (*s && *t) {
+        if (isdigit((unsigned char)*s) && isdigit((unsigned char)*t)) {
+            while (*s == '0') s++;
+            while (*t == '0') t++;
+            size_t len_s = 0, len_t = 0;
+            while (isdigit((unsigned char)s[len_s])) len_s++;
+            while (isdigit((unsigned char)t[len_t])) len_t++;
+            if (len_s != len_t) return len_s < len_t ? -1 : 1;
+            int cmp = strncmp(s, t, len_s);
+            if (cmp != 0) return cmp;
+            s += len_s;
+            t += len_t;
+        } else {
+            if (*s != *t) return (unsigned char)*s < (unsigned char)*t ? -1 : 1;
+            s++;
+            t++;
+        }
+    }
+    return (unsigned char)*s - (unsigned char)*t;
+}
+
+static bool has_suffix(const char* name, const char* suffix) {
+    if (!suffix) return true;
+    size_t len = strlen(name), suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+// Append a copy of name to a growable list
+static bool push_name(char*** names, size_t* count, size_t* capacity, const char* name) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        char** grown = (char**)realloc(*names, new_capacity * sizeof(char*));
+        if (!grown) return false;
+        *names = grown;
+        *capacity = new_capacity;
+    }
+    size_t len = strlen(name);
+    char* copy = (char*)malloc(len + 1);
+    if (!copy) return false;
+    memcpy(copy, name, len + 1);
+    (*names)[(*count)++] = copy;
+    return true;
+}
+
+char** platform_list_dir(const char* dir, const char* suffix, size_t* count) {
+    char** names = NULL;
+    size_t capacity = 0;
+    *count = 0;
+
+#ifdef _WIN32
+    char* pattern = platform_join_path(dir, "*");
+    if (!pattern) return NULL;
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE) {
+        log_error("Unable to list directory %s", dir);
+        return NULL;
+    }
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        if (!has_suffix(data.cFileName, suffix)) continue;
+        if (!push_name(&names, count, &capacity, data.cFileName)) break;
+    } while (FindNextFileA(find, &data));
+    FindClose(find);
+#else
+    DIR* handle = opendir(dir);
+    if (!handle) {
+        log_error("Unable to list directory %s", dir);
+        return NULL;
+    }
+    struct dirent* ent;
+    while ((ent = readdir(handle)) != NULL) {
+        if (ent->d_name[0] == '.' || !has_suffix(ent->d_name, suffix)) continue;
+        char* path = platform_join_path(dir, ent->d_name);
+        struct stat st;
+        bool regular = path && stat(path, &st) == 0 && S_ISREG(st.st_mode);
+        free(path);
+        if (!regular) continue;
+        if (!push_name(&names, count, &capacity, ent->d_name)) break;
+    }
+    closedir(handle);
+#endif
+
+    if (*count > 1) {
+        qsort(names, *count, sizeof(char*), natural_compare);
+    }
+    if (!names) {
+        // Empty directory: return a valid, empty list
+        names = (char**)malloc(sizeof(char*));
+    }
+    return names;
+}
+
+void platform_free_list(char** names, size_t count) {
+    if (!names) return;
+    for (size_t i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+}
+
+bool platform_map_file(const char* path, PlatformFileMap* map) {
+    memset(map, 0, sizeof(*map));
+
+#ifdef _WIN32
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) {
+        log_error("Unable to open %s", path);
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0) {
+        CloseHandle(map->file);
+        return false;
+    }
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    map->data = map->mapping ? MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!map->data) {
+        log_error("Unable to map %s", path);
+        if (map->mapping) CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return false;
+    }
+    map->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        log_error("Unable to open %s", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        log_error("Unable to map %s", path);
+        return false;
+    }
+    map->data = data;
+    map->size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+void platform_unmap_file(PlatformFileMap* map) {
+    if (!map->data) return;
+#ifdef _WIN32
+    UnmapViewOfFile(map->data);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap(map->data, map->size);
+#endif
+    map->data = NULL;
+    map->size = 0;
+}
+
+bool platform_file_open(PlatformFile* file, const char* path) {
+#ifdef _WIN32
+    file->handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file->handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file->handle, &size)) {
+        if (file->handle != INVALID_HANDLE_VALUE) CloseHandle(file->handle);
+        file->handle = INVALID_HANDLE_VALUE;
+        log_error("Unable to open %s", path);
+        return false;
+    }
+    file->size = (unsigned long long)size.QuadPart;
+#else
+    file->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (file->fd < 0 || fstat(file->fd, &st) != 0) {
+        if (file->fd >= 0) close(file->fd);
+        file->fd = -1;
+        log_error("Unable to open %s", path);
+        return false;
+    }
+    file->size = (unsigned long long)st.st_size;
+#endif
+    return true;
+}
+
+void platform_file_close(PlatformFile* file) {
+#ifdef _WIN32
+    if (file->handle != INVALID_HANDLE_VALUE) CloseHandle(file->handle);
+    file->handle = INVALID_HANDLE_VALUE;
+#else
+    if (file->fd >= 0) close(file->fd);
+    file->fd = -1;
+#endif
+}
+
+bool platform_file_read_at(PlatformFile* file, unsigned long long offset, void* buffer, size_t size) {
+    char* out = (char*)buffer;
+    while (size > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD request = size > 0x40000000 ? 0x40000000 : (DWORD)size;
+        DWORD done = 0;
+        if (!ReadFile(file->handle, out, request, &done, &overlapped) || done == 0) return false;
+#else
+        ssize_t done = pread(file->fd, out, size, (off_t)offset);
+        if (done <= 0) return false;
+#endif
+        out += done;
+        offset += (unsigned long long)done;
+        size -= (size_t)done;
+    }
+    return true;
+}
+
+bool platform_file_info(const char* path, unsigned long long* size, unsigned long long* modified) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &data)) return false;
+    *size = ((unsigned long long)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *modified = ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+    *size = (unsigned long long)st.st_size;
+#ifdef __linux__
+    *modified = (unsigned long long)st.st_mtim.tv_sec * 1000000000ull + (unsigned long long)st.st_mtim.tv_nsec;
+#else
+    *modified = (unsigned long long)st.st_mtime * 1000000000ull;
+#endif
+#endif
+    return true;
+}
+
+long long platform_file_tell(FILE* file) {
+#ifdef _WIN32
+    return (long long)_ftelli64(file);
+#else
+    return (long long)ftello(file);
+#endif
+}
+
+void platform_touch_file(const char* path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+#else
+    utimes(path, NULL);
+#endif
+}
+
+bool platform_make_dir(const char* path) {
+#ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    struct stat st;
+    return mkdir(path, 0755) == 0 || (stat(path, &st) == 0 && S_ISDIR(st.st_mode));
+#endif
+}
+
+bool platform_replace_file(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+char* platform_join_path(const char* dir, const char* name) {
+    size_t dir_len = strlen(dir), name_len = strlen(name);
+    char* path = (char*)malloc(dir_len + name_len + 2);
+    if (!path) return NULL;
+
+    memcpy(path, dir, dir_len);
+    if (dir_len > 0 && dir[dir_len - 1] != '/' && dir[dir_len - 1] != '\\') {
+        path[dir_len++] = PLATFORM_PATH_SEP;
+    }
+    memcpy(path + dir_len, name, name_len + 1);
+    return path;
+}
+
+bool platform_memory_usage(size_t* resident, size_t* peak) {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return false;
+    *resident = counters.WorkingSetSize;
+    *peak = counters.PeakWorkingSetSize;
+    return true;
+#elif defined(__linux__)
+    // VmHWM follows clear_refs resets, unlike ru_maxrss
+    FILE* status = fopen("/proc/self/status", "r");
+    if (!status) return false;
+    char line[256];
+    size_t rss_kb = 0, hwm_kb = 0;
+    while (fgets(line, sizeof(line), status)) {
+        sscanf(line, "VmRSS: %zu kB", &rss_kb);
+        sscanf(line, "VmHWM: %zu kB", &hwm_kb);
+    }
+    fclose(status);
+    *resident = rss_kb * 1024;
+    *peak = hwm_kb * 1024;
+    return hwm_kb > 0;
+#else
+    // Only the peak is available; ru_maxrss is in bytes on macOS
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return false;
+    *peak = (size_t)usage.ru_maxrss;
+    *resident = *peak;
+    return true;
+#endif
+}
+
+bool platform_reset_peak_memory(void) {
+#ifdef __linux__
+    FILE* refs = fopen("/proc/self/clear_refs", "w");
+    if (!refs) return false;
+    bool ok = fputs("5", refs) >= 0;
+    return fclose(refs) == 0 && ok;
+#else
+    return false;
+#endif
+}
+
+size_t platform_heap_block_size(void* block) {
+    if (!block) return 0;
+#ifdef _WIN32
+    return _msize(block);
+#elif defined(__APPLE__)
+    return malloc_size(block);
+#else
+    return malloc_usable_size(block);
+#endif
+}
@@ -0,0 +1,114 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef HANDLE PlatformThread;
+typedef CRITICAL_SECTION PlatformMutex;
+typedef CONDITION_VARIABLE PlatformCond;
+#define PLATFORM_PATH_SEP '\\'
+#else
+#include <pthread.h>
+typedef pthread_t PlatformThread;
+typedef pthread_mutex_t PlatformMutex;
+typedef pthread_cond_t PlatformCond;
+#define PLATFORM_PATH_SEP '/'
+#endif
+
+typedef void (*PlatformThreadFunc)(void* arg);
+
+// Threads
+bool platform_thread_create(PlatformThread* thread, PlatformThreadFunc func, void* arg);
+void platform_thread_join(PlatformThread thread);
+int platform_cpu_count(void);
+void platform_sleep_ms(int milliseconds);
+
+// Mutexes and condition variables
+void platform_mutex_init(PlatformMutex* mutex);
+void platform_mutex_destroy(PlatformMutex* mutex);
+void platform_mutex_lock(PlatformMutex* mutex);
+void platform_mutex_unlock(PlatformMutex* mutex);
+void platform_cond_init(PlatformCond* cond);
+void platform_cond_destroy(PlatformCond* cond);
+void platform_cond_wait(PlatformCond* cond, PlatformMutex* mutex);
+void platform_cond_broadcast(PlatformCond* cond);
+
+// Monotonic clock in seconds, for measuring intervals only
+double platform_time_seconds(void);
+
+/**
+ * @brief Lists the regular files in a directory whose names end in suffix.
+ *
+ * Names are returned without the directory, sorted in natural order so that
+ * "frame-9" comes before "frame-10". Release the list with platform_free_list.
+ *
+ * @param dir Directory to enumerate.
+ * @param suffix Required file name suffix (e.g. ".npz"), or NULL for all files.
+ * @param count Receives the number of names returned.
+ * @return Array of names, or NULL if the directory could not be read.
+ */
+char** platform_list_dir(const char* dir, const char* suffix, size_t* count);
+void platform_free_list(char** names, size_t count);
+
+// Read-only memory mapping of a whole file
+typedef struct {
+    void* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} PlatformFileMap;
+
+bool platform_map_file(const char* path, PlatformFileMap* map);
+void platform_unmap_file(PlatformFileMap* map);
+
+// File opened for positioned reads, safe to share between threads
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    int fd;
+#endif
+    unsigned long long size;
+} PlatformFile;
+
+bool platform_file_open(PlatformFile* file, const char* path);
+void platform_file_close(PlatformFile* file);
+
+// Reads exactly size bytes at offset without moving a shared file position
+bool platform_file_read_at(PlatformFile* file, unsigned long long offset, void* buffer, size_t size);
+
+// Size and last modification stamp of a file; the stamp is only comparable with other stamps
+bool platform_file_info(const char* path, unsigned long long* size, unsigned long long* modified);
+
+// Position of a stdio stream, 64-bit on every platform (ftell is 32-bit on Windows); -1 on failure
+long long platform_file_tell(FILE* file);
+
+// Sets a file's modification time to now
+void platform_touch_file(const char* path);
+
+// Creates a directory; succeeds if it already exists
+bool platform_make_dir(const char* path);
+
+// Renames from to to, replacing an existing file
+bool platform_replace_file(const char* from, const char* to);
+
+// Joins a directory and a file name with the platform separator. Caller frees.
+char* platform_join_path(const char* dir, const char* name);
+
+// Resident memory of the process in bytes and its peak so far; false if the OS does not report them
+bool platform_memory_usage(size_t* resident, size_t* peak);
+
+// Restarts the peak at the current resident size. Only Linux allows this; false elsewhere.
+bool platform_reset_peak_memory(void);
+
+// Usable size of a block from malloc, calloc or realloc (at least the size requested)
+size_t platform_heap_block_size(void* block);
+
+#endif // PLATFORM_H
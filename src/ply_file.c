@@ -0,0 +1,401 @@
+// File: src/ply_file.c
+#include "ply_file.h"
+#include "platform.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <omp.h>
+
+#define PLY_MAX_PROPERTIES 256
+#define SH_C0 0.28209479177387814f  // Degree-0 spherical harmonic basis constant
+
+typedef enum {
+    PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+} PlyType;
+
+typedef struct {
+    char name[32];
+    PlyType type;
+    size_t offset;     // Byte offset inside a vertex record
+} PlyProperty;
+
+typedef struct {
+    size_t vertex_count;
+    size_t record_size;
+    size_t data_offset;        // Start of the vertex records in the file
+    bool big_endian;
+    bool all_float;            // Every property is a float32
+    PlyProperty properties[PLY_MAX_PROPERTIES];
+    int property_count;
+} PlyHeader;
+
+// Property indices used to build a splat, -1 when absent
+typedef struct {
+    int x, y, z;
+    int nx, ny, nz;
+    int dc[3];
+    int red, green, blue;
+    int opacity, alpha;
+    int scale[3];
+    int rot[4];
+    bool has_rotation;         // All four rot_* properties are present
+} PlyLayout;
+
+static bool parse_type(const char* name, PlyType* type, size_t* size) {
+    static const struct { const char* name; PlyType type; size_t size; } types[] = {
+        {"char", PLY_INT8, 1}, {"int8", PLY_INT8, 1}, {"uchar", PLY_UINT8, 1}, {"uint8", PLY_UINT8, 1},
+        {"short", PLY_INT16, 2}, {"int16", PLY_INT16, 2}, {"ushort", PLY_UINT16, 2}, {"uint16", PLY_UINT16, 2},
+        {"int", PLY_INT32, 4}, {"int32", PLY_INT32, 4}, {"uint", PLY_UINT32, 4}, {"uint32", PLY_UINT32, 4},
+        {"float", PLY_FLOAT32, 4}, {"float32", PLY_FLOAT32, 4}, {"double", PLY_FLOAT64, 8}, {"float64", PLY_FLOAT64, 8}
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (strcmp(name, types[i].name) == 0) {
+            *type = types[i].type;
+            *size = types[i].size;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parse the ASCII header. Only the vertex element is decoded; it must come first.
+static bool parse_header(const char* data, size_t size, PlyHeader* header) {
+    memset(header, 0, sizeof(*header));
+
+    if (size < 4 || strncmp(data, "ply", 3) != 0) {
+        log_error("Not a PLY file");
+        return false;
+    }
+
+    const char* p = data;
+    const char* end = data + size;
+    bool in_vertex = false, seen_vertex = false, format_ok = false;
+
+    while (p < end) {
+        const char* eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) break;
+
+        char line[256];
+        size_t len = (size_t)(eol - p);
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = '\0';
+        if (len > 0 && line[len - 1] == '\r') line[len - 1] = '\0';
+        p = eol + 1;
+
+        char word[3][64] = {{0}};
+        int words = sscanf(line, "%63s %63s %63s", word[0], word[1], word[2]);
+        if (words <= 0) continue;
+
+        if (strcmp(word[0], "end_header") == 0) {
+            header->data_offset = (size_t)(p - data);
+            if (!format_ok || !seen_vertex) {
+                log_error("PLY file has no binary vertex element");
+                return false;
+            }
+            return true;
+        } else if (strcmp(word[0], "format") == 0) {
+            if (strcmp(word[1], "binary_little_endian") == 0) {
+                header->big_endian = false;
+            } else if (strcmp(word[1], "binary_big_endian") == 0) {
+                header->big_endian = true;
+            } else {
+                log_error("Unsupported PLY format '%s'", word[1]);
+                return false;
+            }
+            format_ok = true;
+        } else if (strcmp(word[0], "element") == 0) {
+            in_vertex = strcmp(word[1], "vertex") == 0;
+            if (in_vertex) {
+                header->vertex_count = (size_t)strtoull(word[2], NULL, 10);
+                seen_vertex = true;
+            } else if (!seen_vertex) {
+                log_error("PLY element '%s' precedes the vertex element", word[1]);
+                return false;
+            }
+        } else if (strcmp(word[0], "property") == 0 && in_vertex) {
+            PlyType type;
+            size_t type_size;
+            if (strcmp(word[1], "list") == 0 || !parse_type(word[1], &type, &type_size)) {
+                log_error("Unsupported vertex property '%s'", line);
+                return false;
+            }
+            if (header->property_count == PLY_MAX_PROPERTIES) {
+                log_error("Too many vertex properties");
+                return false;
+            }
+            size_t name_length = strlen(word[2]);
+            if (name_length >= sizeof(header->properties[0].name)) {
+                log_error("Vertex property name '%s' is too long", word[2]);
+                return false;
+            }
+            PlyProperty* property = &header->properties[header->property_count++];
+            memcpy(property->name, word[2], name_length + 1);
+            property->type = type;
+            property->offset = header->record_size;
+            header->record_size += type_size;
+        }
+    }
+
+    log_error("PLY header is not terminated");
+    return false;
+}
+
+static int find_property(const PlyHeader* header, const char* name) {
+    for (int i = 0; i < header->property_count; i++) {
+        if (strcmp(header->properties[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static void resolve_layout(const PlyHeader* header, PlyLayout* layout) {
+    char name[16];
+    layout->x = find_property(header, "x");
+    layout->y = find_property(header, "y");
+    layout->z = find_property(header, "z");
+    layout->nx = find_property(header, "nx");
+    layout->ny = find_property(header, "ny");
+    layout->nz = find_property(header, "nz");
+    layout->red = find_property(header, "red");
+    layout->green = find_property(header, "green");
+    layout->blue = find_property(header, "blue");
+    layout->opacity = find_property(header, "opacity");
+    layout->alpha = find_property(header, "alpha");
+    for (int i = 0; i < 3; i++) {
+        snprintf(name, sizeof(name), "f_dc_%d", i);
+        layout->dc[i] = find_property(header, name);
+        snprintf(name, sizeof(name), "scale_%d", i);
+        layout->scale[i] = find_property(header, name);
+    }
+    layout->has_rotation = true;
+    for (int i = 0; i < 4; i++) {
+        snprintf(name, sizeof(name), "rot_%d", i);
+        layout->rot[i] = find_property(header, name);
+        if (layout->rot[i] < 0) layout->has_rotation = false;
+    }
+}
+
+static float read_property(const unsigned char* record, const PlyHeader* header, int index) {
+    const PlyProperty* property = &header->properties[index];
+    const unsigned char* src = record + property->offset;
+
+    if (header->all_float) {
+        float value;
+        memcpy(&value, src, sizeof(value));
+        return value;
+    }
+
+    unsigned char bytes[8];
+    size_t size = (property->type == PLY_FLOAT64) ? 8 :
+                  (property->type >= PLY_INT32) ? 4 :
+                  (property->type >= PLY_INT16) ? 2 : 1;
+    for (size_t i = 0; i < size; i++) {
+        bytes[i] = header->big_endian ? src[size - 1 - i] : src[i];
+    }
+
+    switch (property->type) {
+        case PLY_INT8: return (float)(int8_t)bytes[0];
+        case PLY_UINT8: return (float)bytes[0];
+        case PLY_INT16: { int16_t v; memcpy(&v, bytes, 2); return (float)v; }
+        case PLY_UINT16: { uint16_t v; memcpy(&v, bytes, 2); return (float)v; }
+        case PLY_INT32: { int32_t v; memcpy(&v, bytes, 4); return (float)v; }
+        case PLY_UINT32: { uint32_t v; memcpy(&v, bytes, 4); return (float)v; }
+        case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+        default: { double v; memcpy(&v, bytes, 8); return (float)v; }
+    }
+}
+
+static inline float optional_property(const unsigned char* record, const PlyHeader* header, int index, float fallback) {
+    return index >= 0 ? read_property(record, header, index) : fallback;
+}
+
+static void decode_vertex(const unsigned char* record, const PlyHeader* header, const PlyLayout* layout, Splat* out) {
+    float x = read_property(record, header, layout->x);
+    float y = read_property(record, header, layout->y);
+    float z = read_property(record, header, layout->z);
+
+    float r = 1.0f, g = 1.0f, b = 1.0f;
+    if (layout->dc[0] >= 0 && layout->dc[1] >= 0 && layout->dc[2] >= 0) {
+        r = 0.5f + SH_C0 * read_property(record, header, layout->dc[0]);
+        g = 0.5f + SH_C0 * read_property(record, header, layout->dc[1]);
+        b = 0.5f + SH_C0 * read_property(record, header, layout->dc[2]);
+    } else if (layout->red >= 0 && layout->green >= 0 && layout->blue >= 0) {
+        r = read_property(record, header, layout->red) / 255.0f;
+        g = read_property(record, header, layout->green) / 255.0f;
+        b = read_property(record, header, layout->blue) / 255.0f;
+    }
+
+    float a = 1.0f;
+    if (layout->opacity >= 0) {
+        a = 1.0f / (1.0f + expf(-read_property(record, header, layout->opacity)));
+    } else if (layout->alpha >= 0) {
+        a = read_property(record, header, layout->alpha) / 255.0f;
+    }
+
+    // Splat.scale is isotropic, so keep the largest axis of the Gaussian
+    float axis_scale[3] = { 1.0f, 1.0f, 1.0f };
+    float scale = 1.0f;
+    if (layout->scale[0] >= 0) {
+        scale = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            axis_scale[i] = expf(optional_property(record, header, layout->scale[i], -INFINITY));
+            if (axis_scale[i] > scale) scale = axis_scale[i];
+        }
+    }
+
+    float dx = optional_property(record, header, layout->nx, 0.0f);
+    float dy = optional_property(record, header, layout->ny, 0.0f);
+    float dz = optional_property(record, header, layout->nz, 0.0f);
+
+    // Without a stored normal, use the Gaussian's thinnest axis as its direction
+    if (dx == 0.0f && dy == 0.0f && dz == 0.0f && layout->has_rotation) {
+        float qw = read_property(record, header, layout->rot[0]);
+        float qx = read_property(record, header, layout->rot[1]);
+        float qy = read_property(record, header, layout->rot[2]);
+        float qz = read_property(record, header, layout->rot[3]);
+        int thin = (axis_scale[0] <= axis_scale[1] && axis_scale[0] <= axis_scale[2]) ? 0 :
+                   (axis_scale[1] <= axis_scale[2]) ? 1 : 2;
+        float norm_sq = qw * qw + qx * qx + qy * qy + qz * qz;
+        float s = norm_sq > 0.0f ? 2.0f / norm_sq : 0.0f;
+        if (thin == 0) {
+            dx = 1.0f - s * (qy * qy + qz * qz); dy = s * (qx * qy + qw * qz); dz = s * (qx * qz - qw * qy);
+        } else if (thin == 1) {
+            dx = s * (qx * qy - qw * qz); dy = 1.0f - s * (qx * qx + qz * qz); dz = s * (qy * qz + qw * qx);
+        } else {
+            dx = s * (qx * qz + qw * qy); dy = s * (qy * qz - qw * qx); dz = 1.0f - s * (qx * qx + qy * qy);
+        }
+    }
+
+    init_splat(out, x, y, z, dx, dy, dz, r, g, b, a, scale);
+}
+
+int load_splats_from_ply(const char* filename, Splat** splats) {
+    PlatformFileMap map;
+    if (!platform_map_file(filename, &map)) {
+        log_error("Failed to open PLY file %s", filename);
+        return 0;
+    }
+
+    PlyHeader* header = (PlyHeader*)malloc(sizeof(PlyHeader));
+    if (!header || !parse_header((const char*)map.data, map.size, header)) {
+        free(header);
+        platform_unmap_file(&map);
+        return 0;
+    }
+
+    PlyLayout layout;
+    resolve_layout(header, &layout);
+    if (layout.x < 0 || layout.y < 0 || layout.z < 0) {
+        log_error("PLY vertices in %s have no x/y/z properties", filename);
+        free(header);
+        platform_unmap_file(&map);
+        return 0;
+    }
+
+    header->all_float = !header->big_endian;
+    for (int i = 0; i < header->property_count; i++) {
+        if (header->properties[i].type != PLY_FLOAT32) header->all_float = false;
+    }
+
+    size_t count = header->vertex_count;
+    if (count == 0 || count > INT32_MAX ||
+        header->data_offset + count * header->record_size > map.size) {
+        log_error("PLY vertex data in %s is empty or truncated", filename);
+        free(header);
+        platform_unmap_file(&map);
+        return 0;
+    }
+
+    *splats = (Splat*)malloc(count * sizeof(Splat));
+    if (*splats == NULL) {
+        log_error("Failed to allocate memory for splats.");
+        free(header);
+        platform_unmap_file(&map);
+        return 0;
+    }
+
+    const unsigned char* records = (const unsigned char*)map.data + header->data_offset;
+    size_t record_size = header->record_size;
+
+    // Each thread decodes a contiguous range, streaming through the mapping once
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)count; i++) {
+        decode_vertex(records + (size_t)i * record_size, header, &layout, &(*splats)[i]);
+    }
+
+    log_info("Loaded %zu splats successfully from %s.", count, filename);
+
+    free(header);
+    platform_unmap_file(&map);
+    return (int)count;
+}
+
+// Property order of the standard Gaussian-splat PLY layout written by save_splats_to_ply
+static const char* const ply_write_properties[] = {
+    "x", "y", "z", "nx", "ny", "nz", "f_dc_0", "f_dc_1", "f_dc_2", "opacity",
+    "scale_0", "scale_1", "scale_2", "rot_0", "rot_1", "rot_2", "rot_3"
+};
+#define PLY_WRITE_FLOATS (sizeof(ply_write_properties) / sizeof(ply_write_properties[0]))
+
+static void encode_vertex(const Splat* splat, float* out) {
+    float alpha = splat->a < 1e-6f ? 1e-6f : (splat->a > 1.0f - 1e-6f ? 1.0f - 1e-6f : splat->a);
+    float log_scale = logf(splat->scale > 1e-30f ? splat->scale : 1e-30f);
+
+    out[0] = splat->x;
+    out[1] = splat->y;
+    out[2] = splat->z;
+    out[3] = splat->dx;
+    out[4] = splat->dy;
+    out[5] = splat->dz;
+    out[6] = (splat->r - 0.5f) / SH_C0;
+    out[7] = (splat->g - 0.5f) / SH_C0;
+    out[8] = (splat->b - 0.5f) / SH_C0;
+    out[9] = logf(alpha / (1.0f - alpha));
+    out[10] = log_scale;
+    out[11] = log_scale;
+    out[12] = log_scale;
+    out[13] = 1.0f;  // Identity rotation: splats are isotropic
+    out[14] = 0.0f;
+    out[15] = 0.0f;
+    out[16] = 0.0f;
+}
+
+bool save_splats_to_ply(const char* filename, const Splat* splats, size_t count) {
+    size_t record_floats = PLY_WRITE_FLOATS;
+    float* records = (float*)malloc((count ? count : 1) * record_floats * sizeof(float));
+    if (!records) {
+        log_error("Failed to allocate memory for PLY records.");
+        return false;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (long long i = 0; i < (long long)count; i++) {
+        encode_vertex(&splats[i], records + (size_t)i * record_floats);
+    }
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        log_error("Unable to create PLY file %s", filename);
+        free(records);
+        return false;
+    }
+
+    bool ok = fprintf(file, "ply\nformat binary_little_endian 1.0\nelement vertex %zu\n", count) > 0;
+    for (size_t i = 0; ok && i < record_floats; i++) {
+        ok = fprintf(file, "property float %s\n", ply_write_properties[i]) > 0;
+    }
+    ok = ok && fprintf(file, "end_header\n") > 0;
+    ok = ok && fwrite(records, sizeof(float) * record_floats, count, file) == count;
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        log_error("Failed to write PLY file %s", filename);
+        remove(filename);
+    }
+
+    free(records);
+    return ok;
+}
@@ -0,0 +1,37 @@
+#ifndef PLY_FILE_H
+#define PLY_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "splat.h"
+
+/**
+ * @brief Loads splats from a binary Gaussian-splat PLY file.
+ *
+ * The file is memory-mapped and vertex records are decoded in parallel chunks
+ * straight into the splat array. Recognised vertex properties:
+ * - x, y, z
+ * - nx, ny, nz (direction)
+ * - f_dc_0..2 (degree-0 SH color) or red, green, blue
+ * - opacity (logit) or alpha
+ * - scale_0..2 (log scale; the largest axis becomes Splat.scale)
+ * - rot_0..3 (used for the direction when no normal is present)
+ * Higher-order SH coefficients (f_rest_*) are skipped.
+ *
+ * @param filename Path to a binary_little_endian or binary_big_endian PLY file.
+ * @param splats Receives a malloc'd array of splats.
+ * @return Number of splats loaded, or 0 on failure.
+ */
+int load_splats_from_ply(const char* filename, Splat** splats);
+
+/**
+ * @brief Writes splats as a binary_little_endian PLY in the standard
+ * Gaussian-splat layout (position, normal, f_dc, opacity, scale, rot).
+ *
+ * Records are encoded in parallel and written with a single sequential write.
+ *
+ * @return true on success.
+ */
+bool save_splats_to_ply(const char* filename, const Splat* splats, size_t count);
+
+#endif // PLY_FILE_H
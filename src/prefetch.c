@@ -0,0 +1,322 @@
+// File: src/prefetch.c
+#include "prefetch.h"
+#include "image_loader.h"
+#include "platform.h"
+#include "trace.h"
+#include "log.h"
+#include <stb_image.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PREFETCH_DEFAULT_RING 4
+#define PREFETCH_CACHE_LINE 64
+
+// One reusable frame buffer of the ring
+typedef struct {
+    PrefetchedFrame frame;
+    void* depth_buffer;
+    size_t depth_capacity;
+    void* rgb_buffer;
+    size_t rgb_capacity;
+} PrefetchSlot;
+
+// Lock-free single-producer/single-consumer queue of slot pointers.
+// head and tail only ever grow; their difference is the number of queued items.
+typedef struct {
+    PrefetchSlot** items;
+    size_t mask;
+    _Alignas(PREFETCH_CACHE_LINE) atomic_size_t head;  // Next item to pop, written by the consumer
+    _Alignas(PREFETCH_CACHE_LINE) atomic_size_t tail;  // Next item to push, written by the producer
+} SpscQueue;
+
+struct FramePrefetcher {
+    const Dataset* dataset;
+    PrefetchOptions options;
+    size_t first;
+    size_t end;
+
+    PrefetchSlot* slots;
+    SpscQueue ready;   // Decoder -> consumer
+    SpscQueue free;    // Consumer -> decoder
+
+    PlatformThread thread;
+    atomic_bool stopping;
+    atomic_bool finished;   // Set after the last frame of a non-looping sequence is queued
+
+    atomic_size_t decoded;
+    atomic_size_t delivered;
+    atomic_size_t stalls;
+    atomic_size_t decode_microseconds;
+};
+
+static bool queue_init(SpscQueue* queue, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size *= 2;
+    queue->items = (PrefetchSlot**)calloc(size, sizeof(PrefetchSlot*));
+    queue->mask = size - 1;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return queue->items != NULL;
+}
+
+static bool queue_push(SpscQueue* queue, PrefetchSlot* slot) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head > queue->mask) return false;
+    queue->items[tail & queue->mask] = slot;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+static PrefetchSlot* queue_pop(SpscQueue* queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) return NULL;
+    PrefetchSlot* slot = queue->items[head & queue->mask];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return slot;
+}
+
+// Grows a slot buffer; only needed when a later frame is larger than the first
+static bool reserve_buffer(void** buffer, size_t* capacity, size_t size) {
+    if (size <= *capacity) return true;
+    void* grown = realloc(*buffer, size);
+    if (!grown) {
+        log_error("Failed to grow prefetch buffer to %zu bytes.", size);
+        return false;
+    }
+    *buffer = grown;
+    *capacity = size;
+    return true;
+}
+
+static void clear_depth(PrefetchedFrame* frame) {
+    frame->depth.data = NULL;  // Owned by the slot, not by the array
+    cnpy_free(&frame->depth);
+}
+
+static void decode_into_slot(FramePrefetcher* prefetcher, size_t index, PrefetchSlot* slot) {
+    const DatasetEntry* entry = &prefetcher->dataset->entries[index];
+    PrefetchedFrame* frame = &slot->frame;
+
+    clear_depth(frame);
+    frame->index = index;
+    frame->entry = entry;
+    frame->rgb = NULL;
+    frame->rgb_width = frame->rgb_height = frame->rgb_channels = 0;
+
+    trace_begin("decode depth");
+    cnpy_npz* npz = cnpy_npz_open(entry->depth_path);
+    if (npz) {
+        cnpy_array meta = {0};
+        if (cnpy_npz_info(npz, "arr_0", &meta)) {
+            size_t size = cnpy_num_elements(&meta) * meta.word_size;
+            cnpy_free(&meta);
+            if (reserve_buffer(&slot->depth_buffer, &slot->depth_capacity, size) &&
+                cnpy_npz_load_into(npz, "arr_0", slot->depth_buffer, slot->depth_capacity, &frame->depth)) {
+                frame->depth.data = slot->depth_buffer;
+            }
+        }
+        cnpy_npz_close(npz);
+    }
+    trace_end("decode depth");
+
+    if (prefetcher->options.load_rgb && entry->rgb_path) {
+        trace_begin("decode rgb");
+        int width, height, channels;
+        unsigned char* image = load_png_image(entry->rgb_path, &width, &height, &channels);
+        if (image) {
+            // stb_image always allocates, so the pixels are moved into the slot's own buffer
+            size_t size = (size_t)width * height * channels;
+            if (reserve_buffer(&slot->rgb_buffer, &slot->rgb_capacity, size)) {
+                memcpy(slot->rgb_buffer, image, size);
+                frame->rgb = slot->rgb_buffer;
+                frame->rgb_width = width;
+                frame->rgb_height = height;
+                frame->rgb_channels = channels;
+            }
+            free_png_image(image);
+        }
+        trace_end("decode rgb");
+    }
+}
+
+static void decoder_main(void* arg) {
+    FramePrefetcher* prefetcher = (FramePrefetcher*)arg;
+    size_t index = prefetcher->first;
+    trace_set_thread_name("frame prefetcher");
+
+    while (!atomic_load_explicit(&prefetcher->stopping, memory_order_relaxed)) {
+        if (index >= prefetcher->end) {
+            if (!prefetcher->options.loop) break;
+            index = prefetcher->first;
+        }
+
+        PrefetchSlot* slot = queue_pop(&prefetcher->free);
+        if (!slot) {
+            // Every buffer is decoded or on screen; wait for the consumer to step
+            platform_sleep_ms(1);
+            continue;
+        }
+
+        double start = platform_time_seconds();
+        decode_into_slot(prefetcher, index, slot);
+        atomic_fetch_add_explicit(&prefetcher->decode_microseconds,
+                                  (size_t)((platform_time_seconds() - start) * 1e6), memory_order_relaxed);
+        atomic_fetch_add_explicit(&prefetcher->decoded, 1, memory_order_relaxed);
+
+        // Cannot fail: there are never more slots than queue entries
+        queue_push(&prefetcher->ready, slot);
+        index++;
+    }
+
+    atomic_store_explicit(&prefetcher->finished, true, memory_order_release);
+}
+
+// Sizes every slot from the first frame so steady-state playback never grows a frame buffer
+static void preallocate_slots(FramePrefetcher* prefetcher) {
+    const DatasetEntry* entry = &prefetcher->dataset->entries[prefetcher->first];
+    size_t depth_size = 0, rgb_size = 0;
+
+    cnpy_npz* npz = cnpy_npz_open(entry->depth_path);
+    if (npz) {
+        cnpy_array meta = {0};
+        if (cnpy_npz_info(npz, "arr_0", &meta)) {
+            depth_size = cnpy_num_elements(&meta) * meta.word_size;
+            cnpy_free(&meta);
+        }
+        cnpy_npz_close(npz);
+    }
+
+    int width, height, channels;
+    if (prefetcher->options.load_rgb && entry->rgb_path && stbi_info(entry->rgb_path, &width, &height, &channels)) {
+        rgb_size = (size_t)width * height * channels;
+    }
+
+    for (size_t i = 0; i < prefetcher->options.ring_size; i++) {
+        PrefetchSlot* slot = &prefetcher->slots[i];
+        if (depth_size) reserve_buffer(&slot->depth_buffer, &slot->depth_capacity, depth_size);
+        if (rgb_size) reserve_buffer(&slot->rgb_buffer, &slot->rgb_capacity, rgb_size);
+    }
+}
+
+static void free_prefetcher(FramePrefetcher* prefetcher) {
+    if (prefetcher->slots) {
+        for (size_t i = 0; i < prefetcher->options.ring_size; i++) {
+            clear_depth(&prefetcher->slots[i].frame);
+            free(prefetcher->slots[i].depth_buffer);
+            free(prefetcher->slots[i].rgb_buffer);
+        }
+    }
+    free(prefetcher->slots);
+    free(prefetcher->ready.items);
+    free(prefetcher->free.items);
+    free(prefetcher);
+}
+
+FramePrefetcher* prefetcher_start(const Dataset* dataset, const PrefetchOptions* options) {
+    FramePrefetcher* prefetcher = (FramePrefetcher*)calloc(1, sizeof(FramePrefetcher));
+    if (!prefetcher) return NULL;
+
+    prefetcher->dataset = dataset;
+    if (options) {
+        prefetcher->options = *options;
+    } else {
+        prefetcher->options.load_rgb = true;
+    }
+    if (prefetcher->options.ring_size == 0) {
+        prefetcher->options.ring_size = PREFETCH_DEFAULT_RING;
+    } else if (prefetcher->options.ring_size < 2) {
+        prefetcher->options.ring_size = 2;
+    }
+
+    size_t first = prefetcher->options.first;
+    if (first >= dataset->count) {
+        log_error("Dataset has no frames from index %zu.", first);
+        free(prefetcher);
+        return NULL;
+    }
+    size_t available = dataset->count - first;
+    size_t count = (prefetcher->options.count == 0 || prefetcher->options.count > available)
+                       ? available : prefetcher->options.count;
+    prefetcher->first = first;
+    prefetcher->end = first + count;
+
+    atomic_init(&prefetcher->stopping, false);
+    atomic_init(&prefetcher->finished, false);
+    atomic_init(&prefetcher->decoded, 0);
+    atomic_init(&prefetcher->delivered, 0);
+    atomic_init(&prefetcher->stalls, 0);
+    atomic_init(&prefetcher->decode_microseconds, 0);
+
+    prefetcher->slots = (PrefetchSlot*)calloc(prefetcher->options.ring_size, sizeof(PrefetchSlot));
+    if (!prefetcher->slots ||
+        !queue_init(&prefetcher->ready, prefetcher->options.ring_size) ||
+        !queue_init(&prefetcher->free, prefetcher->options.ring_size)) {
+        log_error("Failed to allocate memory for frame prefetcher.");
+        free_prefetcher(prefetcher);
+        return NULL;
+    }
+
+    preallocate_slots(prefetcher);
+    for (size_t i = 0; i < prefetcher->options.ring_size; i++) {
+        queue_push(&prefetcher->free, &prefetcher->slots[i]);
+    }
+
+    if (!platform_thread_create(&prefetcher->thread, decoder_main, prefetcher)) {
+        log_error("Failed to start frame prefetch thread.");
+        free_prefetcher(prefetcher);
+        return NULL;
+    }
+    return prefetcher;
+}
+
+// Makes a decoded slot the current frame and hands the previous one back to the decoder
+static void take_frame(FramePrefetcher* prefetcher, PrefetchSlot* next, const PrefetchedFrame** current) {
+    // frame is the first member, so the frame pointer is also the slot pointer
+    if (*current) {
+        queue_push(&prefetcher->free, (PrefetchSlot*)*current);
+    }
+    *current = &next->frame;
+    atomic_fetch_add_explicit(&prefetcher->delivered, 1, memory_order_relaxed);
+}
+
+bool prefetcher_advance(FramePrefetcher* prefetcher, const PrefetchedFrame** current) {
+    PrefetchSlot* next = queue_pop(&prefetcher->ready);
+    if (!next) {
+        atomic_fetch_add_explicit(&prefetcher->stalls, 1, memory_order_relaxed);
+        return false;
+    }
+    take_frame(prefetcher, next, current);
+    return true;
+}
+
+bool prefetcher_wait(FramePrefetcher* prefetcher, const PrefetchedFrame** current) {
+    for (;;) {
+        // The decoder queues its last frame before setting finished, so read the flag first
+        bool finished = atomic_load_explicit(&prefetcher->finished, memory_order_acquire);
+        PrefetchSlot* next = queue_pop(&prefetcher->ready);
+        if (next) {
+            take_frame(prefetcher, next, current);
+            return true;
+        }
+        if (finished) return false;
+        platform_sleep_ms(1);
+    }
+}
+
+void prefetcher_get_stats(const FramePrefetcher* prefetcher, PrefetchStats* stats) {
+    stats->decoded = atomic_load_explicit(&prefetcher->decoded, memory_order_relaxed);
+    stats->delivered = atomic_load_explicit(&prefetcher->delivered, memory_order_relaxed);
+    stats->stalls = atomic_load_explicit(&prefetcher->stalls, memory_order_relaxed);
+    stats->decode_seconds = atomic_load_explicit(&prefetcher->decode_microseconds, memory_order_relaxed) * 1e-6;
+}
+
+void prefetcher_stop(FramePrefetcher* prefetcher) {
+    if (!prefetcher) return;
+    atomic_store_explicit(&prefetcher->stopping, true, memory_order_relaxed);
+    platform_thread_join(prefetcher->thread);
+    free_prefetcher(prefetcher);
+}
@@ -0,0 +1,73 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cnpy.h"
+#include "dataset.h"
+
+// A decoded frame living in one of the prefetcher's ring buffers
+typedef struct {
+    size_t index;                 // Position in the dataset
+    const DatasetEntry* entry;
+    cnpy_array depth;             // depth.data points into the ring buffer, NULL if the npz failed to load
+    const unsigned char* rgb;     // Points into the ring buffer, NULL without an image
+    int rgb_width, rgb_height, rgb_channels;
+} PrefetchedFrame;
+
+typedef struct {
+    size_t ring_size;   // Frame buffers including the one on screen, 0 = 4 (minimum 2)
+    size_t first;       // First frame to play
+    size_t count;       // Number of frames, 0 = through the end of the dataset
+    bool load_rgb;      // Decode the PNG alongside the depth map
+    bool loop;          // Start over after the last frame, for continuous playback
+} PrefetchOptions;
+
+typedef struct {
+    size_t decoded;         // Frames decoded by the background thread
+    size_t delivered;       // Frames handed to the consumer
+    size_t stalls;          // prefetcher_advance calls that found no frame ready
+    double decode_seconds;  // Total time spent decoding
+} PrefetchStats;
+
+typedef struct FramePrefetcher FramePrefetcher;
+
+/**
+ * @brief Starts a background thread that decodes frames ahead of playback.
+ *
+ * The output buffers of the ring are allocated up front, sized from the first
+ * frame, and reused for every later frame. Decoding itself still allocates
+ * per frame: opening each npz reads its zip directory into fresh tables, and
+ * stb_image decodes into its own buffer that is copied into the slot. Those
+ * are freed before the frame is queued, so memory stays flat, but they are
+ * not preallocated. Decoded frames are handed to the consumer
+ * through a lock-free single-producer/single-consumer queue, and consumed
+ * buffers go back to the decoder through a second one.
+ *
+ * @param dataset Dataset to play; must outlive the prefetcher.
+ * @param options Prefetch settings, or NULL for defaults.
+ * @return Prefetcher handle, or NULL on failure.
+ */
+FramePrefetcher* prefetcher_start(const Dataset* dataset, const PrefetchOptions* options);
+
+/**
+ * @brief Steps to the next frame if it has been decoded. Never blocks.
+ *
+ * On success *current is replaced by the new frame and the buffer it pointed
+ * to is handed back to the decoder. Otherwise *current is left untouched.
+ * Only one thread may call advance or wait.
+ *
+ * @param current Frame on screen (NULL before the first frame).
+ * @return true if *current now points to a new frame.
+ */
+bool prefetcher_advance(FramePrefetcher* prefetcher, const PrefetchedFrame** current);
+
+// Blocking form of prefetcher_advance. Returns false once a non-looping sequence has ended.
+bool prefetcher_wait(FramePrefetcher* prefetcher, const PrefetchedFrame** current);
+
+void prefetcher_get_stats(const FramePrefetcher* prefetcher, PrefetchStats* stats);
+
+// Stops the decoder and frees every buffer, including the frame on screen
+void prefetcher_stop(FramePrefetcher* prefetcher);
+
+#endif // PREFETCH_H
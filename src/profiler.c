@@ -0,0 +1,100 @@
+// File: src/profiler.c
+#include "profiler.h"
+#include "platform.h"
+#include "perf_counters.h"
+#include "trace.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* stage_names[PROFILE_STAGE_COUNT] = {
+    "clear", "project", "bin", "rasterize", "upload", "resolve", "present"
+};
+
+void profiler_init(FrameProfiler* profiler) {
+    memset(profiler, 0, sizeof(*profiler));
+}
+
+void profiler_begin_frame(FrameProfiler* profiler) {
+    double now = platform_time_seconds();
+
+    if (profiler->frame_start > 0.0) {
+        size_t slot = profiler->next;
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+            profiler->history[stage][slot] = (float)(profiler->current[stage] * 1000.0);
+        }
+        profiler->history[PROFILE_STAGE_COUNT][slot] = (float)((now - profiler->frame_start) * 1000.0);
+        profiler->last_counters = profiler->current_counters;
+        profiler->next = (slot + 1) % PROFILE_HISTORY;
+        if (profiler->count < PROFILE_HISTORY) profiler->count++;
+        profiler->total_frames++;
+        if (profiler->perf) perf_counters_frame(profiler->perf);
+    }
+
+    trace_next_frame();
+    memset(profiler->current, 0, sizeof(profiler->current));
+    memset(&profiler->current_counters, 0, sizeof(profiler->current_counters));
+    profiler->frame_start = now;
+}
+
+double profiler_begin(FrameProfiler* profiler, ProfileStage stage) {
+    trace_begin(stage_names[stage]);
+    if (profiler->perf) perf_counters_begin(profiler->perf);
+    return platform_time_seconds();
+}
+
+void profiler_end(FrameProfiler* profiler, ProfileStage stage, double start) {
+    profiler->current[stage] += platform_time_seconds() - start;
+    if (profiler->perf) perf_counters_end(profiler->perf, stage);
+    trace_end(stage_names[stage]);
+}
+
+void profiler_set_counters(FrameProfiler* profiler, const FrameCounters* counters) {
+    profiler->current_counters = *counters;
+}
+
+static int compare_float(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return fa < fb ? -1 : (fa > fb ? 1 : 0);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const float* sorted, size_t count, double fraction) {
+    size_t rank = (size_t)ceil(fraction * count);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+static void summarize(const float* samples, size_t count, ProfileStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (count == 0) return;
+
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, samples, count * sizeof(float));
+    qsort(sorted, count, sizeof(float), compare_float);
+
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) sum += sorted[i];
+    stats->p50 = percentile(sorted, count, 0.50);
+    stats->p95 = percentile(sorted, count, 0.95);
+    stats->p99 = percentile(sorted, count, 0.99);
+    stats->mean = sum / count;
+    stats->max = sorted[count - 1];
+}
+
+void profiler_get_report(const FrameProfiler* profiler, ProfileReport* report) {
+    memset(report, 0, sizeof(*report));
+    report->frames = profiler->count;
+    report->counters = profiler->last_counters;
+
+    // The ring is only partly filled until PROFILE_HISTORY frames have passed; order does not matter here
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        summarize(profiler->history[stage], profiler->count, &report->stages[stage]);
+    }
+    summarize(profiler->history[PROFILE_STAGE_COUNT], profiler->count, &report->frame);
+}
+
+const char* profile_stage_name(ProfileStage stage) {
+    return stage >= 0 && stage < PROFILE_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
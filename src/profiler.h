@@ -0,0 +1,87 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define PROFILE_HISTORY 256   // Frames kept for the rolling percentiles
+
+struct PerfCounters;
+
+// Stages of a frame, in the order they run
+typedef enum {
+    PROFILE_CLEAR = 0,     // Framebuffer and depth buffer reset
+    PROFILE_PROJECT,       // Projection and culling
+    PROFILE_BIN,           // Setting up the per-block bins the projected splats are grouped in
+    PROFILE_RASTERIZE,     // Blending the projected splats into the framebuffer
+    PROFILE_UPLOAD,        // Copying the framebuffer into the texture
+    PROFILE_RESOLVE,       // Drawing the texture onto the window
+    PROFILE_PRESENT,       // Buffer swap
+    PROFILE_STAGE_COUNT
+} ProfileStage;
+
+// Splat counts of one frame
+typedef struct {
+    int visible;
+    int behind_camera;
+    int outside_screen;
+} FrameCounters;
+
+// Distribution of one stage over the frames in the history, in milliseconds
+typedef struct {
+    double p50, p95, p99;
+    double mean, max;
+} ProfileStats;
+
+typedef struct {
+    size_t frames;                               // Frames the statistics cover
+    ProfileStats stages[PROFILE_STAGE_COUNT];
+    ProfileStats frame;                          // From the start of one frame to the start of the next
+    FrameCounters counters;                      // Of the last completed frame
+} ProfileReport;
+
+/**
+ * Per-frame stage timings kept in a fixed ring of the last PROFILE_HISTORY
+ * frames. Recording a stage costs two monotonic clock reads and an add;
+ * nothing is printed or allocated. Percentiles are computed when a report
+ * is requested.
+ *
+ * A profiler is used by one thread, the one that drives the frames.
+ *
+ * Hardware counters are optional: when perf is set (see perf_counters.h),
+ * every stage scope also reads them; otherwise the only cost is a branch.
+ * Stage scopes and frames also appear in the timeline while tracing
+ * (see trace.h).
+ */
+typedef struct {
+    double current[PROFILE_STAGE_COUNT];         // Stage seconds of the frame in progress
+    FrameCounters current_counters;
+    double frame_start;                          // 0 before the first frame
+    float history[PROFILE_STAGE_COUNT + 1][PROFILE_HISTORY];  // Milliseconds; the last row is the frame time
+    FrameCounters last_counters;
+    size_t next;                                 // Ring slot of the next completed frame
+    size_t count;                                // Completed frames in the ring
+    unsigned long long total_frames;
+    struct PerfCounters* perf;                   // Hardware counters read around the stages, or NULL
+} FrameProfiler;
+
+// Resets everything, including perf
+void profiler_init(FrameProfiler* profiler);
+
+// Completes the previous frame, if any, and starts timing a new one
+void profiler_begin_frame(FrameProfiler* profiler);
+
+// Start time of a stage scope, for profiler_end; stage scopes do not nest
+double profiler_begin(FrameProfiler* profiler, ProfileStage stage);
+
+// Adds the time since start to a stage of the current frame
+void profiler_end(FrameProfiler* profiler, ProfileStage stage, double start);
+
+void profiler_set_counters(FrameProfiler* profiler, const FrameCounters* counters);
+
+// Percentiles over the completed frames in the history
+void profiler_get_report(const FrameProfiler* profiler, ProfileReport* report);
+
+const char* profile_stage_name(ProfileStage stage);
+
+#endif // PROFILER_H
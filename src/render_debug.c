@@ -0,0 +1,177 @@
+// File: src/render_debug.c
+#include "render_debug.h"
+#include "log.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+
+static const char* mode_names[DEBUG_MODE_COUNT] = {"none", "overdraw", "tiles", "reject", "radius"};
+
+// Per-pixel counts of one debug frame, taken from the frame arena
+typedef struct {
+    uint32_t* covered;
+    uint32_t* shaded;
+    uint32_t* rejected;
+    float* front_radius;   // Radius of the splat that passed the depth test last, 0 for none
+} DebugBuffers;
+
+static int radius_bucket(float radius) {
+    if (!(radius >= 0.5f)) return 0;
+    int bucket = 1 + (int)floorf(log2f(radius * 2.0f));
+    return bucket < DEBUG_RADIUS_BUCKETS ? bucket : DEBUG_RADIUS_BUCKETS - 1;
+}
+
+float debug_radius_bucket_floor(int bucket) {
+    return bucket <= 0 ? 0.0f : ldexpf(0.5f, bucket - 1);
+}
+
+const char* debug_mode_name(DebugMode mode) {
+    return mode >= 0 && mode < DEBUG_MODE_COUNT ? mode_names[mode] : "unknown";
+}
+
+DebugMode debug_mode_from_name(const char* name) {
+    for (int mode = 0; mode < DEBUG_MODE_COUNT; mode++) {
+        if (strcmp(name, mode_names[mode]) == 0) return (DebugMode)mode;
+    }
+    return DEBUG_NONE;
+}
+
+// Black, blue, green, yellow, red for t from 0 to 1
+static void heat_color(float t, unsigned char* pixel) {
+    static const float stops[5][3] = {{0, 0, 0}, {0, 0, 255}, {0, 255, 0}, {255, 255, 0}, {255, 0, 0}};
+    t = fminf(fmaxf(t, 0.0f), 1.0f) * 4.0f;
+    int i = t < 4.0f ? (int)t : 3;
+    float f = t - i;
+    for (int c = 0; c < 3; c++) {
+        pixel[c] = (unsigned char)(stops[i][c] + (stops[i + 1][c] - stops[i][c]) * f + 0.5f);
+    }
+}
+
+// The regular rasterizer's footprint and depth test, counting instead of blending
+static void count_samples(Renderer* renderer, size_t block_count, const DebugBuffers* buffers, DebugStats* stats) {
+    unsigned long long covered = 0, shaded = 0, rejected = 0;
+    int width = renderer->width;
+
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:covered,shaded,rejected)
+    for (int block = 0; block < (int)block_count; block++) {
+        const ProjectedSplat* splat = renderer->projected + (size_t)block * PROJECT_BLOCK_SIZE;
+        for (int i = 0; i < renderer->block_counts[block]; i++, splat++) {
+            int min_x = (int)fmaxf(0, splat->x - splat->radius);
+            int max_x = (int)fminf(renderer->width - 1, splat->x + splat->radius);
+            int min_y = (int)fmaxf(0, splat->y - splat->radius);
+            int max_y = (int)fminf(renderer->height - 1, splat->y + splat->radius);
+            float inv_radius = 1.0f / splat->radius;
+
+            for (int y = min_y; y <= max_y; y++) {
+                float dy = (y - splat->y) * inv_radius;
+                for (int x = min_x; x <= max_x; x++) {
+                    float dx = (x - splat->x) * inv_radius;
+                    if (dx * dx + dy * dy > 1.0f) continue;
+
+                    int index = y * width + x;
+                    covered++;
+                    #pragma omp atomic
+                    buffers->covered[index]++;
+
+                    // Races between blocks on the depth test are the same as in the regular path
+                    if (splat->depth < renderer->depthbuffer[index]) {
+                        renderer->depthbuffer[index] = splat->depth;
+                        buffers->front_radius[index] = splat->radius;
+                        shaded++;
+                        #pragma omp atomic
+                        buffers->shaded[index]++;
+                    } else {
+                        rejected++;
+                        #pragma omp atomic
+                        buffers->rejected[index]++;
+                    }
+                }
+            }
+        }
+    }
+
+    stats->covered = covered;
+    stats->shaded = shaded;
+    stats->rejected = rejected;
+}
+
+// Average of the footprint samples over every tile, stored into each of its pixels
+static void fill_tile_values(const Renderer* renderer, const uint32_t* covered, float* values) {
+    int tiles_x = (renderer->width + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+    int tiles_y = (renderer->height + DEBUG_TILE_SIZE - 1) / DEBUG_TILE_SIZE;
+
+    #pragma omp parallel for
+    for (int tile = 0; tile < tiles_x * tiles_y; tile++) {
+        int x0 = tile % tiles_x * DEBUG_TILE_SIZE, y0 = tile / tiles_x * DEBUG_TILE_SIZE;
+        int x1 = x0 + DEBUG_TILE_SIZE < renderer->width ? x0 + DEBUG_TILE_SIZE : renderer->width;
+        int y1 = y0 + DEBUG_TILE_SIZE < renderer->height ? y0 + DEBUG_TILE_SIZE : renderer->height;
+        unsigned long long sum = 0;
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) sum += covered[y * renderer->width + x];
+        }
+        float average = (float)sum / ((x1 - x0) * (y1 - y0));
+        for (int y = y0; y < y1; y++) {
+            for (int x = x0; x < x1; x++) values[y * renderer->width + x] = average;
+        }
+    }
+}
+
+void render_debug_view(Renderer* renderer, size_t block_count, DebugMode mode, int limit) {
+    DebugStats* stats = &renderer->debug_stats;
+    memset(stats, 0, sizeof(*stats));
+    stats->mode = mode;
+
+    double start = profiler_begin(&renderer->profiler, PROFILE_RASTERIZE);
+    size_t pixels = (size_t)renderer->width * renderer->height;
+    DebugBuffers buffers;
+    buffers.covered = (uint32_t*)arena_alloc(&renderer->frame_arena, pixels * sizeof(uint32_t), 64);
+    buffers.shaded = (uint32_t*)arena_alloc(&renderer->frame_arena, pixels * sizeof(uint32_t), 64);
+    buffers.rejected = (uint32_t*)arena_alloc(&renderer->frame_arena, pixels * sizeof(uint32_t), 64);
+    buffers.front_radius = (float*)arena_alloc(&renderer->frame_arena, pixels * sizeof(float), 64);
+    if (!buffers.covered || !buffers.shaded || !buffers.rejected || !buffers.front_radius) {
+        log_error("Failed to allocate debug view buffers.");
+        profiler_end(&renderer->profiler, PROFILE_RASTERIZE, start);
+        return;
+    }
+    memset(buffers.covered, 0, pixels * sizeof(uint32_t));
+    memset(buffers.shaded, 0, pixels * sizeof(uint32_t));
+    memset(buffers.rejected, 0, pixels * sizeof(uint32_t));
+    memset(buffers.front_radius, 0, pixels * sizeof(float));
+
+    for (size_t block = 0; block < block_count; block++) {
+        const ProjectedSplat* splat = renderer->projected + block * PROJECT_BLOCK_SIZE;
+        for (int i = 0; i < renderer->block_counts[block]; i++) {
+            stats->radius_histogram[radius_bucket(splat[i].radius)]++;
+        }
+    }
+
+    count_samples(renderer, block_count, &buffers, stats);
+    profiler_end(&renderer->profiler, PROFILE_RASTERIZE, start);
+
+    // Reuses the radius buffer for the values once the counts are final
+    float* values = buffers.front_radius;
+    int count = (int)pixels;
+    if (mode == DEBUG_TILE_WORK) {
+        fill_tile_values(renderer, buffers.covered, values);
+    } else if (mode != DEBUG_RADIUS) {
+        const uint32_t* counts = mode == DEBUG_OVERDRAW ? buffers.shaded : buffers.rejected;
+        #pragma omp parallel for
+        for (int i = 0; i < count; i++) values[i] = (float)counts[i];
+    }
+
+    float max_value = 0.0f;
+    #pragma omp parallel for reduction(max:max_value)
+    for (int i = 0; i < count; i++) {
+        if (values[i] > max_value) max_value = values[i];
+    }
+    stats->max_value = max_value;
+    stats->saturation = limit > 0 ? (float)limit : fmaxf(max_value, 1.0f);
+
+    float scale = 1.0f / stats->saturation;
+    #pragma omp parallel for
+    for (int i = 0; i < count; i++) {
+        heat_color(values[i] * scale, &renderer->framebuffer[(size_t)i * 3]);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef RENDER_DEBUG_H
+#define RENDER_DEBUG_H
+
+#include "renderer.h"
+
+/**
+ * @brief Draws a heatmap of the current frame's pixel work into the framebuffer.
+ *
+ * Rasterizes the projected splats like the regular path, with the same depth
+ * test, but counts per pixel instead of blending, then maps the chosen count
+ * to colors from black through blue, green and yellow to red. Fills
+ * renderer->debug_stats, including a histogram of the visible splats' radii.
+ * Slower than regular drawing: counters are updated atomically.
+ *
+ * @param block_count Projection blocks in renderer->projected.
+ * @param limit Value drawn in the hottest color, or 0 for the frame's maximum.
+ */
+void render_debug_view(Renderer* renderer, size_t block_count, DebugMode mode, int limit);
+
+// Lower bound in pixels of a radius histogram bucket
+float debug_radius_bucket_floor(int bucket);
+
+const char* debug_mode_name(DebugMode mode);
+
+// DEBUG_NONE for names that match no mode
+DebugMode debug_mode_from_name(const char* name);
+
+#endif // RENDER_DEBUG_H
@@ -1,5 +1,10 @@
 // File: src/renderer.c
 #include "renderer.h"
+#include "perf_counters.h"
+#include "render_debug.h"
+#include "trace.h"
+#include "mem_track.h"
+#include "log.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -31,21 +36,32 @@ void check_shader_compilation(unsigned int shader, const char* type) {
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
     if (!success) {
         glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        printf("%s shader compilation failed: %s\n", type, infoLog);
+        log_error("%s shader compilation failed: %s", type, infoLog);
     }
 }
-void init_renderer(Renderer* renderer, int width, int height) {
+
+void init_renderer_headless(Renderer* renderer, int width, int height) {
     // Initialize renderer parameters
+    memset(renderer, 0, sizeof(*renderer));
     renderer->width = width;
     renderer->height = height;
-
-    // Allocate memory for framebuffer and depthbuffer
-    renderer->framebuffer = (unsigned char*)malloc(width * height * 3 * sizeof(unsigned char));
-    renderer->depthbuffer = (float*)malloc(width * height * sizeof(float));
+    renderer->projected = NULL;
+    renderer->block_counts = NULL;
+    arena_init(&renderer->frame_arena, 0);
+    renderer->frame_arena.subsystem = MEM_RENDERER;
+    profiler_init(&renderer->profiler);
+
+    // Allocate memory for framebuffer and depthbuffer; both are swept every frame, so huge pages save TLB misses
+    renderer->framebuffer = (unsigned char*)large_alloc(MEM_RENDERER, width * height * 3 * sizeof(unsigned char));
+    renderer->depthbuffer = (float*)large_alloc(MEM_RENDERER, width * height * sizeof(float));
     if (!renderer->framebuffer || !renderer->depthbuffer) {
-        printf("Error: Failed to allocate memory for framebuffer or depthbuffer.\n");
+        log_error("Failed to allocate memory for framebuffer or depthbuffer.");
         exit(EXIT_FAILURE);
     }
+}
+
+void init_renderer(Renderer* renderer, int width, int height) {
+    init_renderer_headless(renderer, width, height);
 
     // Generate and configure the texture
     glGenTextures(1, &renderer->texture);
@@ -57,7 +73,7 @@ void init_renderer(Renderer* renderer, int width, int height) {
 
     // Check for texture creation errors
     if (!renderer->texture) {
-        printf("Error: Failed to generate OpenGL texture.\n");
+        log_error("Failed to generate OpenGL texture.");
         exit(EXIT_FAILURE);
     }
 
@@ -84,16 +100,16 @@ void init_renderer(Renderer* renderer, int width, int height) {
     glGetProgramiv(renderer->shaderProgram, GL_LINK_STATUS, &success);
     if (!success) {
         glGetProgramInfoLog(renderer->shaderProgram, 512, NULL, infoLog);
-        printf("Error: Shader program linking failed: %s\n", infoLog);
+        log_error("Shader program linking failed: %s", infoLog);
         exit(EXIT_FAILURE);
     }
 
     // Validate the shader program
     if (!glIsProgram(renderer->shaderProgram)) {
-        printf("Error: Shader program is not valid.\n");
+        log_error("Shader program is not valid.");
         exit(EXIT_FAILURE);
     } else {
-        printf("Shader program is valid.\n");
+        log_debug("Shader program is valid.");
     }
 
     // Clean up shaders as they are linked into the program
@@ -141,7 +157,7 @@ void init_renderer(Renderer* renderer, int width, int height) {
     // Ensure OpenGL errors are handled
     GLenum error = glGetError();
     if (error != GL_NO_ERROR) {
-        printf("OpenGL error during renderer initialization: 0x%x\n", error);
+        log_error("OpenGL error during renderer initialization: 0x%x", error);
         exit(EXIT_FAILURE);
     }
 }
@@ -162,157 +178,585 @@ void clear_renderer(Renderer* renderer) {
 #include <immintrin.h>  // For SSE intrinsics
 #include <omp.h>        // For OpenMP parallelization
 
-void render_scene(Renderer* renderer, Splat* splats, int splat_count, Camera* camera, DebugMode debug_mode, int debug_limit) {
+// Each projection block's visible splats are stored compactly at the start
+// of the block's range in renderer->projected. Projection uses a static
+// schedule so every thread revisits the same splats and projected records
+// each frame, keeping them in its cache and on its NUMA node.
+
+// Per-frame camera constants shared by every projection path
+typedef struct {
+    vec3 right, up, front, pos;
+    float half_width, half_height;
+    float fov_tan, aspect_ratio;
+    float width, height;
+} ProjectionParams;
+
+static void setup_projection(const Renderer* renderer, const Camera* camera, ProjectionParams* params) {
+    params->half_width = renderer->width * 0.5f;
+    params->half_height = renderer->height * 0.5f;
+    params->fov_tan = tanf(45.0f * M_PI / 180.0f);  // Precompute tan(fov/2)
+    params->aspect_ratio = (float)renderer->width / (float)renderer->height;
+    params->width = (float)renderer->width;
+    params->height = (float)renderer->height;
+    params->right = camera->right;
+    params->up = camera->up;
+    params->front = camera->front;
+    params->pos = camera->position;
+}
+
+static void begin_frame(Renderer* renderer) {
+    profiler_begin_frame(&renderer->profiler);
+    double start = profiler_begin(&renderer->profiler, PROFILE_CLEAR);
+
+    arena_reset(&renderer->frame_arena);
+    renderer->projected = NULL;
+    renderer->block_counts = NULL;
+
     // Clear the framebuffer and depthbuffer efficiently using memset
     memset(renderer->framebuffer, 0, renderer->width * renderer->height * 3 * sizeof(unsigned char));
-    
+
     // Use SSE to initialize the depth buffer with INFINITY
     __m128 inf = _mm_set1_ps(INFINITY);
     for (int i = 0; i < renderer->width * renderer->height; i += 4) {
         _mm_store_ps(&renderer->depthbuffer[i], inf);
     }
+    profiler_end(&renderer->profiler, PROFILE_CLEAR, start);
+}
 
-    int visible_splats = 0, splats_behind_camera = 0, splats_outside_screen = 0;
-    bool debug_enabled = (debug_mode != DEBUG_NONE);
-    int debug_count = 0;
-
-    // Precompute useful values
-    float half_width = renderer->width * 0.5f;
-    float half_height = renderer->height * 0.5f;
-    float fov_tan = tanf(45.0f * M_PI / 180.0f);  // Precompute tan(fov/2)
-    float aspect_ratio = (float)renderer->width / (float)renderer->height;
-
-    // Precompute camera vectors
-    vec3 cam_right = camera->right;
-    vec3 cam_up = camera->up;
-    vec3 cam_front = camera->front;
-    vec3 cam_pos = camera->position;
-
-    #pragma omp parallel for reduction(+:visible_splats,splats_behind_camera,splats_outside_screen) schedule(dynamic, 64)
-    for (int i = 0; i < splat_count; i++) {
-        // Transform splat position to camera space
-        vec3 pos_cam = {
-            splats[i].x - cam_pos.x,
-            splats[i].y - cam_pos.y,
-            splats[i].z - cam_pos.z
-        };
-
-        vec3 pos_cam_transformed = {
-            pos_cam.x * cam_right.x + pos_cam.y * cam_right.y + pos_cam.z * cam_right.z,
-            pos_cam.x * cam_up.x + pos_cam.y * cam_up.y + pos_cam.z * cam_up.z,
-            pos_cam.x * cam_front.x + pos_cam.y * cam_front.y + pos_cam.z * cam_front.z
-        };
-
-        // Check if the splat is behind the camera
-        if (pos_cam_transformed.z <= 0) {
-            splats_behind_camera++;
-            continue;
-        }
+// Take one projected record per input splat from the frame arena.
+// The arena keeps its memory across frames, so this only reaches the heap while the scene grows.
+static bool reserve_projected(Renderer* renderer, size_t splat_count) {
+    double start = profiler_begin(&renderer->profiler, PROFILE_BIN);
+    size_t block_count = (splat_count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    renderer->projected = (ProjectedSplat*)arena_alloc(&renderer->frame_arena, splat_count * sizeof(ProjectedSplat), 64);
+    renderer->block_counts = (int*)arena_alloc(&renderer->frame_arena, block_count * sizeof(int), 64);
+    profiler_end(&renderer->profiler, PROFILE_BIN, start);
+    if (!renderer->projected || !renderer->block_counts) {
+        log_error("Failed to allocate memory for %zu projected splats.", splat_count);
+        return false;
+    }
+    return true;
+}
 
-        // Perspective Projection Calculation
-        float inv_z = 1.0f / pos_cam_transformed.z;
-        float scale = fov_tan * pos_cam_transformed.z;
-        float proj_x = (pos_cam_transformed.x / (aspect_ratio * scale)) * half_width + half_width;
-        float proj_y = -(pos_cam_transformed.y / scale) * half_height + half_height;
+// Project one splat; returns 0 when visible, 1 when behind the camera, 2 when off screen
+static inline int project_splat(const ProjectionParams* p, float x, float y, float z, float splat_scale,
+                                float r, float g, float b, float a, ProjectedSplat* out) {
+    // Transform splat position to camera space
+    vec3 pos_cam = { x - p->pos.x, y - p->pos.y, z - p->pos.z };
 
-        // Calculate splat radius in screen space
-        float radius = splats[i].scale * inv_z * renderer->width;
+    vec3 pos_cam_transformed = {
+        pos_cam.x * p->right.x + pos_cam.y * p->right.y + pos_cam.z * p->right.z,
+        pos_cam.x * p->up.x + pos_cam.y * p->up.y + pos_cam.z * p->up.z,
+        pos_cam.x * p->front.x + pos_cam.y * p->front.y + pos_cam.z * p->front.z
+    };
 
-        // Check if the splat is outside the screen bounds
-        if (proj_x + radius < 0 || proj_x - radius >= renderer->width || 
-            proj_y + radius < 0 || proj_y - radius >= renderer->height) {
-            splats_outside_screen++;
-            continue;
-        }
+    // Check if the splat is behind the camera
+    if (pos_cam_transformed.z <= 0) {
+        return 1;
+    }
+
+    // Perspective Projection Calculation
+    float inv_z = 1.0f / pos_cam_transformed.z;
+    float scale = p->fov_tan * pos_cam_transformed.z;
+    float proj_x = (pos_cam_transformed.x / (p->aspect_ratio * scale)) * p->half_width + p->half_width;
+    float proj_y = -(pos_cam_transformed.y / scale) * p->half_height + p->half_height;
+
+    // Calculate splat radius in screen space
+    float radius = splat_scale * inv_z * p->width;
+
+    // Check if the splat is outside the screen bounds
+    if (proj_x + radius < 0 || proj_x - radius >= p->width ||
+        proj_y + radius < 0 || proj_y - radius >= p->height) {
+        return 2;
+    }
+
+    out->x = proj_x;
+    out->y = proj_y;
+    out->depth = pos_cam_transformed.z;
+    out->radius = radius;
+    out->r = r;
+    out->g = g;
+    out->b = b;
+    out->a = a;
+    return 0;
+}
+
+// Project four SoA splats at once. Returns a 4-bit mask of visible lanes;
+// behind and outside receive masks of culled lanes for the frame counters.
+static inline int project_splat4(const ProjectionParams* p, __m128 x, __m128 y, __m128 z, __m128 splat_scale,
+                                 __m128* proj_x, __m128* proj_y, __m128* depth, __m128* radius,
+                                 int* behind, int* outside) {
+    __m128 px = _mm_sub_ps(x, _mm_set1_ps(p->pos.x));
+    __m128 py = _mm_sub_ps(y, _mm_set1_ps(p->pos.y));
+    __m128 pz = _mm_sub_ps(z, _mm_set1_ps(p->pos.z));
+
+    __m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(p->right.x)), _mm_mul_ps(py, _mm_set1_ps(p->right.y))),
+                           _mm_mul_ps(pz, _mm_set1_ps(p->right.z)));
+    __m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(p->up.x)), _mm_mul_ps(py, _mm_set1_ps(p->up.y))),
+                           _mm_mul_ps(pz, _mm_set1_ps(p->up.z)));
+    __m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(p->front.x)), _mm_mul_ps(py, _mm_set1_ps(p->front.y))),
+                           _mm_mul_ps(pz, _mm_set1_ps(p->front.z)));
+
+    *behind = _mm_movemask_ps(_mm_cmple_ps(cz, _mm_setzero_ps()));
+
+    __m128 half_w = _mm_set1_ps(p->half_width);
+    __m128 half_h = _mm_set1_ps(p->half_height);
+    __m128 scale = _mm_mul_ps(_mm_set1_ps(p->fov_tan), cz);
+    *proj_x = _mm_add_ps(_mm_mul_ps(_mm_div_ps(cx, _mm_mul_ps(_mm_set1_ps(p->aspect_ratio), scale)), half_w), half_w);
+    *proj_y = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_div_ps(cy, scale)), half_h), half_h);
+    *radius = _mm_mul_ps(_mm_mul_ps(splat_scale, _mm_div_ps(_mm_set1_ps(1.0f), cz)), _mm_set1_ps(p->width));
+    *depth = cz;
+
+    __m128 width = _mm_set1_ps(p->width);
+    __m128 height = _mm_set1_ps(p->height);
+    __m128 off_screen = _mm_or_ps(
+        _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(*proj_x, *radius), _mm_setzero_ps()),
+                  _mm_cmpge_ps(_mm_sub_ps(*proj_x, *radius), width)),
+        _mm_or_ps(_mm_cmplt_ps(_mm_add_ps(*proj_y, *radius), _mm_setzero_ps()),
+                  _mm_cmpge_ps(_mm_sub_ps(*proj_y, *radius), height)));
+
+    *outside = _mm_movemask_ps(off_screen) & ~*behind & 0xF;
+    return ~(*behind | *outside) & 0xF;
+}
 
-        visible_splats++;
-
-        // Rasterize the splat within its circular bounds
-        int min_x = (int)fmaxf(0, proj_x - radius);
-        int max_x = (int)fminf(renderer->width - 1, proj_x + radius);
-        int min_y = (int)fmaxf(0, proj_y - radius);
-        int max_y = (int)fminf(renderer->height - 1, proj_y + radius);
-
-        float inv_radius = 1.0f / radius;
-        __m128 splat_color = _mm_set_ps(splats[i].a, splats[i].b * 255.0f, splats[i].g * 255.0f, splats[i].r * 255.0f);
-        __m128 pos_z = _mm_set1_ps(pos_cam_transformed.z);
-
-        for (int y = min_y; y <= max_y; y++) {
-            float dy = (y - proj_y) * inv_radius;
-            float dy_sq = dy * dy;
-
-            for (int x = min_x; x <= max_x; x++) {
-                float dx = (x - proj_x) * inv_radius;
-                float dist_sq = dx * dx + dy_sq;
-
-                if (dist_sq <= 1.0f) {
-                    int buffer_index = (y * renderer->width + x);
-                    float* depth = &renderer->depthbuffer[buffer_index];
-
-                    if (pos_cam_transformed.z < *depth) {
-                        float alpha = splats[i].a * expf(-dist_sq);
-                        unsigned char* pixel = &renderer->framebuffer[buffer_index * 3];
-
-                        __m128 curr_color = _mm_set_ps(1.0f, pixel[2], pixel[1], pixel[0]);
-                        __m128 alpha_vec = _mm_set1_ps(alpha);
-                        __m128 result = _mm_add_ps(
-                            _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), alpha_vec), curr_color),
-                            _mm_mul_ps(alpha_vec, splat_color)
-                        );
-
-                        _mm_store_ss(depth, pos_z);
-                        __m128i result_int = _mm_cvtps_epi32(result);
-                        pixel[0] = _mm_extract_epi8(result_int, 0);
-                        pixel[1] = _mm_extract_epi8(result_int, 4);
-                        pixel[2] = _mm_extract_epi8(result_int, 8);
+// Store the visible lanes of a projected group of four; returns how many were stored
+static inline int emit_visible4(ProjectedSplat* out, int mask, __m128 proj_x, __m128 proj_y, __m128 depth, __m128 radius,
+                                const float* r, const float* g, const float* b, const float* a) {
+    float lane_x[4], lane_y[4], lane_depth[4], lane_radius[4];
+    _mm_storeu_ps(lane_x, proj_x);
+    _mm_storeu_ps(lane_y, proj_y);
+    _mm_storeu_ps(lane_depth, depth);
+    _mm_storeu_ps(lane_radius, radius);
+
+    int stored = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        if (!(mask & (1 << lane))) continue;
+        ProjectedSplat* dst = &out[stored++];
+        dst->x = lane_x[lane];
+        dst->y = lane_y[lane];
+        dst->depth = lane_depth[lane];
+        dst->radius = lane_radius[lane];
+        dst->r = r[lane];
+        dst->g = g[lane];
+        dst->b = b[lane];
+        dst->a = a[lane];
+    }
+    return stored;
+}
+
+// Blend every projected splat into the framebuffer
+static void rasterize_projected(Renderer* renderer, size_t block_count) {
+    const ProjectedSplat* projected = renderer->projected;
+    const int* block_counts = renderer->block_counts;
+    double start = profiler_begin(&renderer->profiler, PROFILE_RASTERIZE);
+
+    #pragma omp parallel
+    {
+        trace_begin("rasterize blocks");
+        #pragma omp for schedule(dynamic, 1) nowait
+        for (int block = 0; block < (int)block_count; block++) {
+            const ProjectedSplat* splat = projected + (size_t)block * PROJECT_BLOCK_SIZE;
+            for (int i = 0; i < block_counts[block]; i++, splat++) {
+                float proj_x = splat->x;
+                float proj_y = splat->y;
+                float radius = splat->radius;
+
+                // Rasterize the splat within its circular bounds
+                int min_x = (int)fmaxf(0, proj_x - radius);
+                int max_x = (int)fminf(renderer->width - 1, proj_x + radius);
+                int min_y = (int)fmaxf(0, proj_y - radius);
+                int max_y = (int)fminf(renderer->height - 1, proj_y + radius);
+
+                float inv_radius = 1.0f / radius;
+                __m128 splat_color = _mm_set_ps(splat->a, splat->b * 255.0f, splat->g * 255.0f, splat->r * 255.0f);
+                __m128 pos_z = _mm_set1_ps(splat->depth);
+
+                for (int y = min_y; y <= max_y; y++) {
+                    float dy = (y - proj_y) * inv_radius;
+                    float dy_sq = dy * dy;
+
+                    for (int x = min_x; x <= max_x; x++) {
+                        float dx = (x - proj_x) * inv_radius;
+                        float dist_sq = dx * dx + dy_sq;
+
+                        if (dist_sq <= 1.0f) {
+                            int buffer_index = (y * renderer->width + x);
+                            float* depth = &renderer->depthbuffer[buffer_index];
+
+                            if (splat->depth < *depth) {
+                                float alpha = splat->a * expf(-dist_sq);
+                                unsigned char* pixel = &renderer->framebuffer[buffer_index * 3];
+
+                                __m128 curr_color = _mm_set_ps(1.0f, pixel[2], pixel[1], pixel[0]);
+                                __m128 alpha_vec = _mm_set1_ps(alpha);
+                                __m128 result = _mm_add_ps(
+                                    _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), alpha_vec), curr_color),
+                                    _mm_mul_ps(alpha_vec, splat_color)
+                                );
+
+                                _mm_store_ss(depth, pos_z);
+                                __m128i result_int = _mm_cvtps_epi32(result);
+                                pixel[0] = _mm_extract_epi8(result_int, 0);
+                                pixel[1] = _mm_extract_epi8(result_int, 4);
+                                pixel[2] = _mm_extract_epi8(result_int, 8);
+                            }
+                        }
                     }
                 }
             }
         }
+        trace_end("rasterize blocks");
+    }
+    profiler_end(&renderer->profiler, PROFILE_RASTERIZE, start);
+}
+
+// Blends the projected splats, or draws the requested debug heatmap in their place
+static void rasterize_frame(Renderer* renderer, size_t block_count, DebugMode debug_mode, int debug_limit) {
+    if (debug_mode == DEBUG_NONE) {
+        renderer->debug_stats.mode = DEBUG_NONE;
+        rasterize_projected(renderer, block_count);
+    } else {
+        render_debug_view(renderer, block_count, debug_mode, debug_limit);
     }
+}
 
-    // Summary Logging
-    printf("Total splats behind camera: %d\n", splats_behind_camera);
-    printf("Total splats outside screen bounds: %d\n", splats_outside_screen);
-    printf("Visible splats: %d\n", visible_splats);
+static void end_frame(Renderer* renderer, const FrameCounters* counts) {
+    // The counts are reported through the profiler; printing them every frame costs more than it tells
+    profiler_set_counters(&renderer->profiler, counts);
 
-    // Update the OpenGL texture with the rendered framebuffer
+    // Update the OpenGL texture with the rendered framebuffer; a headless renderer has none
+    if (!renderer->texture) return;
+    double start = profiler_begin(&renderer->profiler, PROFILE_UPLOAD);
     glBindTexture(GL_TEXTURE_2D, renderer->texture);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderer->width, renderer->height, GL_RGB, GL_UNSIGNED_BYTE, renderer->framebuffer);
+    profiler_end(&renderer->profiler, PROFILE_UPLOAD, start);
+}
+
+// Shared by render_scene and render_scene_replicated; replicas == NULL reads splats
+static void render_splats(Renderer* renderer, const Splat* splats, const NumaReplicas* replicas, int splat_count,
+                          Camera* camera, DebugMode debug_mode, int debug_limit) {
+    begin_frame(renderer);
+
+    FrameCounters counts = {0, 0, 0};
+    if (splat_count <= 0 || !reserve_projected(renderer, (size_t)splat_count)) {
+        end_frame(renderer, &counts);
+        return;
+    }
+
+    double project_start = profiler_begin(&renderer->profiler, PROFILE_PROJECT);
+    ProjectionParams params;
+    setup_projection(renderer, camera, &params);
+
+    int block_count = (splat_count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    int visible_splats = 0, splats_behind_camera = 0, splats_outside_screen = 0;
+
+    #pragma omp parallel reduction(+:visible_splats,splats_behind_camera,splats_outside_screen)
+    {
+        trace_begin("project blocks");
+        #pragma omp for schedule(static) nowait
+        for (int block = 0; block < block_count; block++) {
+            int first = block * PROJECT_BLOCK_SIZE;
+            int last = first + PROJECT_BLOCK_SIZE < splat_count ? first + PROJECT_BLOCK_SIZE : splat_count;
+            ProjectedSplat* out = renderer->projected + first;
+            const Splat* source = replicas ? (const Splat*)numa_replicas_local(replicas) : splats;
+            int visible = 0;
+
+            for (int i = first; i < last; i++) {
+                const Splat* splat = &source[i];
+                int result = project_splat(&params, splat->x, splat->y, splat->z, splat->scale,
+                                           splat->r, splat->g, splat->b, splat->a, &out[visible]);
+                if (result == 0) visible++;
+                else if (result == 1) splats_behind_camera++;
+                else splats_outside_screen++;
+            }
+
+            renderer->block_counts[block] = visible;
+            visible_splats += visible;
+        }
+        trace_end("project blocks");
+    }
+
+    profiler_end(&renderer->profiler, PROFILE_PROJECT, project_start);
+    counts.visible = visible_splats;
+    counts.behind_camera = splats_behind_camera;
+    counts.outside_screen = splats_outside_screen;
+
+    rasterize_frame(renderer, (size_t)block_count, debug_mode, debug_limit);
+    end_frame(renderer, &counts);
+}
+
+void render_scene(Renderer* renderer, Splat* splats, int splat_count, Camera* camera, DebugMode debug_mode, int debug_limit) {
+    render_splats(renderer, splats, NULL, splat_count, camera, debug_mode, debug_limit);
+}
+
+void render_scene_replicated(Renderer* renderer, const NumaReplicas* splats, int splat_count, Camera* camera, DebugMode debug_mode, int debug_limit) {
+    render_splats(renderer, NULL, splats, splat_count, camera, debug_mode, debug_limit);
 }
 
+// Project splats [first, last) of an attribute view into out; returns how many are visible
+static int project_arrays_range(const ProjectionParams* params, const SplatArrays* splats, int first, int last,
+                                ProjectedSplat* out, int* behind_camera, int* outside_screen) {
+    int visible = 0;
+    int i = first;
+
+    // Four splats per iteration straight from the attribute arrays
+    for (; i + 4 <= last; i += 4) {
+        __m128 proj_x, proj_y, depth, radius;
+        int behind, outside;
+        int mask = project_splat4(params, _mm_loadu_ps(splats->x + i), _mm_loadu_ps(splats->y + i),
+                                  _mm_loadu_ps(splats->z + i), _mm_loadu_ps(splats->scale + i),
+                                  &proj_x, &proj_y, &depth, &radius, &behind, &outside);
+        *behind_camera += __builtin_popcount(behind);
+        *outside_screen += __builtin_popcount(outside);
+        if (!mask) continue;
+
+        visible += emit_visible4(out + visible, mask, proj_x, proj_y, depth, radius,
+                                 splats->r + i, splats->g + i, splats->b + i, splats->a + i);
+    }
+
+    for (; i < last; i++) {
+        int result = project_splat(params, splats->x[i], splats->y[i], splats->z[i], splats->scale[i],
+                                   splats->r[i], splats->g[i], splats->b[i], splats->a[i], &out[visible]);
+        if (result == 0) visible++;
+        else if (result == 1) (*behind_camera)++;
+        else (*outside_screen)++;
+    }
+    return visible;
+}
+
+void render_scene_arrays(Renderer* renderer, const SplatArrays* splats, Camera* camera, DebugMode debug_mode, int debug_limit) {
+    begin_frame(renderer);
+
+    FrameCounters counts = {0, 0, 0};
+    if (splats->count == 0 || !reserve_projected(renderer, splats->count)) {
+        end_frame(renderer, &counts);
+        return;
+    }
+
+    double project_start = profiler_begin(&renderer->profiler, PROFILE_PROJECT);
+    ProjectionParams params;
+    setup_projection(renderer, camera, &params);
+
+    int splat_count = (int)splats->count;
+    int block_count = (splat_count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    int visible_splats = 0, splats_behind_camera = 0, splats_outside_screen = 0;
+
+    #pragma omp parallel reduction(+:visible_splats,splats_behind_camera,splats_outside_screen)
+    {
+        trace_begin("project blocks");
+        #pragma omp for schedule(static) nowait
+        for (int block = 0; block < block_count; block++) {
+            int first = block * PROJECT_BLOCK_SIZE;
+            int last = first + PROJECT_BLOCK_SIZE < splat_count ? first + PROJECT_BLOCK_SIZE : splat_count;
+            int visible = project_arrays_range(&params, splats, first, last, renderer->projected + first,
+                                               &splats_behind_camera, &splats_outside_screen);
+            renderer->block_counts[block] = visible;
+            visible_splats += visible;
+        }
+        trace_end("project blocks");
+    }
+
+    profiler_end(&renderer->profiler, PROFILE_PROJECT, project_start);
+    counts.visible = visible_splats;
+    counts.behind_camera = splats_behind_camera;
+    counts.outside_screen = splats_outside_screen;
+
+    rasterize_frame(renderer, (size_t)block_count, debug_mode, debug_limit);
+    end_frame(renderer, &counts);
+}
+
+// One projection block of render_scene_chunks
+typedef struct {
+    const SplatArrays* chunk;
+    int first, last;
+} ChunkBlock;
+
+void render_scene_chunks(Renderer* renderer, const SplatArrays* chunks, size_t chunk_count, Camera* camera, DebugMode debug_mode, int debug_limit) {
+    begin_frame(renderer);
+
+    // Every chunk starts a new projection block, so a block never reads from two chunks
+    double bin_start = profiler_begin(&renderer->profiler, PROFILE_BIN);
+    size_t block_count = 0;
+    for (size_t c = 0; c < chunk_count; c++) {
+        block_count += (chunks[c].count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    }
+
+    ChunkBlock* blocks = block_count ? (ChunkBlock*)arena_alloc(&renderer->frame_arena, block_count * sizeof(ChunkBlock), 64) : NULL;
+    size_t block = 0;
+    for (size_t c = 0; blocks && c < chunk_count; c++) {
+        for (size_t first = 0; first < chunks[c].count; first += PROJECT_BLOCK_SIZE, block++) {
+            blocks[block].chunk = &chunks[c];
+            blocks[block].first = (int)first;
+            blocks[block].last = (int)(first + PROJECT_BLOCK_SIZE < chunks[c].count ? first + PROJECT_BLOCK_SIZE : chunks[c].count);
+        }
+    }
+    profiler_end(&renderer->profiler, PROFILE_BIN, bin_start);
+
+    // Times itself as a separate bin scope, as stage scopes do not nest
+    FrameCounters counts = {0, 0, 0};
+    if (!blocks || !reserve_projected(renderer, block_count * PROJECT_BLOCK_SIZE)) {
+        end_frame(renderer, &counts);
+        return;
+    }
+
+    double project_start = profiler_begin(&renderer->profiler, PROFILE_PROJECT);
+    ProjectionParams params;
+    setup_projection(renderer, camera, &params);
+
+    int visible_splats = 0, splats_behind_camera = 0, splats_outside_screen = 0;
+
+    #pragma omp parallel reduction(+:visible_splats,splats_behind_camera,splats_outside_screen)
+    {
+        trace_begin("project blocks");
+        #pragma omp for schedule(static) nowait
+        for (int b = 0; b < (int)block_count; b++) {
+            int visible = project_arrays_range(&params, blocks[b].chunk, blocks[b].first, blocks[b].last,
+                                               renderer->projected + (size_t)b * PROJECT_BLOCK_SIZE,
+                                               &splats_behind_camera, &splats_outside_screen);
+            renderer->block_counts[b] = visible;
+            visible_splats += visible;
+        }
+        trace_end("project blocks");
+    }
+
+    profiler_end(&renderer->profiler, PROFILE_PROJECT, project_start);
+    counts.visible = visible_splats;
+    counts.behind_camera = splats_behind_camera;
+    counts.outside_screen = splats_outside_screen;
+
+    rasterize_frame(renderer, block_count, debug_mode, debug_limit);
+    end_frame(renderer, &counts);
+}
+
+
+_Static_assert(QUANT_CHUNK_SIZE % 4 == 0, "quantized decode works on groups of four");
+
+// Decode four 16-bit offsets of one axis into positions
+static inline __m128 decode_axis4(const uint16_t* q, float origin, float step) {
+    __m128i words = _mm_loadl_epi64((const __m128i*)q);
+    __m128 values = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128()));
+    return _mm_add_ps(_mm_set1_ps(origin), _mm_mul_ps(values, _mm_set1_ps(step)));
+}
+
+void render_scene_quantized(Renderer* renderer, const QuantizedScene* scene, Camera* camera, DebugMode debug_mode, int debug_limit) {
+    begin_frame(renderer);
+
+    FrameCounters counts = {0, 0, 0};
+    if (scene->count == 0 || !reserve_projected(renderer, scene->count)) {
+        end_frame(renderer, &counts);
+        return;
+    }
+
+    double project_start = profiler_begin(&renderer->profiler, PROFILE_PROJECT);
+    ProjectionParams params;
+    setup_projection(renderer, camera, &params);
+
+    int splat_count = (int)scene->count;
+    int block_count = (splat_count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    int visible_splats = 0, splats_behind_camera = 0, splats_outside_screen = 0;
+
+    #pragma omp parallel reduction(+:visible_splats,splats_behind_camera,splats_outside_screen)
+    {
+        trace_begin("project blocks");
+        #pragma omp for schedule(static) nowait
+        for (int block = 0; block < block_count; block++) {
+            int first = block * PROJECT_BLOCK_SIZE;
+            int last = first + PROJECT_BLOCK_SIZE < splat_count ? first + PROJECT_BLOCK_SIZE : splat_count;
+            ProjectedSplat* out = renderer->projected + first;
+            int visible = 0;
+            int i = first;
+
+            // Chunks never straddle a group of four because QUANT_CHUNK_SIZE is a multiple of 4
+            for (; i + 4 <= last; i += 4) {
+                const QuantChunk* chunk = &scene->chunks[i / QUANT_CHUNK_SIZE];
+                __m128 x = decode_axis4(scene->qx + i, chunk->origin[0], chunk->step[0]);
+                __m128 y = decode_axis4(scene->qy + i, chunk->origin[1], chunk->step[1]);
+                __m128 z = decode_axis4(scene->qz + i, chunk->origin[2], chunk->step[2]);
+                __m128 splat_scale = _mm_set_ps(scene->scale_lut[scene->scale_code[i + 3]], scene->scale_lut[scene->scale_code[i + 2]],
+                                                scene->scale_lut[scene->scale_code[i + 1]], scene->scale_lut[scene->scale_code[i]]);
+
+                __m128 proj_x, proj_y, depth, radius;
+                int behind, outside;
+                int mask = project_splat4(&params, x, y, z, splat_scale, &proj_x, &proj_y, &depth, &radius, &behind, &outside);
+                splats_behind_camera += __builtin_popcount(behind);
+                splats_outside_screen += __builtin_popcount(outside);
+                if (!mask) continue;
+
+                // Unpack 8-bit color and opacity of the group
+                __m128i rgba = _mm_loadu_si128((const __m128i*)(scene->rgba + i));
+                __m128i byte_mask = _mm_set1_epi32(0xff);
+                __m128 to_unit = _mm_set1_ps(1.0f / 255.0f);
+                float r[4], g[4], b[4], a[4];
+                _mm_storeu_ps(r, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(rgba, byte_mask)), to_unit));
+                _mm_storeu_ps(g, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgba, 8), byte_mask)), to_unit));
+                _mm_storeu_ps(b, _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgba, 16), byte_mask)), to_unit));
+                _mm_storeu_ps(a, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(rgba, 24)), to_unit));
+
+                visible += emit_visible4(out + visible, mask, proj_x, proj_y, depth, radius, r, g, b, a);
+            }
+
+            for (; i < last; i++) {
+                Splat splat;
+                quant_scene_decode(scene, (size_t)i, &splat);
+                int result = project_splat(&params, splat.x, splat.y, splat.z, splat.scale,
+                                           splat.r, splat.g, splat.b, splat.a, &out[visible]);
+                if (result == 0) visible++;
+                else if (result == 1) splats_behind_camera++;
+                else splats_outside_screen++;
+            }
+
+            renderer->block_counts[block] = visible;
+            visible_splats += visible;
+        }
+        trace_end("project blocks");
+    }
+
+    profiler_end(&renderer->profiler, PROFILE_PROJECT, project_start);
+    counts.visible = visible_splats;
+    counts.behind_camera = splats_behind_camera;
+    counts.outside_screen = splats_outside_screen;
+
+    rasterize_frame(renderer, (size_t)block_count, debug_mode, debug_limit);
+    end_frame(renderer, &counts);
+}
 
 void draw_fullscreen_quad(Renderer* renderer) {
+    double start = profiler_begin(&renderer->profiler, PROFILE_RESOLVE);
     glUseProgram(renderer->shaderProgram);
     GLenum error = glGetError();
     if (error != GL_NO_ERROR) {
-        printf("OpenGL error after glUseProgram: 0x%x\n", error);
+        log_error("OpenGL error after glUseProgram: 0x%x", error);
     }
 
     glBindTexture(GL_TEXTURE_2D, renderer->texture);
     error = glGetError();
     if (error != GL_NO_ERROR) {
-        printf("OpenGL error after glBindTexture: 0x%x\n", error);
+        log_error("OpenGL error after glBindTexture: 0x%x", error);
     }
 
     glBindVertexArray(renderer->VAO);
     error = glGetError();
     if (error != GL_NO_ERROR) {
-        printf("OpenGL error after glBindVertexArray: 0x%x\n", error);
+        log_error("OpenGL error after glBindVertexArray: 0x%x", error);
     }
 
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     error = glGetError();
     if (error != GL_NO_ERROR) {
-        printf("OpenGL error after glDrawElements: 0x%x\n", error);
+        log_error("OpenGL error after glDrawElements: 0x%x", error);
     }
 
     glBindVertexArray(0);
+    profiler_end(&renderer->profiler, PROFILE_RESOLVE, start);
 }
 
 void free_renderer(Renderer* renderer) {
-    free(renderer->framebuffer);
-    free(renderer->depthbuffer);
+    large_free(renderer->framebuffer);
+    large_free(renderer->depthbuffer);
+    arena_free(&renderer->frame_arena);
+    perf_counters_close(renderer->profiler.perf);
+    renderer->profiler.perf = NULL;
+    if (!renderer->texture) return;
     glDeleteVertexArrays(1, &renderer->VAO);
     glDeleteBuffers(1, &renderer->VBO);
     glDeleteBuffers(1, &renderer->EBO);
@@ -3,15 +3,48 @@
 
 #include "splat.h"
 #include "camera.h"
+#include "splat_quant.h"
+#include "arena.h"
+#include "numa.h"
+#include "profiler.h"
+#include <stddef.h>
 
-// Declare DebugMode enum here
+// Heatmaps that replace the rendered image, see render_debug.h
 typedef enum {
     DEBUG_NONE = 0,
-    DEBUG_TRANSFORM = 1,
-    DEBUG_PROJECTION = 2,
-    DEBUG_RENDERING = 4
+    DEBUG_OVERDRAW,        // Splats blended into each pixel
+    DEBUG_TILE_WORK,       // Footprint samples per pixel, averaged over DEBUG_TILE_SIZE tiles
+    DEBUG_DEPTH_REJECT,    // Footprint samples per pixel the depth test discarded
+    DEBUG_RADIUS,          // Screen radius in pixels of the splat that ended up in front
+    DEBUG_MODE_COUNT
 } DebugMode;
 
+#define DEBUG_TILE_SIZE 16
+#define DEBUG_RADIUS_BUCKETS 12   // Under 0.5 px, then doubling from 0.5 px; the last holds 512 px and up
+
+// Work counted while drawing a debug view
+typedef struct {
+    DebugMode mode;                // DEBUG_NONE while regular frames are drawn
+    unsigned long long covered;    // Samples inside a splat footprint
+    unsigned long long shaded;     // Samples that passed the depth test and were blended
+    unsigned long long rejected;   // Samples the depth test discarded
+    float max_value;               // Largest heatmap value of the frame
+    float saturation;              // Value drawn in the hottest color
+    int radius_histogram[DEBUG_RADIUS_BUCKETS];  // Visible splats by screen radius
+} DebugStats;
+
+// Splats are projected in blocks of this many, spread over the threads with a static schedule.
+// Scene data placed with numa_place_copy using the same block size is read by the thread that first touched it.
+#define PROJECT_BLOCK_SIZE 1024
+
+// A splat after projection: screen position, camera depth and screen radius
+typedef struct {
+    float x, y;        // Screen-space center in pixels
+    float depth;       // Camera-space depth
+    float radius;      // Screen-space radius in pixels
+    float r, g, b, a;  // Color and opacity
+} ProjectedSplat;
+
 // Update Renderer struct in renderer.h
 typedef struct {
     unsigned char* framebuffer;
@@ -21,14 +54,34 @@ typedef struct {
     unsigned int texture;
     unsigned int shaderProgram;  // Add this
     unsigned int VAO, VBO, EBO;  // Add these for rendering
+    Arena frame_arena;           // Per-frame scratch, reset at the start of every frame
+    ProjectedSplat* projected;   // Visible splats of the current frame, grouped by projection block
+    int* block_counts;           // Number of visible splats stored for each projection block
+    FrameProfiler profiler;      // Stage timings and splat counts of recent frames, see profiler_get_report; owns profiler.perf
+    DebugStats debug_stats;      // Of the last frame drawn with a debug mode
 } Renderer;
 
 void init_renderer(Renderer* renderer, int width, int height);
+// Renderer without OpenGL objects (no window needed); frames stay in renderer->framebuffer
+void init_renderer_headless(Renderer* renderer, int width, int height);
 void free_renderer(Renderer* renderer);
 
-// Update the declaration to match the definition with DebugMode parameter
+// debug_mode other than DEBUG_NONE draws a heatmap instead of the splats; debug_limit is the value
+// drawn in the hottest color (samples or pixels of radius), or 0 to scale to the frame's maximum
 void render_scene(Renderer* renderer, Splat* splats, int splat_count, Camera* camera, DebugMode debug_mode, int debug_limit);
 
+// Same as render_scene, each thread reading the splat copy on its own NUMA node
+void render_scene_replicated(Renderer* renderer, const NumaReplicas* splats, int splat_count, Camera* camera, DebugMode debug_mode, int debug_limit);
+
+// Same as render_scene, reading attributes from separate arrays (e.g. a memory-mapped scene file)
+void render_scene_arrays(Renderer* renderer, const SplatArrays* splats, Camera* camera, DebugMode debug_mode, int debug_limit);
+
+// Same as render_scene_arrays for a scene split into separate attribute views (e.g. streamed chunks)
+void render_scene_chunks(Renderer* renderer, const SplatArrays* chunks, size_t chunk_count, Camera* camera, DebugMode debug_mode, int debug_limit);
+
+// Same as render_scene, decoding a quantized scene on the fly during projection
+void render_scene_quantized(Renderer* renderer, const QuantizedScene* scene, Camera* camera, DebugMode debug_mode, int debug_limit);
+
 void draw_fullscreen_quad(Renderer* renderer);
 
 #endif
@@ -0,0 +1,345 @@
+// File: src/scene_file.c
+#include "scene_file.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+// Spread the low 10 bits of v so that there are two zero bits between each
+static uint32_t expand_bits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+static uint32_t quantize_axis(float value, float min, float max) {
+    float extent = max - min;
+    float t = extent > 0.0f ? (value - min) / extent : 0.0f;
+    if (!(t > 0.0f)) t = 0.0f;   // Also catches NaN
+    if (t > 1.0f) t = 1.0f;
+    return (uint32_t)(t * 1023.0f + 0.5f);
+}
+
+uint32_t scene_morton_code(float x, float y, float z, const float bounds_min[3], const float bounds_max[3]) {
+    return (expand_bits(quantize_axis(x, bounds_min[0], bounds_max[0])) << 2) |
+           (expand_bits(quantize_axis(y, bounds_min[1], bounds_max[1])) << 1) |
+            expand_bits(quantize_axis(z, bounds_min[2], bounds_max[2]));
+}
+
+static int compare_keys(const void* a, const void* b) {
+    uint64_t ka = *(const uint64_t*)a, kb = *(const uint64_t*)b;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + SCENE_FILE_ALIGNMENT - 1) & ~(uint64_t)(SCENE_FILE_ALIGNMENT - 1);
+}
+
+static float splat_attribute(const Splat* splat, int attribute) {
+    switch (attribute) {
+        case SCENE_SECTION_X: return splat->x;
+        case SCENE_SECTION_Y: return splat->y;
+        case SCENE_SECTION_Z: return splat->z;
+        case SCENE_SECTION_DX: return splat->dx;
+        case SCENE_SECTION_DY: return splat->dy;
+        case SCENE_SECTION_DZ: return splat->dz;
+        case SCENE_SECTION_R: return splat->r;
+        case SCENE_SECTION_G: return splat->g;
+        case SCENE_SECTION_B: return splat->b;
+        case SCENE_SECTION_A: return splat->a;
+        default: return splat->scale;
+    }
+}
+
+// Averages each run of the chunk's splats into one coarse splat covering the run
+static void build_chunk_lod(const Splat* splats, const uint64_t* order, const SceneChunk* chunk, Splat* lod) {
+    memset(lod, 0, SCENE_LOD_PER_CHUNK * sizeof(Splat));
+    uint32_t run = (chunk->count + SCENE_LOD_PER_CHUNK - 1) / SCENE_LOD_PER_CHUNK;
+
+    for (uint32_t start = 0, slot = 0; start < chunk->count; start += run, slot++) {
+        uint32_t end = start + run < chunk->count ? start + run : chunk->count;
+        Splat* out = &lod[slot];
+        float n = (float)(end - start);
+
+        float sum_scale = 0.0f;
+        for (uint32_t i = start; i < end; i++) {
+            const Splat* splat = &splats[order[chunk->first + i] & 0xffffffffu];
+            out->x += splat->x;
+            out->y += splat->y;
+            out->z += splat->z;
+            out->r += splat->r;
+            out->g += splat->g;
+            out->b += splat->b;
+            out->a += splat->a;
+            sum_scale += splat->scale;
+        }
+        out->x /= n;
+        out->y /= n;
+        out->z /= n;
+        out->r /= n;
+        out->g /= n;
+        out->b /= n;
+        out->a /= n;
+
+        // Cover the spread of the run on top of the average splat size
+        float spread = 0.0f;
+        for (uint32_t i = start; i < end; i++) {
+            const Splat* splat = &splats[order[chunk->first + i] & 0xffffffffu];
+            float dx = splat->x - out->x, dy = splat->y - out->y, dz = splat->z - out->z;
+            spread += dx * dx + dy * dy + dz * dz;
+        }
+        out->scale = sqrtf(spread / n) + sum_scale / n;
+
+        // Zero opacity marks the end of the run list, so keep real runs visible
+        if (!(out->a > 0.0f)) out->a = FLT_MIN;
+    }
+}
+
+// Pad the file with zeros up to offset
+static bool pad_to(FILE* file, uint64_t offset) {
+    static const char zeros[SCENE_FILE_ALIGNMENT] = {0};
+    long long position = platform_file_tell(file);
+    if (position < 0 || (uint64_t)position > offset) return false;
+    size_t padding = (size_t)(offset - (uint64_t)position);
+    return padding == 0 || fwrite(zeros, 1, padding, file) == padding;
+}
+
+bool scene_file_write(const char* path, const Splat* splats, size_t count, const SceneWriteOptions* options) {
+    SceneWriteOptions defaults = { SCENE_DEFAULT_CHUNK_SIZE, true, true, true };
+    if (!options) options = &defaults;
+    size_t chunk_size = options->chunk_size ? options->chunk_size : SCENE_DEFAULT_CHUNK_SIZE;
+
+    if (count > SCENE_FILE_MAX_SPLATS) {
+        log_error("Scene files hold at most %d splats.", SCENE_FILE_MAX_SPLATS);
+        return false;
+    }
+
+    SceneFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+    header.version = SCENE_FILE_VERSION;
+    header.header_size = sizeof(SceneFileHeader);
+    header.splat_count = count;
+    header.chunk_count = (uint32_t)((count + chunk_size - 1) / chunk_size);
+
+    for (int axis = 0; axis < 3; axis++) {
+        header.bounds_min[axis] = FLT_MAX;
+        header.bounds_max[axis] = -FLT_MAX;
+    }
+    for (size_t i = 0; i < count; i++) {
+        const float position[3] = { splats[i].x, splats[i].y, splats[i].z };
+        for (int axis = 0; axis < 3; axis++) {
+            if (position[axis] < header.bounds_min[axis]) header.bounds_min[axis] = position[axis];
+            if (position[axis] > header.bounds_max[axis]) header.bounds_max[axis] = position[axis];
+        }
+    }
+    if (count == 0) {
+        memset(header.bounds_min, 0, sizeof(header.bounds_min));
+        memset(header.bounds_max, 0, sizeof(header.bounds_max));
+    }
+
+    // Order of splats in the file: Morton key in the high half, source index in the low half
+    uint64_t* order = (uint64_t*)malloc((count ? count : 1) * sizeof(uint64_t));
+    SceneChunk* chunks = (SceneChunk*)calloc(header.chunk_count ? header.chunk_count : 1, sizeof(SceneChunk));
+    float* column = (float*)malloc((count ? count : 1) * sizeof(float));
+    if (!order || !chunks || !column) {
+        log_error("Failed to allocate memory for scene conversion.");
+        free(order);
+        free(chunks);
+        free(column);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t key = scene_morton_code(splats[i].x, splats[i].y, splats[i].z, header.bounds_min, header.bounds_max);
+        order[i] = (key << 32) | (uint64_t)i;
+    }
+    if (options->spatial_order) {
+        qsort(order, count, sizeof(uint64_t), compare_keys);
+        header.flags |= SCENE_FLAG_SPATIAL_ORDER;
+    }
+    if (options->morton_keys) {
+        header.flags |= SCENE_FLAG_MORTON_KEYS;
+    }
+    if (options->coarse_lod) {
+        header.flags |= SCENE_FLAG_COARSE_LOD;
+    }
+
+    for (uint32_t c = 0; c < header.chunk_count; c++) {
+        SceneChunk* chunk = &chunks[c];
+        chunk->first = (uint32_t)(c * chunk_size);
+        chunk->count = (uint32_t)((count - chunk->first) < chunk_size ? (count - chunk->first) : chunk_size);
+        for (int axis = 0; axis < 3; axis++) {
+            chunk->min[axis] = FLT_MAX;
+            chunk->max[axis] = -FLT_MAX;
+        }
+        for (uint32_t i = chunk->first; i < chunk->first + chunk->count; i++) {
+            const Splat* splat = &splats[order[i] & 0xffffffffu];
+            const float position[3] = { splat->x, splat->y, splat->z };
+            for (int axis = 0; axis < 3; axis++) {
+                if (position[axis] < chunk->min[axis]) chunk->min[axis] = position[axis];
+                if (position[axis] > chunk->max[axis]) chunk->max[axis] = position[axis];
+            }
+        }
+    }
+
+    // Lay out the sections
+    uint64_t offset = align_offset(sizeof(SceneFileHeader));
+    for (int section = 0; section < SCENE_ATTRIBUTE_COUNT; section++) {
+        header.sections[section].offset = offset;
+        header.sections[section].size = count * sizeof(float);
+        offset = align_offset(offset + header.sections[section].size);
+    }
+    header.sections[SCENE_SECTION_CHUNKS].offset = offset;
+    header.sections[SCENE_SECTION_CHUNKS].size = header.chunk_count * sizeof(SceneChunk);
+    offset = align_offset(offset + header.sections[SCENE_SECTION_CHUNKS].size);
+    if (options->morton_keys) {
+        header.sections[SCENE_SECTION_MORTON].offset = offset;
+        header.sections[SCENE_SECTION_MORTON].size = count * sizeof(uint32_t);
+        offset = align_offset(offset + header.sections[SCENE_SECTION_MORTON].size);
+    }
+    if (options->coarse_lod) {
+        header.sections[SCENE_SECTION_LOD].offset = offset;
+        header.sections[SCENE_SECTION_LOD].size = (uint64_t)header.chunk_count * SCENE_LOD_PER_CHUNK * sizeof(Splat);
+    }
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error("Unable to create scene file %s", path);
+        free(order);
+        free(chunks);
+        free(column);
+        return false;
+    }
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (int section = 0; ok && section < SCENE_ATTRIBUTE_COUNT; section++) {
+        for (size_t i = 0; i < count; i++) {
+            column[i] = splat_attribute(&splats[order[i] & 0xffffffffu], section);
+        }
+        ok = pad_to(file, header.sections[section].offset) &&
+             fwrite(column, sizeof(float), count, file) == count;
+    }
+
+    if (ok) {
+        ok = pad_to(file, header.sections[SCENE_SECTION_CHUNKS].offset) &&
+             fwrite(chunks, sizeof(SceneChunk), header.chunk_count, file) == header.chunk_count;
+    }
+
+    if (ok && options->morton_keys) {
+        uint32_t* keys = (uint32_t*)column;
+        for (size_t i = 0; i < count; i++) {
+            keys[i] = (uint32_t)(order[i] >> 32);
+        }
+        ok = pad_to(file, header.sections[SCENE_SECTION_MORTON].offset) &&
+             fwrite(keys, sizeof(uint32_t), count, file) == count;
+    }
+
+    if (ok && options->coarse_lod) {
+        ok = pad_to(file, header.sections[SCENE_SECTION_LOD].offset);
+        Splat lod[SCENE_LOD_PER_CHUNK];
+        for (uint32_t c = 0; ok && c < header.chunk_count; c++) {
+            build_chunk_lod(splats, order, &chunks[c], lod);
+            ok = fwrite(lod, sizeof(Splat), SCENE_LOD_PER_CHUNK, file) == SCENE_LOD_PER_CHUNK;
+        }
+    }
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        log_error("Failed to write scene file %s", path);
+        remove(path);
+    }
+
+    free(order);
+    free(chunks);
+    free(column);
+    return ok;
+}
+
+// A section must lie inside the file, be aligned and have the expected size
+static bool section_valid(const SceneFile* scene, int section, uint64_t expected_size) {
+    const SceneSection* s = &scene->header->sections[section];
+    return s->offset % SCENE_FILE_ALIGNMENT == 0 &&
+           s->size == expected_size &&
+           s->offset <= scene->map.size &&
+           s->size <= scene->map.size - s->offset;
+}
+
+static const void* section_data(const SceneFile* scene, int section) {
+    return (const char*)scene->map.data + scene->header->sections[section].offset;
+}
+
+bool scene_file_open(SceneFile* scene, const char* path) {
+    memset(scene, 0, sizeof(*scene));
+
+    if (!platform_map_file(path, &scene->map)) {
+        return false;
+    }
+
+    const SceneFileHeader* header = (const SceneFileHeader*)scene->map.data;
+    if (scene->map.size < sizeof(SceneFileHeader) ||
+        memcmp(header->magic, SCENE_FILE_MAGIC, sizeof(header->magic)) != 0) {
+        log_error("%s is not a splat scene file", path);
+        scene_file_close(scene);
+        return false;
+    }
+    if (header->version != SCENE_FILE_VERSION || header->header_size != sizeof(SceneFileHeader)) {
+        log_error("Unsupported scene file version %u in %s", header->version, path);
+        scene_file_close(scene);
+        return false;
+    }
+    scene->header = header;
+
+    // The count comes from the file; bounding it keeps the section size products from wrapping
+    bool ok = header->splat_count <= SCENE_FILE_MAX_SPLATS;
+    uint64_t attribute_size = header->splat_count * sizeof(float);
+    for (int section = 0; ok && section < SCENE_ATTRIBUTE_COUNT; section++) {
+        ok = section_valid(scene, section, attribute_size);
+    }
+    ok = ok && section_valid(scene, SCENE_SECTION_CHUNKS, (uint64_t)header->chunk_count * sizeof(SceneChunk));
+    if (ok && (header->flags & SCENE_FLAG_MORTON_KEYS)) {
+        ok = section_valid(scene, SCENE_SECTION_MORTON, header->splat_count * sizeof(uint32_t));
+    }
+    if (ok && (header->flags & SCENE_FLAG_COARSE_LOD)) {
+        ok = section_valid(scene, SCENE_SECTION_LOD, (uint64_t)header->chunk_count * SCENE_LOD_PER_CHUNK * sizeof(Splat));
+    }
+    if (!ok) {
+        log_error("Corrupt section table in scene file %s", path);
+        scene_file_close(scene);
+        return false;
+    }
+
+    scene->arrays.x = (const float*)section_data(scene, SCENE_SECTION_X);
+    scene->arrays.y = (const float*)section_data(scene, SCENE_SECTION_Y);
+    scene->arrays.z = (const float*)section_data(scene, SCENE_SECTION_Z);
+    scene->arrays.dx = (const float*)section_data(scene, SCENE_SECTION_DX);
+    scene->arrays.dy = (const float*)section_data(scene, SCENE_SECTION_DY);
+    scene->arrays.dz = (const float*)section_data(scene, SCENE_SECTION_DZ);
+    scene->arrays.r = (const float*)section_data(scene, SCENE_SECTION_R);
+    scene->arrays.g = (const float*)section_data(scene, SCENE_SECTION_G);
+    scene->arrays.b = (const float*)section_data(scene, SCENE_SECTION_B);
+    scene->arrays.a = (const float*)section_data(scene, SCENE_SECTION_A);
+    scene->arrays.scale = (const float*)section_data(scene, SCENE_SECTION_SCALE);
+    scene->arrays.count = (size_t)header->splat_count;
+    scene->chunks = (const SceneChunk*)section_data(scene, SCENE_SECTION_CHUNKS);
+    scene->chunk_count = header->chunk_count;
+    if (header->flags & SCENE_FLAG_MORTON_KEYS) {
+        scene->morton_keys = (const uint32_t*)section_data(scene, SCENE_SECTION_MORTON);
+    }
+    if (header->flags & SCENE_FLAG_COARSE_LOD) {
+        scene->lod = (const Splat*)section_data(scene, SCENE_SECTION_LOD);
+    }
+
+    return true;
+}
+
+void scene_file_close(SceneFile* scene) {
+    platform_unmap_file(&scene->map);
+    memset(scene, 0, sizeof(*scene));
+}
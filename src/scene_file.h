@@ -0,0 +1,128 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "splat.h"
+#include "platform.h"
+
+/*
+ * Binary splat scene format (little-endian), designed to be memory-mapped:
+ *
+ *   SceneFileHeader
+ *   sections, each starting on a SCENE_FILE_ALIGNMENT boundary:
+ *     one float array per splat attribute (x, y, z, dx, dy, dz, r, g, b, a, scale)
+ *     SceneChunk table
+ *     optional uint32 Morton keys, one per splat
+ *     optional coarse level of detail: SCENE_LOD_PER_CHUNK Splat records per chunk
+ *
+ * Splats are stored in Morton order when SCENE_FLAG_SPATIAL_ORDER is set, so
+ * every chunk covers a compact region described by its bounding box.
+ * The coarse level replaces each run of consecutive splats in a chunk by one
+ * averaged splat; unused records at the end of a chunk's run have zero opacity.
+ * Readers ignore sections they do not know; unused section slots are zero.
+ */
+#define SCENE_FILE_MAGIC "SPLATSCN"
+#define SCENE_FILE_VERSION 1
+#define SCENE_FILE_ALIGNMENT 64
+#define SCENE_FILE_MAX_SECTIONS 16
+#define SCENE_DEFAULT_CHUNK_SIZE 4096
+#define SCENE_LOD_PER_CHUNK 32
+#define SCENE_FILE_MAX_SPLATS INT_MAX      // The renderer takes int splat counts; readers reject larger counts
+
+typedef enum {
+    SCENE_SECTION_X = 0,
+    SCENE_SECTION_Y,
+    SCENE_SECTION_Z,
+    SCENE_SECTION_DX,
+    SCENE_SECTION_DY,
+    SCENE_SECTION_DZ,
+    SCENE_SECTION_R,
+    SCENE_SECTION_G,
+    SCENE_SECTION_B,
+    SCENE_SECTION_A,
+    SCENE_SECTION_SCALE,
+    SCENE_SECTION_CHUNKS,      // SceneChunk[chunk_count]
+    SCENE_SECTION_MORTON,      // uint32_t[splat_count], optional
+    SCENE_SECTION_LOD,         // Splat[chunk_count * SCENE_LOD_PER_CHUNK], optional
+    SCENE_SECTION_COUNT
+} SceneSectionId;
+
+#define SCENE_ATTRIBUTE_COUNT (SCENE_SECTION_SCALE + 1)
+
+typedef enum {
+    SCENE_FLAG_SPATIAL_ORDER = 1,  // Splats sorted by Morton code of their position
+    SCENE_FLAG_MORTON_KEYS = 2,    // SCENE_SECTION_MORTON is present
+    SCENE_FLAG_COARSE_LOD = 4      // SCENE_SECTION_LOD is present
+} SceneFileFlags;
+
+typedef struct {
+    uint64_t offset;   // Byte offset from the start of the file, 0 if absent
+    uint64_t size;     // Size in bytes
+} SceneSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t splat_count;
+    uint32_t chunk_count;
+    uint32_t flags;
+    float bounds_min[3];
+    float bounds_max[3];
+    SceneSection sections[SCENE_FILE_MAX_SECTIONS];
+} SceneFileHeader;
+
+// A run of consecutive splats and the box enclosing their positions
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+    float min[3];
+    float max[3];
+} SceneChunk;
+
+typedef struct {
+    size_t chunk_size;     // Splats per chunk, 0 = SCENE_DEFAULT_CHUNK_SIZE
+    bool spatial_order;    // Sort splats by Morton code before writing
+    bool morton_keys;      // Store the Morton key section
+    bool coarse_lod;       // Store the coarse level of detail, used while chunks stream in
+} SceneWriteOptions;
+
+// An open, memory-mapped scene. All pointers reference the mapping.
+typedef struct {
+    PlatformFileMap map;
+    const SceneFileHeader* header;
+    SplatArrays arrays;
+    const SceneChunk* chunks;
+    size_t chunk_count;
+    const uint32_t* morton_keys;  // NULL when the file has no key section
+    const Splat* lod;             // NULL when the file has no coarse level of detail
+} SceneFile;
+
+/**
+ * @brief Writes splats to a scene file.
+ *
+ * @param path Output file path.
+ * @param splats Splats to write.
+ * @param count Number of splats.
+ * @param options Layout options, or NULL for spatial order with Morton keys and coarse level of detail.
+ * @return true on success.
+ */
+bool scene_file_write(const char* path, const Splat* splats, size_t count, const SceneWriteOptions* options);
+
+/**
+ * @brief Memory-maps a scene file and validates its header and section table.
+ *
+ * Nothing is copied: scene->arrays can be passed straight to render_scene_arrays.
+ *
+ * @return true on success.
+ */
+bool scene_file_open(SceneFile* scene, const char* path);
+void scene_file_close(SceneFile* scene);
+
+// 30-bit Morton code of a position inside the given bounds (10 bits per axis)
+uint32_t scene_morton_code(float x, float y, float z, const float bounds_min[3], const float bounds_max[3]);
+
+#endif // SCENE_FILE_H
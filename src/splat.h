@@ -1,6 +1,8 @@
 #ifndef SPLAT_H
 #define SPLAT_H
 
+#include <stddef.h>
+
 // Splat struct: represents a point in 3D space with a position, direction, color, opacity, and scale
 typedef struct {
     float x, y, z;     // Position in 3D space
@@ -9,6 +11,23 @@ typedef struct {
     float scale;       // Scale factor for the size of the splat
 } Splat;
 
+// Structure-of-arrays view of splat attributes. The arrays are not owned by
+// the view; they may point into a memory-mapped scene file.
+typedef struct {
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* dx;
+    const float* dy;
+    const float* dz;
+    const float* r;
+    const float* g;
+    const float* b;
+    const float* a;
+    const float* scale;
+    size_t count;
+} SplatArrays;
+
 /**
  * @brief Initializes a Splat with position, direction, color, opacity, and scale.
  *
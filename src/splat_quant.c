@@ -0,0 +1,223 @@
+// File: src/splat_quant.c
+#include "splat_quant.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+
+// Either an SoA view or an array of Splat records
+typedef struct {
+    const SplatArrays* arrays;
+    const Splat* splats;
+    size_t count;
+} QuantSource;
+
+static inline void source_get(const QuantSource* src, size_t i, float position[3], float color[4], float* scale) {
+    if (src->arrays) {
+        const SplatArrays* a = src->arrays;
+        position[0] = a->x[i];
+        position[1] = a->y[i];
+        position[2] = a->z[i];
+        color[0] = a->r[i];
+        color[1] = a->g[i];
+        color[2] = a->b[i];
+        color[3] = a->a[i];
+        *scale = a->scale[i];
+    } else {
+        const Splat* s = &src->splats[i];
+        position[0] = s->x;
+        position[1] = s->y;
+        position[2] = s->z;
+        color[0] = s->r;
+        color[1] = s->g;
+        color[2] = s->b;
+        color[3] = s->a;
+        *scale = s->scale;
+    }
+}
+
+static inline uint32_t quantize_unit(float value, float levels) {
+    if (!(value > 0.0f)) return 0;   // Also catches NaN
+    if (value >= 1.0f) return (uint32_t)levels;
+    return (uint32_t)(value * levels + 0.5f);
+}
+
+static float safe_log2_scale(float scale) {
+    return log2f(scale > 1e-30f ? scale : 1e-30f);
+}
+
+static bool build(QuantizedScene* scene, const QuantSource* src) {
+    memset(scene, 0, sizeof(*scene));
+    // render_scene_quantized takes an int count, and chunks index splats with 32 bits
+    if (src->count > INT_MAX) {
+        log_error("Quantized scenes hold at most %d splats.", INT_MAX);
+        return false;
+    }
+    size_t count = src->count;
+    scene->count = count;
+    scene->chunk_count = (count + QUANT_CHUNK_SIZE - 1) / QUANT_CHUNK_SIZE;
+
+    size_t n = count ? count : 1;
+    scene->chunks = (QuantChunk*)malloc((scene->chunk_count ? scene->chunk_count : 1) * sizeof(QuantChunk));
+    scene->qx = (uint16_t*)malloc(n * sizeof(uint16_t));
+    scene->qy = (uint16_t*)malloc(n * sizeof(uint16_t));
+    scene->qz = (uint16_t*)malloc(n * sizeof(uint16_t));
+    scene->rgba = (uint32_t*)malloc(n * sizeof(uint32_t));
+    scene->scale_code = (uint8_t*)malloc(n);
+    if (!scene->chunks || !scene->qx || !scene->qy || !scene->qz || !scene->rgba || !scene->scale_code) {
+        log_error("Failed to allocate memory for quantized scene.");
+        quant_scene_free(scene);
+        return false;
+    }
+
+    // Scene-wide log2 scale range for the 8-bit scale codes
+    float log_min = FLT_MAX, log_max = -FLT_MAX;
+    for (size_t i = 0; i < count; i++) {
+        float position[3], color[4], scale;
+        source_get(src, i, position, color, &scale);
+        float log_scale = safe_log2_scale(scale);
+        if (log_scale < log_min) log_min = log_scale;
+        if (log_scale > log_max) log_max = log_scale;
+    }
+    if (count == 0) log_min = log_max = 0.0f;
+    scene->log_scale_min = log_min;
+    scene->log_scale_step = (log_max - log_min) / 255.0f;
+    for (int code = 0; code < 256; code++) {
+        scene->scale_lut[code] = exp2f(log_min + code * scene->log_scale_step);
+    }
+
+    for (size_t c = 0; c < scene->chunk_count; c++) {
+        QuantChunk* chunk = &scene->chunks[c];
+        chunk->first = (uint32_t)(c * QUANT_CHUNK_SIZE);
+        chunk->count = (uint32_t)((count - chunk->first) < QUANT_CHUNK_SIZE ? (count - chunk->first) : QUANT_CHUNK_SIZE);
+
+        float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = chunk->first; i < chunk->first + chunk->count; i++) {
+            float position[3], color[4], scale;
+            source_get(src, i, position, color, &scale);
+            for (int axis = 0; axis < 3; axis++) {
+                if (position[axis] < min[axis]) min[axis] = position[axis];
+                if (position[axis] > max[axis]) max[axis] = position[axis];
+            }
+        }
+
+        float inv_extent[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = max[axis] - min[axis];
+            chunk->origin[axis] = min[axis];
+            chunk->step[axis] = extent / 65535.0f;
+            inv_extent[axis] = extent > 0.0f ? 1.0f / extent : 0.0f;
+        }
+
+        for (uint32_t i = chunk->first; i < chunk->first + chunk->count; i++) {
+            float position[3], color[4], scale;
+            source_get(src, i, position, color, &scale);
+
+            scene->qx[i] = (uint16_t)quantize_unit((position[0] - min[0]) * inv_extent[0], 65535.0f);
+            scene->qy[i] = (uint16_t)quantize_unit((position[1] - min[1]) * inv_extent[1], 65535.0f);
+            scene->qz[i] = (uint16_t)quantize_unit((position[2] - min[2]) * inv_extent[2], 65535.0f);
+
+            scene->rgba[i] = quantize_unit(color[0], 255.0f) |
+                             quantize_unit(color[1], 255.0f) << 8 |
+                             quantize_unit(color[2], 255.0f) << 16 |
+                             quantize_unit(color[3], 255.0f) << 24;
+
+            float code = scene->log_scale_step > 0.0f
+                ? (safe_log2_scale(scale) - log_min) / scene->log_scale_step
+                : 0.0f;
+            scene->scale_code[i] = (uint8_t)quantize_unit(code / 255.0f, 255.0f);
+        }
+    }
+
+    return true;
+}
+
+bool quant_scene_build(QuantizedScene* scene, const SplatArrays* source) {
+    QuantSource src = { source, NULL, source->count };
+    return build(scene, &src);
+}
+
+bool quant_scene_build_splats(QuantizedScene* scene, const Splat* splats, size_t count) {
+    QuantSource src = { NULL, splats, count };
+    return build(scene, &src);
+}
+
+void quant_scene_free(QuantizedScene* scene) {
+    free(scene->chunks);
+    free(scene->qx);
+    free(scene->qy);
+    free(scene->qz);
+    free(scene->rgba);
+    free(scene->scale_code);
+    memset(scene, 0, sizeof(*scene));
+}
+
+size_t quant_scene_bytes(const QuantizedScene* scene) {
+    return sizeof(QuantizedScene) +
+           scene->chunk_count * sizeof(QuantChunk) +
+           scene->count * (3 * sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t));
+}
+
+void quant_scene_decode(const QuantizedScene* scene, size_t index, Splat* out) {
+    const QuantChunk* chunk = &scene->chunks[index / QUANT_CHUNK_SIZE];
+    uint32_t rgba = scene->rgba[index];
+
+    out->x = chunk->origin[0] + scene->qx[index] * chunk->step[0];
+    out->y = chunk->origin[1] + scene->qy[index] * chunk->step[1];
+    out->z = chunk->origin[2] + scene->qz[index] * chunk->step[2];
+    out->dx = out->dy = out->dz = 0.0f;
+    out->r = (rgba & 0xff) * (1.0f / 255.0f);
+    out->g = ((rgba >> 8) & 0xff) * (1.0f / 255.0f);
+    out->b = ((rgba >> 16) & 0xff) * (1.0f / 255.0f);
+    out->a = (rgba >> 24) * (1.0f / 255.0f);
+    out->scale = scene->scale_lut[scene->scale_code[index]];
+}
+
+void quant_scene_measure_error(const QuantizedScene* scene, const SplatArrays* source, QuantErrorStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    QuantSource src = { source, NULL, source->count };
+    double position_error_sum = 0.0;
+
+    for (size_t c = 0; c < scene->chunk_count; c++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float bound = scene->chunks[c].step[axis] * 0.5f;
+            if (bound > stats->position_error_bound) stats->position_error_bound = bound;
+        }
+    }
+    stats->scale_error_bound = exp2f(scene->log_scale_step * 0.5f) - 1.0f;
+
+    for (size_t i = 0; i < scene->count && i < source->count; i++) {
+        float position[3], color[4], scale;
+        source_get(&src, i, position, color, &scale);
+        Splat decoded;
+        quant_scene_decode(scene, i, &decoded);
+
+        float error[3] = {
+            fabsf(decoded.x - position[0]), fabsf(decoded.y - position[1]), fabsf(decoded.z - position[2])
+        };
+        for (int axis = 0; axis < 3; axis++) {
+            if (error[axis] > stats->max_position_error) stats->max_position_error = error[axis];
+        }
+        position_error_sum += sqrt((double)error[0] * error[0] + (double)error[1] * error[1] + (double)error[2] * error[2]);
+
+        float decoded_color[4] = { decoded.r, decoded.g, decoded.b, decoded.a };
+        for (int channel = 0; channel < 4; channel++) {
+            float clamped = color[channel] < 0.0f ? 0.0f : (color[channel] > 1.0f ? 1.0f : color[channel]);
+            float color_error = fabsf(decoded_color[channel] - clamped);
+            if (color_error > stats->max_color_error) stats->max_color_error = color_error;
+        }
+
+        if (scale > 0.0f) {
+            float scale_error = fabsf(decoded.scale - scale) / scale;
+            if (scale_error > stats->max_scale_error) stats->max_scale_error = scale_error;
+        }
+    }
+
+    if (scene->count > 0) {
+        stats->mean_position_error = (float)(position_error_sum / scene->count);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef SPLAT_QUANT_H
+#define SPLAT_QUANT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "splat.h"
+
+// Splats per quantization chunk. A multiple of 4 so SIMD decode groups never straddle chunks.
+#define QUANT_CHUNK_SIZE 256
+
+// Dequantization constants of one chunk: position = origin + q * step
+typedef struct {
+    float origin[3];   // Minimum corner of the chunk's bounding box
+    float step[3];     // Box extent / 65535 per axis
+    uint32_t first;
+    uint32_t count;
+} QuantChunk;
+
+/**
+ * Compressed splat storage, about 11 bytes per splat instead of sizeof(Splat):
+ * - positions as 16-bit offsets inside the bounding box of their chunk
+ * - color and opacity as 8 bits per channel, packed r | g << 8 | b << 16 | a << 24
+ * - scale as an 8-bit code on a log2 scale shared by the whole scene
+ * Direction is not stored; the renderer does not use it.
+ */
+typedef struct {
+    size_t count;
+    size_t chunk_count;
+    QuantChunk* chunks;
+    uint16_t* qx;
+    uint16_t* qy;
+    uint16_t* qz;
+    uint32_t* rgba;
+    uint8_t* scale_code;
+    float log_scale_min;    // log2 of the smallest scale
+    float log_scale_step;   // log2 scale increment per code
+    float scale_lut[256];   // Decoded scale for each code
+} QuantizedScene;
+
+// Quantization error against the source data
+typedef struct {
+    float max_position_error;    // Largest per-axis absolute error
+    float mean_position_error;   // Mean Euclidean position error
+    float position_error_bound;  // Largest half quantization step of any chunk
+    float max_color_error;       // Largest per-channel error (color and opacity)
+    float max_scale_error;       // Largest relative scale error
+    float scale_error_bound;     // Relative bound implied by the log step
+} QuantErrorStats;
+
+/**
+ * @brief Quantizes splats into a compressed scene.
+ *
+ * Chunks are consecutive runs of QUANT_CHUNK_SIZE input splats, so spatially
+ * ordered input (scene files, depth-map rows) gives the tightest boxes.
+ * The source can be a memory-mapped scene file; it is read once, in order.
+ *
+ * @return true on success; false if allocation fails or there are more than INT_MAX splats.
+ */
+bool quant_scene_build(QuantizedScene* scene, const SplatArrays* source);
+
+// Same as quant_scene_build for an array of Splat records
+bool quant_scene_build_splats(QuantizedScene* scene, const Splat* splats, size_t count);
+
+void quant_scene_free(QuantizedScene* scene);
+
+// Heap bytes used by the compressed scene
+size_t quant_scene_bytes(const QuantizedScene* scene);
+
+// Decodes a single splat (scalar path)
+void quant_scene_decode(const QuantizedScene* scene, size_t index, Splat* out);
+
+// Compares every decoded splat against the source it was built from
+void quant_scene_measure_error(const QuantizedScene* scene, const SplatArrays* source, QuantErrorStats* stats);
+
+#endif // SPLAT_QUANT_H
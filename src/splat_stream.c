@@ -0,0 +1,246 @@
+// File: src/splat_stream.c
+#include "splat_stream.h"
+#include "data_loader.h"
+#include "ply_file.h"
+#include "platform.h"
+#include "arena.h"
+#include "trace.h"
+#include "mem_track.h"
+#include "log.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STREAM_CACHE_LINE 64
+#define STREAM_STRIP_ROWS 64      // Smallest strip; a multiple of the default decimation block
+#define STREAM_TARGET_STRIPS 16   // Depth maps are split into about this many publications
+
+struct SplatStream {
+    // Written by the loader before the first publication, read-only afterwards
+    CachedData storage;        // Reserved buffer, or splats adopted whole
+    Splat* splats;
+    size_t capacity;
+    double start_time;
+    double first_chunk_time;   // Written before the first publication
+    double complete_time;      // Written before complete is set
+
+    _Alignas(STREAM_CACHE_LINE) atomic_size_t published;
+    atomic_size_t chunks;
+    atomic_bool complete;
+    atomic_bool failed;
+    atomic_bool stopping;
+
+    // Loader inputs
+    PlatformThread thread;
+    bool thread_started;
+    bool is_ply;
+    char* path;
+    char* png_path;
+    DecodeCache* cache;
+    DecimateOptions options;
+};
+
+static char* copy_string(const char* text) {
+    if (!text) return NULL;
+    size_t length = strlen(text);
+    char* copy = (char*)malloc(length + 1);
+    if (copy) memcpy(copy, text, length + 1);
+    return copy;
+}
+
+// Makes splats [0, count) visible to the renderer
+static void publish(SplatStream* stream, size_t count) {
+    if (atomic_load_explicit(&stream->published, memory_order_relaxed) == 0) {
+        stream->first_chunk_time = platform_time_seconds();
+    }
+    atomic_fetch_add_explicit(&stream->chunks, 1, memory_order_relaxed);
+    atomic_store_explicit(&stream->published, count, memory_order_release);
+}
+
+static void finish(SplatStream* stream, bool ok) {
+    stream->complete_time = platform_time_seconds();
+    atomic_store_explicit(&stream->failed, !ok, memory_order_relaxed);
+    atomic_store_explicit(&stream->complete, true, memory_order_release);
+}
+
+// Takes over splats that were loaded in one piece and publishes all of them
+static void adopt(SplatStream* stream, CachedData* data) {
+    stream->storage = *data;
+    memset(data, 0, sizeof(*data));
+    stream->splats = (Splat*)stream->storage.data;
+    stream->capacity = stream->storage.size / sizeof(Splat);
+    if (stream->capacity > 0) publish(stream, stream->capacity);
+}
+
+static bool load_npz(SplatStream* stream) {
+    uint64_t variant;
+    if (!splat_cache_variant(stream->cache, stream->png_path, &stream->options, &variant)) {
+        return false;
+    }
+
+    // Finished splats are mapped straight from the cache
+    CachedData cached;
+    if (stream->cache && decode_cache_lookup(stream->cache, stream->path, DECODE_SPLATS, variant, &cached)) {
+        log_info("Mapped %zu cached splats for %s.", cached.size / sizeof(Splat), stream->path);
+        adopt(stream, &cached);
+        return stream->capacity > 0;
+    }
+
+    DepthFrame frame;
+    if (!load_depth_frame_cached(stream->cache, stream->path, stream->png_path, &frame)) {
+        return false;
+    }
+
+    // Every strip fits in the space of its pixels, so the whole map bounds the scene
+    int width = frame.depth.width, height = frame.depth.height;
+    stream->capacity = (size_t)width * height;
+    stream->storage.owned = mem_malloc(MEM_LOADER, (stream->capacity ? stream->capacity : 1) * sizeof(Splat));
+    stream->splats = (Splat*)stream->storage.owned;
+    stream->storage.data = stream->splats;
+    if (!stream->splats) {
+        log_error("Failed to allocate memory for %zu streamed splats.", stream->capacity);
+        depth_frame_release(&frame);
+        return false;
+    }
+
+    // Strips start on multiples of the decimation block, so together they match a whole-map decimation
+    int align = STREAM_STRIP_ROWS;
+    while (align < stream->options.max_block) align *= 2;
+    int strip_rows = (height + STREAM_TARGET_STRIPS - 1) / STREAM_TARGET_STRIPS;
+    strip_rows = (strip_rows + align - 1) / align * align;
+
+    size_t total = 0;
+    for (int row = 0; row < height; row += strip_rows) {
+        if (atomic_load_explicit(&stream->stopping, memory_order_relaxed)) break;
+        int rows = height - row < strip_rows ? height - row : strip_rows;
+
+        // Appended past the published prefix, which the renderer may be reading
+        trace_begin("decimate strip");
+        int written = decimate_depth_rows(&frame.view, &frame.params, &stream->options, row, rows,
+                                          stream->splats + total);
+        trace_end("decimate strip");
+        if (written > 0) {
+            total += (size_t)written;
+            publish(stream, total);
+        }
+    }
+    depth_frame_release(&frame);
+
+    bool stopped = atomic_load_explicit(&stream->stopping, memory_order_relaxed);
+    if (total == 0 && !stopped) {
+        log_error("Depth map has no valid samples.");
+        return false;
+    }
+    if (stream->cache && !stopped) {
+        decode_cache_store(stream->cache, stream->path, DECODE_SPLATS, variant, stream->splats,
+                           total * sizeof(Splat), 0, 0);
+    }
+    log_info("Streamed %zu splats from %s in %zu pieces.", total, stream->path,
+           atomic_load_explicit(&stream->chunks, memory_order_relaxed));
+    return total > 0;
+}
+
+static bool load_ply(SplatStream* stream) {
+    Splat* splats = NULL;
+    int count = load_splats_from_ply(stream->path, &splats);
+    if (count == 0) {
+        return false;
+    }
+    mem_adopt(MEM_LOADER, splats);   // Released with the storage by cached_data_release
+    CachedData data = {0};
+    data.owned = splats;
+    data.data = splats;
+    data.size = (size_t)count * sizeof(Splat);
+    adopt(stream, &data);
+    return true;
+}
+
+static void loader_main(void* arg) {
+    SplatStream* stream = (SplatStream*)arg;
+    trace_set_thread_name("scene loader");
+    trace_begin("load scene");
+    bool ok = stream->is_ply ? load_ply(stream) : load_npz(stream);
+    trace_end("load scene");
+    if (!ok && !atomic_load_explicit(&stream->stopping, memory_order_relaxed)) {
+        log_error("Failed to load splats from %s", stream->path);
+    }
+    arena_scratch_free();  // The thread ends here, so its scratch memory would never be reused
+    finish(stream, ok);
+}
+
+static SplatStream* open_stream(const char* path, const char* png_path, bool is_ply, DecodeCache* cache,
+                                const DecimateOptions* options) {
+    SplatStream* stream = (SplatStream*)calloc(1, sizeof(SplatStream));
+    if (!stream) return NULL;
+
+    atomic_init(&stream->published, 0);
+    atomic_init(&stream->chunks, 0);
+    atomic_init(&stream->complete, false);
+    atomic_init(&stream->failed, false);
+    atomic_init(&stream->stopping, false);
+    stream->is_ply = is_ply;
+    stream->cache = cache;
+    if (options) stream->options = *options;
+    stream->path = copy_string(path);
+    stream->png_path = copy_string(png_path);
+    stream->start_time = platform_time_seconds();
+
+    if (!stream->path || (png_path && !stream->png_path) ||
+        !(stream->thread_started = platform_thread_create(&stream->thread, loader_main, stream))) {
+        log_error("Failed to start loading %s", path);
+        splat_stream_close(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+SplatStream* splat_stream_open_npz(DecodeCache* cache, const char* npz_path, const char* png_path,
+                                   const DecimateOptions* options) {
+    return open_stream(npz_path, png_path, false, cache, options);
+}
+
+SplatStream* splat_stream_open_ply(const char* path) {
+    return open_stream(path, NULL, true, NULL, NULL);
+}
+
+const Splat* splat_stream_view(const SplatStream* stream, size_t* count) {
+    // The acquire pairs with publish, so the splats below the count are fully written
+    *count = atomic_load_explicit(&stream->published, memory_order_acquire);
+    return *count > 0 ? stream->splats : NULL;
+}
+
+bool splat_stream_complete(const SplatStream* stream) {
+    return atomic_load_explicit(&stream->complete, memory_order_acquire);
+}
+
+void splat_stream_get_stats(const SplatStream* stream, SplatStreamStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->complete = splat_stream_complete(stream);
+    stats->published = atomic_load_explicit(&stream->published, memory_order_acquire);
+    stats->chunks = atomic_load_explicit(&stream->chunks, memory_order_relaxed);
+    stats->start_time = stream->start_time;
+
+    // The loader writes these before the stores that make them visible here
+    if (stats->published > 0) {
+        stats->capacity = stream->capacity;
+        stats->first_chunk_time = stream->first_chunk_time;
+    }
+    if (stats->complete) {
+        stats->capacity = stream->capacity;
+        stats->failed = atomic_load_explicit(&stream->failed, memory_order_relaxed);
+        stats->complete_time = stream->complete_time;
+    }
+}
+
+void splat_stream_close(SplatStream* stream) {
+    if (!stream) return;
+    if (stream->thread_started) {
+        atomic_store_explicit(&stream->stopping, true, memory_order_relaxed);
+        platform_thread_join(stream->thread);
+    }
+    cached_data_release(&stream->storage);
+    free(stream->path);
+    free(stream->png_path);
+    free(stream);
+}
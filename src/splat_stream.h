@@ -0,0 +1,70 @@
+#ifndef SPLAT_STREAM_H
+#define SPLAT_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "splat.h"
+#include "decimate.h"
+#include "decode_cache.h"
+
+typedef struct {
+    size_t published;          // Splats visible to the renderer
+    size_t chunks;             // Publications so far
+    size_t capacity;           // Splats the buffer can hold
+    bool complete;             // Loading has ended, successfully or not
+    bool failed;
+    double start_time;         // platform_time_seconds when the stream was opened
+    double first_chunk_time;   // When the first splats were published, 0 before
+    double complete_time;      // When loading ended, 0 before
+} SplatStreamStats;
+
+/**
+ * A scene loaded on a background thread while it is being drawn.
+ *
+ * The loader reserves one buffer for the whole scene up front and appends
+ * decoded splats to it. Each append is published by storing the new splat
+ * count with release ordering; the renderer loads it with acquire ordering
+ * and draws that prefix. Published splats are never moved or written again,
+ * so drawing takes no lock and never waits for the loader.
+ *
+ * Depth maps are decimated in horizontal strips, each published as soon as
+ * it is done. Splats already in the decode cache and PLY files are
+ * published in one piece.
+ */
+typedef struct SplatStream SplatStream;
+
+/**
+ * @brief Starts loading and decimating a depth map in the background.
+ *
+ * @param cache Decode cache, or NULL. The loader thread uses it until the
+ *              stream is complete or closed; only then may the caller use or close it.
+ * @param png_path Color frame, or NULL for white splats.
+ * @param options Decimation settings, or NULL for defaults.
+ * @return Stream handle, or NULL if the thread could not be started.
+ */
+SplatStream* splat_stream_open_npz(DecodeCache* cache, const char* npz_path, const char* png_path,
+                                   const DecimateOptions* options);
+
+// Starts loading a PLY file in the background
+SplatStream* splat_stream_open_ply(const char* path);
+
+/**
+ * @brief Splats published so far. Never blocks.
+ *
+ * The returned prefix stays valid and unchanged until the stream is closed;
+ * later calls may return a longer one.
+ *
+ * @param count Receives the number of splats, 0 before the first publication.
+ * @return The splats, NULL while none are published.
+ */
+const Splat* splat_stream_view(const SplatStream* stream, size_t* count);
+
+// True once loading has ended; splat_stream_view then returns the whole scene
+bool splat_stream_complete(const SplatStream* stream);
+
+void splat_stream_get_stats(const SplatStream* stream, SplatStreamStats* stats);
+
+// Stops the loader if it is still running and frees the splats
+void splat_stream_close(SplatStream* stream);
+
+#endif // SPLAT_STREAM_H
@@ -0,0 +1,150 @@
+// File: src/trace.c
+#include "trace.h"
+#include "platform.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    double time;          // platform_time_seconds
+    unsigned frame;
+    char phase;           // 'B' or 'E'
+} TraceEvent;
+
+// One thread's events; only that thread writes them
+typedef struct TraceBuffer {
+    TraceEvent* events;
+    atomic_size_t count;       // Published with release after the event is written
+    atomic_size_t dropped;
+    int tid;
+    char name[32];             // Empty until the thread is named
+    struct TraceBuffer* next;  // Registered buffers form a list that only grows
+} TraceBuffer;
+
+atomic_bool trace_enabled = false;
+
+static _Atomic(TraceBuffer*) buffers = NULL;
+static atomic_int next_tid = 0;
+static atomic_uint frame_number = 0;
+static double start_time;
+
+static _Thread_local TraceBuffer* local_buffer;
+static _Thread_local char local_name[32];
+
+static TraceBuffer* register_thread(void) {
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if (!buffer) return NULL;
+    buffer->events = (TraceEvent*)malloc(TRACE_BUFFER_EVENTS * sizeof(TraceEvent));
+    if (!buffer->events) {
+        free(buffer);
+        return NULL;
+    }
+    atomic_init(&buffer->count, 0);
+    atomic_init(&buffer->dropped, 0);
+    buffer->tid = atomic_fetch_add(&next_tid, 1);
+    memcpy(buffer->name, local_name, sizeof(buffer->name));
+
+    // Lock-free push; the writer walks the list from the head
+    buffer->next = atomic_load_explicit(&buffers, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&buffers, &buffer->next, buffer, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+    local_buffer = buffer;
+    return buffer;
+}
+
+void trace_record(const char* name, char phase) {
+    TraceBuffer* buffer = local_buffer ? local_buffer : register_thread();
+    if (!buffer) return;
+
+    size_t count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    if (count >= TRACE_BUFFER_EVENTS) {
+        atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    TraceEvent* event = &buffer->events[count];
+    event->name = name;
+    event->time = platform_time_seconds();
+    event->frame = atomic_load_explicit(&frame_number, memory_order_relaxed);
+    event->phase = phase;
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+void trace_start(void) {
+    for (TraceBuffer* buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer; buffer = buffer->next) {
+        atomic_store_explicit(&buffer->count, 0, memory_order_relaxed);
+        atomic_store_explicit(&buffer->dropped, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&frame_number, 0, memory_order_relaxed);
+    start_time = platform_time_seconds();
+    atomic_store_explicit(&trace_enabled, true, memory_order_release);
+}
+
+void trace_advance_frame(void) {
+    atomic_fetch_add_explicit(&frame_number, 1, memory_order_relaxed);
+}
+
+void trace_set_thread_name(const char* name) {
+    snprintf(local_name, sizeof(local_name), "%s", name);
+    if (local_buffer) memcpy(local_buffer->name, local_name, sizeof(local_name));
+}
+
+bool trace_stop(const char* path) {
+    atomic_store_explicit(&trace_enabled, false, memory_order_relaxed);
+
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        log_error("Failed to open %s for the trace.", path);
+        return false;
+    }
+
+    size_t written = 0, dropped = 0;
+    bool first = true;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (TraceBuffer* buffer = atomic_load_explicit(&buffers, memory_order_acquire); buffer; buffer = buffer->next) {
+        // The acquire pairs with trace_record, so every event below the count is complete
+        size_t count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+        dropped += atomic_load_explicit(&buffer->dropped, memory_order_relaxed);
+
+        if (buffer->name[0]) {
+            fprintf(file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                    first ? "" : ",", buffer->tid, buffer->name);
+            first = false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const TraceEvent* event = &buffer->events[i];
+            fprintf(file, "%s\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d, \"args\": {\"frame\": %u}}",
+                    first ? "" : ",", event->name, event->phase, (event->time - start_time) * 1e6, buffer->tid,
+                    event->frame);
+            first = false;
+        }
+        written += count;
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = fclose(file) == 0;
+    if (ok) {
+        if (dropped > 0) {
+            log_info("Wrote %zu trace events to %s (%zu dropped after the per-thread limit of %d)", written, path,
+                     dropped, TRACE_BUFFER_EVENTS);
+        } else {
+            log_info("Wrote %zu trace events to %s", written, path);
+        }
+    } else {
+        log_error("Failed to write the trace to %s", path);
+    }
+    return ok;
+}
+
+void trace_shutdown(void) {
+    atomic_store_explicit(&trace_enabled, false, memory_order_relaxed);
+    TraceBuffer* buffer = atomic_exchange_explicit(&buffers, NULL, memory_order_acquire);
+    while (buffer) {
+        TraceBuffer* next = buffer->next;
+        free(buffer->events);
+        free(buffer);
+        buffer = next;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TRACE_BUFFER_EVENTS 65536   // Events kept per thread; later ones are counted as dropped
+
+/**
+ * Timeline of what every thread was doing, written as Chrome trace events
+ * (chrome://tracing, ui.perfetto.dev).
+ *
+ * Each thread records begin and end events into its own buffer, allocated
+ * on its first event and published with a release store of the event
+ * count, so recording takes no lock and threads never contend. Names must
+ * be string literals or otherwise outlive the trace. Every event carries
+ * the number of the frame in progress.
+ *
+ * While tracing is off, trace_begin and trace_end are one relaxed load and
+ * a branch.
+ */
+extern atomic_bool trace_enabled;
+
+void trace_record(const char* name, char phase);
+
+static inline void trace_begin(const char* name) {
+    if (atomic_load_explicit(&trace_enabled, memory_order_relaxed)) trace_record(name, 'B');
+}
+
+static inline void trace_end(const char* name) {
+    if (atomic_load_explicit(&trace_enabled, memory_order_relaxed)) trace_record(name, 'E');
+}
+
+// Starts recording; events of earlier sessions are discarded
+void trace_start(void);
+
+void trace_advance_frame(void);
+
+// Advances the frame number attached to new events
+static inline void trace_next_frame(void) {
+    if (atomic_load_explicit(&trace_enabled, memory_order_relaxed)) trace_advance_frame();
+}
+
+// Names the calling thread in the timeline (up to 31 characters)
+void trace_set_thread_name(const char* name);
+
+/**
+ * @brief Stops recording and writes every thread's events as a JSON trace.
+ *
+ * Threads may still be running; events they record after the stop are not
+ * written. Buffers are kept for a later trace_start.
+ *
+ * @return false if the file could not be written.
+ */
+bool trace_stop(const char* path);
+
+// Frees the buffers at exit; threads keep pointers to theirs, so tracing must not start again
+void trace_shutdown(void);
+
+#endif // TRACE_H
@@ -0,0 +1,346 @@
+// File: src/unproject.c
+#include "unproject.h"
+#include "arena.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <immintrin.h>  // For SSE intrinsics
+#include <omp.h>        // For OpenMP parallelization
+
+static const float identity_pose[12] = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f
+};
+
+CameraIntrinsics camera_intrinsics_from_fov(int width, int height, float fov_y_degrees) {
+    CameraIntrinsics intrinsics;
+    float focal = (height * 0.5f) / tanf(fov_y_degrees * 0.5f * (float)M_PI / 180.0f);
+    intrinsics.fx = focal;
+    intrinsics.fy = focal;
+    intrinsics.cx = (width - 1) * 0.5f;
+    intrinsics.cy = (height - 1) * 0.5f;
+    return intrinsics;
+}
+
+void depth_row_to_float(const cnpy_array* depth, size_t row, size_t width, float* out) {
+    if (depth->fortran_order) {
+        size_t height = cnpy_num_elements(depth) / width;
+        for (size_t col = 0; col < width; col++) {
+            out[col] = cnpy_element_as_float(depth, col * height + row);
+        }
+    } else {
+        cnpy_convert_to_float(depth, row * width, width, out);
+    }
+}
+
+// Color frame rows bracketing one depth row, with the horizontal resampling ratio
+typedef struct {
+    const unsigned char* row0;
+    const unsigned char* row1;
+    float wy;          // Weight of row1
+    float x_ratio;     // Color pixels per depth pixel
+    int last_x;        // Largest valid color column
+    int channels;
+    bool direct;       // Same resolution: one texel per pixel, no filtering
+} ColorRow;
+
+static const float white[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+static bool setup_color_row(const UnprojectParams* params, int row, int width, int height, ColorRow* color) {
+    if (!params->rgb || params->rgb_width <= 0 || params->rgb_height <= 0 ||
+        params->rgb_channels < 1 || params->rgb_channels > 4) {
+        return false;
+    }
+
+    size_t stride = (size_t)params->rgb_width * params->rgb_channels;
+    color->channels = params->rgb_channels;
+    color->last_x = params->rgb_width - 1;
+    color->direct = params->rgb_width == width && params->rgb_height == height;
+    color->x_ratio = (float)params->rgb_width / width;
+
+    if (color->direct) {
+        color->row0 = color->row1 = params->rgb + (size_t)row * stride;
+        color->wy = 0.0f;
+        return true;
+    }
+
+    // Pixel centers of both images are aligned
+    float sy = fmaxf((row + 0.5f) * ((float)params->rgb_height / height) - 0.5f, 0.0f);
+    int y0 = (int)sy;
+    if (y0 > params->rgb_height - 1) y0 = params->rgb_height - 1;
+    int y1 = y0 + 1 < params->rgb_height ? y0 + 1 : y0;
+    color->row0 = params->rgb + (size_t)y0 * stride;
+    color->row1 = params->rgb + (size_t)y1 * stride;
+    color->wy = fminf(sy - y0, 1.0f);
+    return true;
+}
+
+// Widens one 8-bit texel to (r, g, b, a) floats in [0, 255]
+static inline __m128 load_texel(const unsigned char* p, int channels) {
+    uint32_t packed;
+    switch (channels) {
+    case 4:
+        memcpy(&packed, p, 4);
+        break;
+    case 3:
+        packed = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | 0xFF000000u;
+        break;
+    case 2:
+        packed = (uint32_t)p[0] * 0x010101u | (uint32_t)p[1] << 24;
+        break;
+    default:
+        packed = (uint32_t)p[0] * 0x010101u | 0xFF000000u;
+        break;
+    }
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128((int)packed)));
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+// Bilinear sample between columns x0 and x0 + 1 of the bracketing rows; all four channels at once
+static inline void sample_color(const ColorRow* color, int x0, float wx, float out[4]) {
+    const __m128 to_unit = _mm_set1_ps(1.0f / 255.0f);
+    int channels = color->channels;
+    __m128 texel;
+
+    if (color->direct) {
+        texel = load_texel(color->row0 + (size_t)x0 * channels, channels);
+    } else {
+        int x1 = x0 < color->last_x ? x0 + 1 : x0;
+        __m128 tx = _mm_set1_ps(wx);
+        __m128 top = lerp4(load_texel(color->row0 + (size_t)x0 * channels, channels),
+                           load_texel(color->row0 + (size_t)x1 * channels, channels), tx);
+        __m128 bottom = lerp4(load_texel(color->row1 + (size_t)x0 * channels, channels),
+                              load_texel(color->row1 + (size_t)x1 * channels, channels), tx);
+        texel = lerp4(top, bottom, _mm_set1_ps(color->wy));
+    }
+
+    _mm_storeu_ps(out, _mm_mul_ps(texel, to_unit));
+}
+
+static inline void write_splat(Splat* splat, float x, float y, float z, float scale, const float color[4]) {
+    splat->x = x;
+    splat->y = y;
+    splat->z = z;
+    splat->dx = 0.0f;
+    splat->dy = 0.0f;
+    splat->dz = 0.0f;
+    splat->r = color[0];
+    splat->g = color[1];
+    splat->b = color[2];
+    splat->a = color[3];
+    splat->scale = scale;
+}
+
+void unproject_pixel(const UnprojectParams* params, float u, float v, float depth, float position[3]) {
+    const CameraIntrinsics* k = &params->intrinsics;
+    const float* m = params->pose ? params->pose : identity_pose;
+    float d = depth * (params->depth_scale > 0.0f ? params->depth_scale : 1.0f);
+
+    float cx = (u - k->cx) / k->fx * d;
+    float cy = -(v - k->cy) / k->fy * d;
+    float cz = -d;
+    position[0] = cx * m[0] + cy * m[1] + cz * m[2] + m[3];
+    position[1] = cx * m[4] + cy * m[5] + cz * m[6] + m[7];
+    position[2] = cx * m[8] + cy * m[9] + cz * m[10] + m[11];
+}
+
+bool unproject_sample_colors(const UnprojectParams* params, int row, int width, int height, float* rgba) {
+    ColorRow color;
+    if (!setup_color_row(params, row, width, height, &color)) return false;
+
+    int col = 0;
+    if (!color.direct) {
+        const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        for (; col + 4 <= width; col += 4) {
+            __m128 sx = _mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_add_ps(_mm_set1_ps((float)col), lane_offsets),
+                                                         _mm_set1_ps(color.x_ratio)),
+                                              _mm_set1_ps(0.5f)), _mm_setzero_ps());
+            __m128i x0 = _mm_min_epi32(_mm_cvttps_epi32(sx), _mm_set1_epi32(color.last_x));
+            int lane_x0[4];
+            float lane_wx[4];
+            _mm_storeu_si128((__m128i*)lane_x0, x0);
+            _mm_storeu_ps(lane_wx, _mm_min_ps(_mm_sub_ps(sx, _mm_cvtepi32_ps(x0)), _mm_set1_ps(1.0f)));
+            for (int lane = 0; lane < 4; lane++) {
+                sample_color(&color, lane_x0[lane], lane_wx[lane], rgba + (size_t)(col + lane) * 4);
+            }
+        }
+    }
+
+    for (; col < width; col++) {
+        float sx = color.direct ? (float)col : fmaxf((col + 0.5f) * color.x_ratio - 0.5f, 0.0f);
+        int x0 = (int)sx < color.last_x ? (int)sx : color.last_x;
+        sample_color(&color, x0, fminf(sx - x0, 1.0f), rgba + (size_t)col * 4);
+    }
+    return true;
+}
+
+int unproject_depth_row(const float* depth, int row, int width, int height, const UnprojectParams* params, Splat* out) {
+    const CameraIntrinsics* k = &params->intrinsics;
+    const float* m = params->pose ? params->pose : identity_pose;
+    float depth_scale = params->depth_scale > 0.0f ? params->depth_scale : 1.0f;
+    float inv_fx = 1.0f / k->fx;
+    float inv_fy = 1.0f / k->fy;
+    float footprint = 0.5f * (inv_fx + inv_fy);  // Pixel size at unit depth
+    float ray_y = -(row - k->cy) * inv_fy;         // Image rows grow downwards
+    int written = 0;
+    int col = 0;
+
+    ColorRow color;
+    bool has_color = setup_color_row(params, row, width, height, &color);
+    float texel[4];
+
+    const __m128 scale_vec = _mm_set1_ps(depth_scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 inf = _mm_set1_ps(INFINITY);
+    const __m128 lane_offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+    for (; col + 4 <= width; col += 4) {
+        __m128 d = _mm_mul_ps(_mm_loadu_ps(depth + col), scale_vec);
+        int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(d, zero), _mm_cmplt_ps(d, inf)));
+        if (!mask) continue;
+
+        // Camera space: x right, y up, looking down -z
+        __m128 u = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_set1_ps((float)col), lane_offsets), _mm_set1_ps(k->cx)),
+                              _mm_set1_ps(inv_fx));
+        __m128 cx = _mm_mul_ps(u, d);
+        __m128 cy = _mm_mul_ps(_mm_set1_ps(ray_y), d);
+        __m128 cz = _mm_sub_ps(zero, d);
+
+        __m128 wx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(m[0])), _mm_mul_ps(cy, _mm_set1_ps(m[1]))),
+                               _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(m[2])), _mm_set1_ps(m[3])));
+        __m128 wy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(m[4])), _mm_mul_ps(cy, _mm_set1_ps(m[5]))),
+                               _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(m[6])), _mm_set1_ps(m[7])));
+        __m128 wz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(m[8])), _mm_mul_ps(cy, _mm_set1_ps(m[9]))),
+                               _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(m[10])), _mm_set1_ps(m[11])));
+        __m128 size = _mm_mul_ps(d, _mm_set1_ps(footprint));
+
+        // Color-frame coordinates of the four pixel centers
+        int lane_x0[4];
+        float lane_wx[4];
+        if (has_color) {
+            __m128 columns = _mm_add_ps(_mm_set1_ps((float)col), lane_offsets);
+            __m128 sx = color.direct ? columns
+                                     : _mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_add_ps(columns, _mm_set1_ps(0.5f)),
+                                                                        _mm_set1_ps(color.x_ratio)),
+                                                             _mm_set1_ps(0.5f)), zero);
+            __m128i x0 = _mm_min_epi32(_mm_cvttps_epi32(sx), _mm_set1_epi32(color.last_x));
+            _mm_storeu_si128((__m128i*)lane_x0, x0);
+            _mm_storeu_ps(lane_wx, _mm_min_ps(_mm_sub_ps(sx, _mm_cvtepi32_ps(x0)), _mm_set1_ps(1.0f)));
+        }
+
+        float lane_x[4], lane_y[4], lane_z[4], lane_scale[4];
+        _mm_storeu_ps(lane_x, wx);
+        _mm_storeu_ps(lane_y, wy);
+        _mm_storeu_ps(lane_z, wz);
+        _mm_storeu_ps(lane_scale, size);
+        for (int lane = 0; lane < 4; lane++) {
+            if (mask & (1 << lane)) {
+                if (has_color) sample_color(&color, lane_x0[lane], lane_wx[lane], texel);
+                write_splat(&out[written++], lane_x[lane], lane_y[lane], lane_z[lane], lane_scale[lane],
+                            has_color ? texel : white);
+            }
+        }
+    }
+
+    for (; col < width; col++) {
+        float d = depth[col] * depth_scale;
+        if (!(d > 0.0f) || isinf(d)) continue;
+
+        float cx = (col - k->cx) * inv_fx * d;
+        float cy = ray_y * d;
+        float cz = -d;
+
+        if (has_color) {
+            float sx = color.direct ? (float)col : fmaxf((col + 0.5f) * color.x_ratio - 0.5f, 0.0f);
+            int x0 = (int)sx < color.last_x ? (int)sx : color.last_x;
+            sample_color(&color, x0, fminf(sx - x0, 1.0f), texel);
+        }
+        write_splat(&out[written++],
+                    cx * m[0] + cy * m[1] + cz * m[2] + m[3],
+                    cx * m[4] + cy * m[5] + cz * m[6] + m[7],
+                    cx * m[8] + cy * m[9] + cz * m[10] + m[11],
+                    d * footprint, has_color ? texel : white);
+    }
+
+    return written;
+}
+
+int unproject_depth_into(const cnpy_array* depth, const UnprojectParams* params, Splat* splats, size_t capacity) {
+    size_t num_pixels = cnpy_num_elements(depth);
+    size_t height = depth->ndim > 1 ? depth->shape[0] : 1;
+    size_t width = height ? num_pixels / height : 0;
+
+    if (num_pixels == 0 || depth->data == NULL) {
+        log_error("Depth map is empty.");
+        return 0;
+    }
+    if (capacity < num_pixels) {
+        log_error("Splat buffer holds %zu splats but the depth map has %zu pixels.", capacity, num_pixels);
+        return 0;
+    }
+
+    // Row counts and one row of converted depth per thread are load-scoped scratch
+    Arena* scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    int thread_count = omp_get_max_threads();
+    int* row_counts = (int*)arena_alloc(scratch, height * sizeof(int), 64);
+    float* row_buffers = (float*)arena_alloc(scratch, (size_t)thread_count * width * sizeof(float), 64);
+    if (!row_counts || !row_buffers) {
+        log_error("Failed to allocate memory for depth rows.");
+        arena_release(scratch, mark);
+        return 0;
+    }
+
+    // Every row writes compactly at the start of its own pixel range
+    #pragma omp parallel num_threads(thread_count)
+    {
+        float* row_values = row_buffers + (size_t)omp_get_thread_num() * width;
+
+        #pragma omp for schedule(static)
+        for (long long row = 0; row < (long long)height; row++) {
+            depth_row_to_float(depth, (size_t)row, width, row_values);
+            row_counts[row] = unproject_depth_row(row_values, (int)row, (int)width, (int)height, params,
+                                                  splats + (size_t)row * width);
+        }
+    }
+
+    // Close the gaps left by invalid pixels; rows without gaps are not moved
+    size_t total = 0;
+    for (size_t row = 0; row < height; row++) {
+        if (total != row * width && row_counts[row] > 0) {
+            memmove(splats + total, splats + row * width, (size_t)row_counts[row] * sizeof(Splat));
+        }
+        total += (size_t)row_counts[row];
+    }
+    arena_release(scratch, mark);
+
+    if (total == 0) {
+        log_error("Depth map has no valid samples.");
+        return 0;
+    }
+
+    return (int)total;
+}
+
+int unproject_depth_to_splats(const cnpy_array* depth, const UnprojectParams* params, Splat** splats) {
+    size_t num_pixels = cnpy_num_elements(depth);
+    *splats = num_pixels ? (Splat*)malloc(num_pixels * sizeof(Splat)) : NULL;
+    if (*splats == NULL) {
+        log_error("Failed to allocate memory for splats.");
+        return 0;
+    }
+
+    int total = unproject_depth_into(depth, params, *splats, num_pixels);
+    if (total == 0) {
+        free(*splats);
+        *splats = NULL;
+    }
+    return total;
+}
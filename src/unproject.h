@@ -0,0 +1,88 @@
+#ifndef UNPROJECT_H
+#define UNPROJECT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "splat.h"
+#include "cnpy.h"
+
+// Pinhole camera intrinsics in pixels
+typedef struct {
+    float fx, fy;   // Focal lengths
+    float cx, cy;   // Principal point
+} CameraIntrinsics;
+
+/**
+ * Parameters for turning a depth map into world-space splats.
+ *
+ * Depth pixels follow the usual image convention (x right, y down, depth
+ * along the view ray). Splats are produced in the renderer's convention
+ * (x right, y up, camera looking down -z), then transformed by pose.
+ */
+typedef struct {
+    CameraIntrinsics intrinsics;
+    const float* pose;   // Row-major 3x4 camera-to-world [R|t], NULL for identity
+    float depth_scale;   // Multiplier for raw depth values (e.g. 0.001 for millimetres), 0 = 1
+
+    // Optional color frame (interleaved 8-bit, 1-4 channels, any resolution).
+    // A frame with a different resolution than the depth map is bilinearly resampled.
+    // A fourth channel becomes opacity. NULL leaves splats white.
+    const unsigned char* rgb;
+    int rgb_width, rgb_height, rgb_channels;
+} UnprojectParams;
+
+// Intrinsics of a centered pinhole camera with the given vertical field of view
+CameraIntrinsics camera_intrinsics_from_fov(int width, int height, float fov_y_degrees);
+
+/**
+ * @brief Unprojects one row of metric depth into splats.
+ *
+ * Pixels with invalid depth (0, negative, NaN or infinite) are skipped, so
+ * fewer than width splats may be written. Four pixels are processed per SSE
+ * iteration. Each splat's scale is the pixel footprint at its depth, and its
+ * color is sampled from params->rgb in the same pass.
+ *
+ * @param depth Row of raw depth values (multiplied by depth_scale).
+ * @param row Row index of the depth values in the image.
+ * @param width Number of pixels in the row.
+ * @param height Number of rows in the depth image (used to map rows onto the color frame).
+ * @param params Camera intrinsics, pose and depth scale.
+ * @param out Destination with room for width splats.
+ * @return Number of splats written.
+ */
+int unproject_depth_row(const float* depth, int row, int width, int height, const UnprojectParams* params, Splat* out);
+
+/**
+ * @brief Unprojects an HxW depth map (any dtype cnpy understands) into splats.
+ *
+ * Rows are processed in parallel. Each row converts its depth samples to
+ * float, unprojects them and samples their colors in the same pass; the
+ * color frame is read in place.
+ *
+ * @param depth Depth array of shape (H, W) or (H, W, 1).
+ * @param params Camera intrinsics, pose and depth scale.
+ * @param splats Receives a malloc'd array of splats.
+ * @return Number of valid splats, 0 on failure.
+ */
+int unproject_depth_to_splats(const cnpy_array* depth, const UnprojectParams* params, Splat** splats);
+
+/**
+ * @brief Same as unproject_depth_to_splats, writing into a caller-owned buffer
+ * (e.g. one taken from a BufferPool and reused across frames).
+ *
+ * @param capacity Number of splats the buffer holds; must be at least H * W.
+ * @return Number of valid splats, 0 on failure.
+ */
+int unproject_depth_into(const cnpy_array* depth, const UnprojectParams* params, Splat* splats, size_t capacity);
+
+// World-space position of image point (u, v) at raw depth (scaled by depth_scale)
+void unproject_pixel(const UnprojectParams* params, float u, float v, float depth, float position[3]);
+
+// Samples the color frame for every pixel of a depth row (4 floats in [0, 1] per pixel).
+// Returns false, writing nothing, when params has no color frame.
+bool unproject_sample_colors(const UnprojectParams* params, int row, int width, int height, float* rgba);
+
+// Converts one image row of a depth array to float, handling Fortran-ordered storage
+void depth_row_to_float(const cnpy_array* depth, size_t row, size_t width, float* out);
+
+#endif // UNPROJECT_H
@@ -0,0 +1,473 @@
+// File: tools/loader_bench.c
+// Loader throughput benchmark. Writes synthetic depth maps as npz files (stored
+// and deflated, in several dtypes) and color frames as PNG files, then times
+// cnpy_load_npz, cnpy_load_npy_from_memory, load_png_image and
+// load_splats_from_npz on them one at a time. Throughput, peak resident memory
+// and peak tracked heap (mem_track.h) are written as JSON so that loader
+// changes can be compared run against run. The inputs are generated from fixed
+// seeds, so every run and every commit decodes the same bytes.
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zip.h>
+#include <zlib.h>
+#include "cnpy.h"
+#include "data_loader.h"
+#include "image_loader.h"
+#include "platform.h"
+#include "mem_track.h"
+
+// Image decodes are counted as MEM_IMAGE, like in the viewer
+#define STBI_MALLOC(size) mem_malloc(MEM_IMAGE, size)
+#define STBI_REALLOC(block, size) mem_realloc(MEM_IMAGE, block, size)
+#define STBI_FREE(block) mem_free(MEM_IMAGE, block)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define BENCH_MAX_LIST 16
+#define BENCH_DEFAULT_ITERATIONS 5
+#define BENCH_DEFAULT_DIR "loader_bench_data"
+#define BENCH_DEFAULT_OUT "loader_bench.json"   // Not stdout: the loaders print their own progress there
+#define BENCH_HOLE_PERCENT 3                    // Depth samples left at 0, as sensors do for missing returns
+
+typedef enum {
+    BENCH_F4 = 0,
+    BENCH_F8,
+    BENCH_U2,   // Millimeters, as depth cameras deliver them
+    BENCH_I4,
+    BENCH_DTYPE_COUNT
+} BenchDtype;
+
+static const char* dtype_names[BENCH_DTYPE_COUNT] = {"f4", "f8", "u2", "i4"};
+static const size_t dtype_sizes[BENCH_DTYPE_COUNT] = {4, 8, 2, 4};
+
+typedef struct {
+    int widths[BENCH_MAX_LIST], heights[BENCH_MAX_LIST];
+    int size_count;
+    int iterations;
+    const char* dir;
+    const char* out_path;
+    const char* label;   // Free text copied into the results, e.g. a commit hash
+    bool keep;           // Leave the generated files in dir
+} BenchOptions;
+
+typedef struct {
+    double ms_p50, ms_min;
+    size_t peak_rss;     // Largest growth above the resident size before a call
+    size_t peak_tracked; // Largest growth of the tracked heap (mem_track.h) during a call
+    bool ok;
+} BenchTiming;
+
+// Deterministic generator so every run decodes the same files
+static uint32_t next_random(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static float random_unit(uint32_t* state) {
+    return (next_random(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// A smooth surface between 1 and 3 meters with sensor noise and a few holes
+static double depth_sample(int x, int y, uint32_t* state) {
+    if (next_random(state) % 100 < BENCH_HOLE_PERCENT) return 0.0;
+    double surface = 2.0 + 0.6 * sin(x * 0.011) * cos(y * 0.017) + 0.3 * sin((x + y) * 0.003);
+    return surface + (random_unit(state) - 0.5f) * 0.004;
+}
+
+static void store_sample(unsigned char* out, BenchDtype dtype, double meters) {
+    switch (dtype) {
+        case BENCH_F4: { float v = (float)meters; memcpy(out, &v, 4); break; }
+        case BENCH_F8: memcpy(out, &meters, 8); break;
+        case BENCH_U2: { uint16_t v = (uint16_t)lround(meters * 1000.0); memcpy(out, &v, 2); break; }
+        case BENCH_I4: { int32_t v = (int32_t)lround(meters * 1000.0); memcpy(out, &v, 4); break; }
+        default: break;
+    }
+}
+
+// An in-memory .npy file, little-endian and C-ordered like numpy.save writes it
+static unsigned char* make_npy(int width, int height, BenchDtype dtype, size_t* size) {
+    char header[128];
+    int length = snprintf(header, sizeof(header), "{'descr': '<%s', 'fortran_order': False, 'shape': (%d, %d), }",
+                          dtype_names[dtype], height, width);
+
+    // Magic, version and length take 10 bytes; numpy pads the header with spaces to 64 and ends it with a newline
+    size_t header_size = (10 + (size_t)length + 1 + 63) / 64 * 64;
+    size_t data_size = (size_t)width * height * dtype_sizes[dtype];
+    unsigned char* npy = (unsigned char*)malloc(header_size + data_size);
+    if (!npy) {
+        printf("Error: Failed to allocate a %dx%d npy buffer.\n", width, height);
+        return NULL;
+    }
+
+    memcpy(npy, "\x93NUMPY\x01\x00", 8);
+    npy[8] = (unsigned char)((header_size - 10) & 0xFF);
+    npy[9] = (unsigned char)((header_size - 10) >> 8);
+    memset(npy + 10, ' ', header_size - 10);
+    memcpy(npy + 10, header, (size_t)length);
+    npy[header_size - 1] = '\n';
+
+    uint32_t state = 0x5eed0000u + (uint32_t)width * 31u + (uint32_t)height;
+    unsigned char* out = npy + header_size;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            store_sample(out, dtype, depth_sample(x, y, &state));
+            out += dtype_sizes[dtype];
+        }
+    }
+    *size = header_size + data_size;
+    return npy;
+}
+
+static bool write_npz(const char* path, const unsigned char* npy, size_t npy_size, bool deflate) {
+    int error = 0;
+    zip_t* archive = zip_open(path, ZIP_CREATE | ZIP_TRUNCATE, &error);
+    if (!archive) {
+        printf("Error: Failed to create %s (libzip error %d).\n", path, error);
+        return false;
+    }
+    zip_source_t* source = zip_source_buffer(archive, npy, npy_size, 0);
+    zip_int64_t index = source ? zip_file_add(archive, "arr_0.npy", source, ZIP_FL_OVERWRITE) : -1;
+    if (index < 0) {
+        printf("Error: Failed to add arr_0.npy to %s: %s\n", path, zip_strerror(archive));
+        if (source) zip_source_free(source);
+        zip_discard(archive);
+        return false;
+    }
+    zip_set_file_compression(archive, (zip_uint64_t)index, deflate ? ZIP_CM_DEFLATE : ZIP_CM_STORE, 0);
+    if (zip_close(archive) != 0) {
+        printf("Error: Failed to write %s: %s\n", path, zip_strerror(archive));
+        zip_discard(archive);
+        return false;
+    }
+    return true;
+}
+
+static void put_be32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+static bool write_png_chunk(FILE* file, const char* type, const unsigned char* data, size_t size) {
+    unsigned char length[4], crc[4];
+    put_be32(length, (uint32_t)size);
+    uLong check = crc32(0L, (const Bytef*)type, 4);
+    if (size > 0) check = crc32(check, data, (uInt)size);
+    put_be32(crc, (uint32_t)check);
+    return fwrite(length, 1, 4, file) == 4 && fwrite(type, 1, 4, file) == 4 &&
+           fwrite(data, 1, size, file) == size && fwrite(crc, 1, 4, file) == 4;
+}
+
+// An 8-bit RGB frame with gradients and noise, every row using the Sub filter as encoders mostly pick for photos
+static bool write_png(const char* path, int width, int height) {
+    size_t stride = (size_t)width * 3 + 1;
+    size_t raw_size = stride * height;
+    uLongf packed_size = compressBound((uLong)raw_size);
+    unsigned char* raw = (unsigned char*)malloc(raw_size);
+    unsigned char* packed = (unsigned char*)malloc(packed_size);
+    if (!raw || !packed) {
+        printf("Error: Failed to allocate a %dx%d PNG frame.\n", width, height);
+        free(raw);
+        free(packed);
+        return false;
+    }
+
+    uint32_t state = 0xc0101u + (uint32_t)width * 31u + (uint32_t)height;
+    for (int y = 0; y < height; y++) {
+        unsigned char* row = raw + stride * y;
+        row[0] = 1;
+        unsigned char previous[3] = {0, 0, 0};
+        for (int x = 0; x < width; x++) {
+            unsigned char pixel[3] = {
+                (unsigned char)(x * 255 / width + (next_random(&state) >> 29)),
+                (unsigned char)(y * 255 / height + (next_random(&state) >> 29)),
+                (unsigned char)(128 + 100 * sin((x + y) * 0.01) + (next_random(&state) >> 29))
+            };
+            for (int c = 0; c < 3; c++) {
+                row[1 + x * 3 + c] = (unsigned char)(pixel[c] - previous[c]);
+                previous[c] = pixel[c];
+            }
+        }
+    }
+
+    bool ok = compress2(packed, &packed_size, raw, (uLong)raw_size, 6) == Z_OK;
+    FILE* file = ok ? fopen(path, "wb") : NULL;
+    if (file) {
+        unsigned char ihdr[13];
+        put_be32(ihdr, (uint32_t)width);
+        put_be32(ihdr + 4, (uint32_t)height);
+        ihdr[8] = 8;    // Bit depth
+        ihdr[9] = 2;    // Truecolor
+        ihdr[10] = ihdr[11] = ihdr[12] = 0;
+        ok = fwrite("\x89PNG\r\n\x1a\n", 1, 8, file) == 8 && write_png_chunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+             write_png_chunk(file, "IDAT", packed, packed_size) && write_png_chunk(file, "IEND", NULL, 0);
+        ok = fclose(file) == 0 && ok;
+    }
+    if (!ok) printf("Error: Failed to write %s\n", path);
+
+    free(raw);
+    free(packed);
+    return ok;
+}
+
+// One call of a loader under test; returns false if it failed
+typedef bool (*BenchCall)(const void* input);
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+} MemoryInput;
+
+static bool call_cnpy_load_npz(const void* input) {
+    cnpy_array array = cnpy_load_npz((const char*)input, "arr_0");
+    bool ok = array.data != NULL;
+    cnpy_free(&array);
+    return ok;
+}
+
+static bool call_cnpy_load_npy_from_memory(const void* input) {
+    const MemoryInput* npy = (const MemoryInput*)input;
+    cnpy_array array = cnpy_load_npy_from_memory(npy->data, npy->size);
+    bool ok = array.data != NULL;
+    cnpy_free(&array);
+    return ok;
+}
+
+static bool call_load_png_image(const void* input) {
+    int width, height, channels;
+    unsigned char* pixels = load_png_image((const char*)input, &width, &height, &channels);
+    free_png_image(pixels);
+    return pixels != NULL;
+}
+
+static bool call_load_splats_from_npz(const void* input) {
+    Splat* splats = NULL;
+    int count = load_splats_from_npz((const char*)input, &splats);
+    mem_free(MEM_LOADER, splats);
+    return count > 0;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+// One untimed call to warm the file cache, then the timed iterations
+static BenchTiming time_calls(BenchCall call, const void* input, int iterations) {
+    BenchTiming timing;
+    memset(&timing, 0, sizeof(timing));
+    double times[BENCH_MAX_LIST * 4];
+    if (iterations > (int)(sizeof(times) / sizeof(times[0]))) iterations = (int)(sizeof(times) / sizeof(times[0]));
+
+    if (!call(input)) return timing;
+    for (int i = 0; i < iterations; i++) {
+        size_t resident = 0, peak = 0;
+        platform_reset_peak_memory();
+        platform_memory_usage(&resident, &peak);
+        MemUsage tracked;
+        mem_usage_reset_peaks();
+        mem_usage_total(&tracked);
+
+        double start = platform_time_seconds();
+        bool ok = call(input);
+        times[i] = (platform_time_seconds() - start) * 1000.0;
+        if (!ok) return timing;
+
+        size_t after_resident, after_peak;
+        if (platform_memory_usage(&after_resident, &after_peak) && after_peak > resident &&
+            after_peak - resident > timing.peak_rss) {
+            timing.peak_rss = after_peak - resident;
+        }
+        MemUsage after_tracked;
+        mem_usage_total(&after_tracked);
+        if (after_tracked.peak - tracked.current > timing.peak_tracked) {
+            timing.peak_tracked = after_tracked.peak - tracked.current;
+        }
+    }
+
+    qsort(times, (size_t)iterations, sizeof(double), compare_double);
+    timing.ms_p50 = times[iterations / 2];
+    timing.ms_min = times[0];
+    timing.ok = true;
+    return timing;
+}
+
+typedef struct {
+    FILE* out;
+    bool first;
+    int iterations;
+} BenchReport;
+
+// Throughput is over the decoded array or image, so stored and deflated files of the same data compare directly
+static bool run_case(BenchReport* report, const char* loader, BenchCall call, const void* input, const char* dtype,
+                     const char* compression, int width, int height, size_t file_bytes, size_t data_bytes) {
+    fprintf(stderr, "%s %dx%d %s %s...\n", loader, width, height, dtype, compression);
+    BenchTiming timing = time_calls(call, input, report->iterations);
+    if (!timing.ok) {
+        printf("Error: %s failed on the %dx%d %s %s input.\n", loader, width, height, dtype, compression);
+        return false;
+    }
+
+    double seconds = timing.ms_p50 / 1000.0;
+    fprintf(report->out, "%s\n    {\"loader\": \"%s\", \"dtype\": \"%s\", \"compression\": \"%s\", \"width\": %d, \"height\": %d,\n"
+                         "     \"file_bytes\": %zu, \"data_bytes\": %zu, \"ms_p50\": %.4f, \"ms_min\": %.4f,\n"
+                         "     \"mb_per_sec\": %.2f, \"file_mb_per_sec\": %.2f, \"peak_rss_mb\": %.2f,\n"
+                         "     \"peak_tracked_mb\": %.2f}",
+            report->first ? "" : ",", loader, dtype, compression, width, height, file_bytes, data_bytes,
+            timing.ms_p50, timing.ms_min, data_bytes / seconds / 1e6, file_bytes / seconds / 1e6,
+            timing.peak_rss / 1e6, timing.peak_tracked / 1e6);
+    report->first = false;
+    return true;
+}
+
+static size_t file_size(const char* path) {
+    unsigned long long size = 0, modified;
+    return platform_file_info(path, &size, &modified) ? (size_t)size : 0;
+}
+
+static bool run_size(BenchReport* report, const BenchOptions* options, int width, int height) {
+    char name[128];
+    bool ok = true;
+
+    for (int d = 0; d < BENCH_DTYPE_COUNT && ok; d++) {
+        BenchDtype dtype = (BenchDtype)d;
+        size_t npy_size;
+        unsigned char* npy = make_npy(width, height, dtype, &npy_size);
+        if (!npy) return false;
+        size_t data_bytes = (size_t)width * height * dtype_sizes[dtype];
+
+        MemoryInput memory = {npy, npy_size};
+        ok = run_case(report, "cnpy_load_npy_from_memory", call_cnpy_load_npy_from_memory, &memory,
+                      dtype_names[dtype], "none", width, height, npy_size, data_bytes);
+
+        for (int deflate = 0; deflate < 2 && ok; deflate++) {
+            const char* compression = deflate ? "deflate" : "store";
+            snprintf(name, sizeof(name), "depth_%dx%d_%s_%s.npz", width, height, dtype_names[dtype], compression);
+            char* path = platform_join_path(options->dir, name);
+            ok = path && write_npz(path, npy, npy_size, deflate != 0);
+            if (ok) {
+                size_t bytes = file_size(path);
+                ok = run_case(report, "cnpy_load_npz", call_cnpy_load_npz, path, dtype_names[dtype], compression,
+                              width, height, bytes, data_bytes) &&
+                     run_case(report, "load_splats_from_npz", call_load_splats_from_npz, path, dtype_names[dtype],
+                              compression, width, height, bytes, data_bytes);
+            }
+            if (path && !options->keep) remove(path);
+            free(path);
+        }
+        free(npy);
+    }
+
+    if (ok) {
+        snprintf(name, sizeof(name), "color_%dx%d.png", width, height);
+        char* path = platform_join_path(options->dir, name);
+        ok = path && write_png(path, width, height) &&
+             run_case(report, "load_png_image", call_load_png_image, path, "u1", "deflate", width, height,
+                      file_size(path), (size_t)width * height * 3);
+        if (path && !options->keep) remove(path);
+        free(path);
+    }
+    return ok;
+}
+
+static int parse_sizes(const char* text, int* widths, int* heights, int max_count) {
+    int count = 0;
+    while (*text && count < max_count) {
+        int width, height, consumed;
+        if (sscanf(text, "%dx%d%n", &width, &height, &consumed) != 2 || width <= 0 || height <= 0) {
+            return 0;
+        }
+        widths[count] = width;
+        heights[count] = height;
+        count++;
+        text += consumed;
+        if (*text == ',') text++;
+        else if (*text != '\0') return 0;
+    }
+    return count;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--sizes 640x480,1920x1080] [--iterations N] [--dir loader_bench_data] [--keep]\n"
+           "       [--label TEXT] [--out loader_bench.json]\n", program);
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->iterations = BENCH_DEFAULT_ITERATIONS;
+    options->dir = BENCH_DEFAULT_DIR;
+    options->out_path = BENCH_DEFAULT_OUT;
+
+    static const int default_widths[] = {640, 1280, 1920}, default_heights[] = {480, 720, 1080};
+    options->size_count = 3;
+    memcpy(options->widths, default_widths, sizeof(default_widths));
+    memcpy(options->heights, default_heights, sizeof(default_heights));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--keep") == 0) {
+            options->keep = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (strcmp(argv[i], "--sizes") == 0 && ok) {
+            ok = (options->size_count = parse_sizes(value, options->widths, options->heights, BENCH_MAX_LIST)) > 0;
+        } else if (strcmp(argv[i], "--iterations") == 0 && ok) {
+            options->iterations = atoi(value);
+            ok = options->iterations > 0 && options->iterations <= BENCH_MAX_LIST * 4;
+        } else if (strcmp(argv[i], "--dir") == 0 && ok) {
+            options->dir = value;
+        } else if (strcmp(argv[i], "--label") == 0 && ok) {
+            options->label = value;
+            ok = strpbrk(value, "\"\\") == NULL;   // Copied into the JSON as is
+        } else if (strcmp(argv[i], "--out") == 0 && ok) {
+            options->out_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printf("Invalid argument: %s\n", argv[i]);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (!platform_make_dir(options.dir)) {
+        printf("Failed to create %s.\n", options.dir);
+        return 1;
+    }
+
+    FILE* out = fopen(options.out_path, "w");
+    if (!out) {
+        printf("Failed to open %s for writing.\n", options.out_path);
+        return 1;
+    }
+
+    // Without a resettable peak (everywhere but Linux) peak_rss_mb is the process peak, which only grows
+    bool per_call_peak = platform_reset_peak_memory();
+    fprintf(out, "{\n  \"benchmark\": \"loader_bench\",\n  \"label\": \"%s\",\n  \"iterations\": %d,\n"
+                 "  \"peak_rss_scope\": \"%s\",\n  \"results\": [",
+            options.label ? options.label : "", options.iterations, per_call_peak ? "call" : "process");
+
+    BenchReport report = {out, true, options.iterations};
+    bool ok = true;
+    for (int s = 0; s < options.size_count && ok; s++) {
+        ok = run_size(&report, &options, options.widths[s], options.heights[s]);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+    return ok ? 0 : 1;
+}
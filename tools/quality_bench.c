@@ -0,0 +1,429 @@
+// File: tools/quality_bench.c
+// Image-quality benchmark for the approximate scene paths. Builds splats from
+// one depth frame in a reference configuration (one splat per pixel, full
+// precision) and in each fast configuration (decimated, quantized), renders
+// them headless from the capture camera, and reports PSNR, SSIM and error
+// against the reference render and against the frame's own RGB image, next
+// to build and render times. Without --npz a synthetic frame is generated from
+// a fixed seed, so every run compares the same pixels.
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "renderer.h"
+#include "data_loader.h"
+#include "decimate.h"
+#include "image_quality.h"
+#include "splat_quant.h"
+#include "unproject.h"
+#include "platform.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define BENCH_DEFAULT_WIDTH 640
+#define BENCH_DEFAULT_HEIGHT 480
+#define BENCH_DEFAULT_FRAMES 20
+#define BENCH_DEFAULT_WARMUP 2
+#define BENCH_DEFAULT_OUT "quality_bench.json"   // Not stdout: the loaders print their own progress there
+
+// One way of turning the depth frame into something the renderer draws
+typedef struct {
+    const char* name;
+    bool decimate;
+    DecimateOptions decimate_options;   // Zero fields use the decimation defaults
+    bool quantize;
+} QualityConfig;
+
+// The first entry is the reference the others are measured against
+static const QualityConfig quality_configs[] = {
+    {"reference", false, {0, 0.0f, 0.0f}, false},
+    {"decimated", true, {0, 0.0f, 0.0f}, false},
+    {"decimated_coarse", true, {32, 0.03f, 0.15f}, false},
+    {"quantized", false, {0, 0.0f, 0.0f}, true},
+    {"decimated_quantized", true, {0, 0.0f, 0.0f}, true},
+};
+
+#define QUALITY_CONFIG_COUNT (sizeof(quality_configs) / sizeof(quality_configs[0]))
+
+typedef struct {
+    const char* npz_path;   // NULL for the synthetic frame
+    const char* rgb_path;
+    int width, height;      // Synthetic frame size
+    int frames;
+    int warmup;
+    int threads;            // 0 for the OpenMP default
+    const char* configs;    // Comma-separated config names, NULL for all
+    const char* image_dir;  // Renders written here as PPM, NULL for none
+    const char* out_path;
+} BenchOptions;
+
+// The depth frame every configuration is built from, and the image renders are compared with
+typedef struct {
+    DepthFrame loaded;          // Set when read from --npz
+    float* depth;               // Synthetic frame
+    unsigned char* rgb;
+    cnpy_array view;
+    size_t shape[2];
+    UnprojectParams params;
+    unsigned char* image;       // RGB8 at the render size, NULL without a color frame
+    int width, height;          // Render size, even in both directions for the depth buffer clear
+} QualityFrame;
+
+typedef struct {
+    int splats;
+    size_t scene_bytes;
+    double build_ms;
+    double ms_p50, ms_min;
+    unsigned char* first;       // First and last timed frames, RGB8
+    unsigned char* last;
+} ConfigResult;
+
+// Deterministic generator so every run compares the same frame
+static uint32_t next_random(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+// Ground, back wall and a box with smooth shading and slight noise, unprojected like a real capture
+static bool generate_frame(int width, int height, QualityFrame* frame) {
+    size_t pixels = (size_t)width * height;
+    frame->depth = (float*)malloc(pixels * sizeof(float));
+    frame->rgb = (unsigned char*)malloc(pixels * 3);
+    if (!frame->depth || !frame->rgb) return false;
+
+    uint32_t seed = 12345u;
+    CameraIntrinsics intrinsics = camera_intrinsics_from_fov(width, height, 90.0f);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + x;
+            float ray_y = (y - intrinsics.cy) / intrinsics.fy;
+            bool ground = ray_y > 0.25f;
+            bool box = x > width / 2 && x < width * 3 / 4 && y > height / 4 && y < height / 2;
+            float z = ground ? 0.75f / ray_y : 3.0f;
+            if (box) z = 2.0f + 0.5f * (float)x / width;
+            frame->depth[i] = z < 3.0f ? z : 3.0f;
+
+            float shade = 0.6f + 0.4f * (float)y / height;
+            int noise = (int)(next_random(&seed) >> 29);
+            unsigned char* p = frame->rgb + i * 3;
+            p[0] = (unsigned char)((box ? 200 : 60) * shade) + noise;
+            p[1] = (unsigned char)((ground ? 140 : 90) * shade) + noise;
+            p[2] = (unsigned char)((box ? 40 : 160) * shade) + noise;
+        }
+    }
+
+    frame->shape[0] = (size_t)height;
+    frame->shape[1] = (size_t)width;
+    frame->view.data = frame->depth;
+    frame->view.shape = frame->shape;
+    frame->view.ndim = 2;
+    frame->view.datatype = 'f';
+    frame->view.dtype = CNPY_DTYPE_F4;
+    frame->view.word_size = sizeof(float);
+    frame->params.intrinsics = intrinsics;
+    frame->params.rgb = frame->rgb;
+    frame->params.rgb_width = width;
+    frame->params.rgb_height = height;
+    frame->params.rgb_channels = 3;
+    return true;
+}
+
+// Crops the color frame to the render size and drops its alpha channel
+static bool copy_image(const unsigned char* source, int source_width, int channels, QualityFrame* frame) {
+    frame->image = (unsigned char*)malloc((size_t)frame->width * frame->height * 3);
+    if (!frame->image) return false;
+    for (int y = 0; y < frame->height; y++) {
+        for (int x = 0; x < frame->width; x++) {
+            const unsigned char* in = source + ((size_t)y * source_width + x) * channels;
+            unsigned char* out = frame->image + ((size_t)y * frame->width + x) * 3;
+            out[0] = in[0];
+            out[1] = in[1];
+            out[2] = in[2];
+        }
+    }
+    return true;
+}
+
+static bool load_frame(const BenchOptions* options, QualityFrame* frame) {
+    memset(frame, 0, sizeof(*frame));
+    if (!options->npz_path) {
+        if (!generate_frame(options->width, options->height, frame)) {
+            printf("Error: Failed to allocate the synthetic frame.\n");
+            return false;
+        }
+        frame->width = options->width & ~1;
+        frame->height = options->height & ~1;
+        return copy_image(frame->rgb, options->width, 3, frame);
+    }
+
+    if (!load_depth_frame_cached(NULL, options->npz_path, options->rgb_path, &frame->loaded)) {
+        printf("Failed to load %s.\n", options->npz_path);
+        return false;
+    }
+    // Loaded frames refer to themselves, so the copies point into the DepthFrame instead
+    frame->view = frame->loaded.view;
+    frame->params = frame->loaded.params;
+
+    // The color frame sets the render size when there is one; renders then line up with it pixel for pixel
+    bool has_rgb = frame->loaded.rgba.data != NULL;
+    int width = has_rgb ? frame->loaded.rgba.width : frame->loaded.depth.width;
+    int height = has_rgb ? frame->loaded.rgba.height : frame->loaded.depth.height;
+    frame->width = width & ~1;
+    frame->height = height & ~1;
+    return !has_rgb || copy_image((const unsigned char*)frame->loaded.rgba.data, width, 4, frame);
+}
+
+static void free_frame(QualityFrame* frame) {
+    depth_frame_release(&frame->loaded);
+    free(frame->depth);
+    free(frame->rgb);
+    free(frame->image);
+}
+
+// The capture camera: at the origin looking down -z with the renderer's 90 degree vertical field of view
+static void capture_camera(Camera* camera) {
+    camera_init(camera);
+    camera->position = (vec3){0.0f, 0.0f, 0.0f};
+    camera_update_vectors(camera);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+static bool run_config(const QualityConfig* config, const QualityFrame* frame, const BenchOptions* options,
+                       ConfigResult* result) {
+    memset(result, 0, sizeof(*result));
+    size_t image_bytes = (size_t)frame->width * frame->height * 3;
+    result->first = (unsigned char*)malloc(image_bytes);
+    result->last = (unsigned char*)malloc(image_bytes);
+    double* times = (double*)malloc((size_t)options->frames * sizeof(double));
+    if (!result->first || !result->last || !times) {
+        free(times);
+        return false;
+    }
+
+    double start = platform_time_seconds();
+    Splat* splats = NULL;
+    result->splats = config->decimate
+        ? decimate_depth_to_splats(&frame->view, &frame->params, &config->decimate_options, &splats)
+        : unproject_depth_to_splats(&frame->view, &frame->params, &splats);
+    QuantizedScene quant;
+    bool quantized = config->quantize && result->splats > 0 &&
+                     quant_scene_build_splats(&quant, splats, (size_t)result->splats);
+    result->build_ms = (platform_time_seconds() - start) * 1000.0;
+    if (result->splats == 0 || (config->quantize && !quantized)) {
+        printf("Failed to build the %s scene.\n", config->name);
+        free(splats);
+        free(times);
+        return false;
+    }
+    result->scene_bytes = quantized ? quant_scene_bytes(&quant) : (size_t)result->splats * sizeof(Splat);
+
+    Renderer renderer;
+    init_renderer_headless(&renderer, frame->width, frame->height);
+    Camera camera;
+    capture_camera(&camera);
+
+    for (int i = -options->warmup; i < options->frames; i++) {
+        double frame_start = platform_time_seconds();
+        if (quantized) {
+            render_scene_quantized(&renderer, &quant, &camera, DEBUG_NONE, 10);
+        } else {
+            render_scene(&renderer, splats, result->splats, &camera, DEBUG_NONE, 10);
+        }
+        if (i < 0) continue;
+        times[i] = (platform_time_seconds() - frame_start) * 1000.0;
+        if (i == 0) memcpy(result->first, renderer.framebuffer, image_bytes);
+    }
+    memcpy(result->last, renderer.framebuffer, image_bytes);
+
+    qsort(times, (size_t)options->frames, sizeof(double), compare_double);
+    result->ms_p50 = times[options->frames / 2];
+    result->ms_min = times[0];
+
+    free_renderer(&renderer);
+    if (quantized) quant_scene_free(&quant);
+    free(splats);
+    free(times);
+    return true;
+}
+
+static void free_result(ConfigResult* result) {
+    free(result->first);
+    free(result->last);
+}
+
+static bool write_ppm(const char* dir, const char* name, const unsigned char* image, int width, int height) {
+    char file_name[128];
+    snprintf(file_name, sizeof(file_name), "%s.ppm", name);
+    char* path = platform_join_path(dir, file_name);
+    FILE* file = path ? fopen(path, "wb") : NULL;
+    if (!file) {
+        printf("Failed to write %s.\n", path ? path : file_name);
+        free(path);
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    bool ok = fwrite(image, 1, (size_t)width * height * 3, file) == (size_t)width * height * 3;
+    ok = fclose(file) == 0 && ok;
+    free(path);
+    return ok;
+}
+
+// JSON has no infinity; identical images get a null PSNR
+static void write_quality(FILE* out, const char* key, const ImageQuality* quality) {
+    fprintf(out, ",\n     \"%s\": {\"psnr\": ", key);
+    if (isinf(quality->psnr)) {
+        fprintf(out, "null");
+    } else {
+        fprintf(out, "%.3f", quality->psnr);
+    }
+    fprintf(out, ", \"ssim\": %.5f, \"mse\": %.4f, \"mean_error\": %.4f, \"max_error\": %d}", quality->ssim,
+            quality->mse, quality->mean_error, quality->max_error);
+}
+
+static bool config_selected(const char* list, const char* name) {
+    if (!list) return true;
+    size_t length = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += length) {
+        bool starts = p == list || p[-1] == ',';
+        bool ends = p[length] == '\0' || p[length] == ',';
+        if (starts && ends) return true;
+    }
+    return false;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--npz depth.npz [--rgb frame.png]] [--size 640x480] [--frames N] [--warmup N] [--threads N]\n"
+           "       [--configs decimated,decimated_coarse,quantized,decimated_quantized] [--images DIR]\n"
+           "       [--out quality_bench.json]\n", program);
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->width = BENCH_DEFAULT_WIDTH;
+    options->height = BENCH_DEFAULT_HEIGHT;
+    options->frames = BENCH_DEFAULT_FRAMES;
+    options->warmup = BENCH_DEFAULT_WARMUP;
+    options->out_path = BENCH_DEFAULT_OUT;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (strcmp(argv[i], "--npz") == 0 && ok) {
+            options->npz_path = value;
+        } else if (strcmp(argv[i], "--rgb") == 0 && ok) {
+            options->rgb_path = value;
+        } else if (strcmp(argv[i], "--size") == 0 && ok) {
+            ok = sscanf(value, "%dx%d", &options->width, &options->height) == 2 && options->width >= 2 &&
+                 options->height >= 2;
+        } else if (strcmp(argv[i], "--frames") == 0 && ok) {
+            ok = (options->frames = atoi(value)) > 0;
+        } else if (strcmp(argv[i], "--warmup") == 0 && ok) {
+            ok = (options->warmup = atoi(value)) >= 0;
+        } else if (strcmp(argv[i], "--threads") == 0 && ok) {
+            ok = (options->threads = atoi(value)) > 0;
+        } else if (strcmp(argv[i], "--configs") == 0 && ok) {
+            options->configs = value;
+        } else if (strcmp(argv[i], "--images") == 0 && ok) {
+            options->image_dir = value;
+        } else if (strcmp(argv[i], "--out") == 0 && ok) {
+            options->out_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printf("Invalid argument: %s\n", argv[i]);
+            return false;
+        }
+        i++;
+    }
+    if (options->rgb_path && !options->npz_path) {
+        printf("--rgb needs --npz.\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (options.threads > 0) omp_set_num_threads(options.threads);
+    if (options.image_dir && !platform_make_dir(options.image_dir)) {
+        printf("Failed to create %s.\n", options.image_dir);
+        return 1;
+    }
+
+    QualityFrame frame;
+    if (!load_frame(&options, &frame)) {
+        free_frame(&frame);
+        return 1;
+    }
+    if (options.image_dir && frame.image) write_ppm(options.image_dir, "rgb", frame.image, frame.width, frame.height);
+
+    FILE* out = fopen(options.out_path, "w");
+    if (!out) {
+        printf("Failed to open %s for writing.\n", options.out_path);
+        free_frame(&frame);
+        return 1;
+    }
+    fprintf(out, "{\n  \"benchmark\": \"quality_bench\",\n  \"source\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n"
+                 "  \"frames\": %d,\n  \"threads\": %d,\n  \"results\": [",
+            options.npz_path ? options.npz_path : "synthetic", frame.width, frame.height, options.frames,
+            omp_get_max_threads());
+
+    // The reference always runs; its first and last frames differ only by races between render threads
+    ConfigResult reference;
+    bool have_reference = false;
+    int status = 0;
+    for (size_t c = 0; c < QUALITY_CONFIG_COUNT; c++) {
+        const QualityConfig* config = &quality_configs[c];
+        if (c > 0 && !config_selected(options.configs, config->name)) continue;
+        fprintf(stderr, "%s...\n", config->name);
+
+        ConfigResult current;
+        ConfigResult* result = c == 0 ? &reference : &current;
+        if (!run_config(config, &frame, &options, result)) {
+            free_result(result);
+            status = 1;
+            if (c == 0) break;
+            continue;
+        }
+        if (c == 0) have_reference = true;
+
+        ImageQuality versus_reference, versus_rgb;
+        const unsigned char* baseline = c == 0 ? reference.first : reference.last;
+        bool measured = image_quality_compare(baseline, result->last, frame.width, frame.height, &versus_reference);
+        if (frame.image) {
+            measured = image_quality_compare(frame.image, result->last, frame.width, frame.height, &versus_rgb) &&
+                       measured;
+        }
+
+        fprintf(out, "%s\n    {\"config\": \"%s\", \"splats\": %d, \"scene_bytes\": %zu, \"build_ms\": %.3f,\n"
+                     "     \"ms_p50\": %.4f, \"ms_min\": %.4f, \"speedup\": %.4f",
+                c == 0 ? "" : ",", config->name, result->splats, result->scene_bytes, result->build_ms,
+                result->ms_p50, result->ms_min, reference.ms_p50 / result->ms_p50);
+        if (measured) {
+            write_quality(out, "vs_reference", &versus_reference);
+            if (frame.image) write_quality(out, "vs_rgb", &versus_rgb);
+        }
+        fprintf(out, "}");
+
+        if (options.image_dir) write_ppm(options.image_dir, config->name, result->last, frame.width, frame.height);
+        if (c > 0) free_result(result);
+    }
+    if (have_reference) free_result(&reference);
+
+    fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+    free_frame(&frame);
+    if (status == 0) printf("Wrote %s\n", options.out_path);
+    return status;
+}
@@ -0,0 +1,520 @@
+// File: tools/splat_bench.c
+// Headless rendering benchmark. Renders synthetic scenes along a fixed camera
+// path at several resolutions and thread counts and prints the results as JSON,
+// so that changes to the render paths can be compared run against run.
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "renderer.h"
+#include "perf_counters.h"
+#include "unproject.h"
+#include "platform.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define BENCH_MAX_LIST 16
+#define BENCH_DEFAULT_SPLATS 200000
+#define BENCH_DEFAULT_FRAMES 60
+#define BENCH_DEFAULT_WARMUP 5
+#define BENCH_HUGE_SPLATS 64      // Splats in the overlap scene, regardless of --splats
+
+typedef int (*SceneGenerator)(size_t count, uint32_t seed, Splat** splats);
+
+typedef struct {
+    const char* name;
+    SceneGenerator generate;
+} BenchScene;
+
+typedef struct {
+    size_t splats;
+    int frames;
+    int warmup;
+    int threads[BENCH_MAX_LIST];
+    int thread_count;
+    int widths[BENCH_MAX_LIST], heights[BENCH_MAX_LIST];
+    int resolution_count;
+    const char* scenes;     // Comma-separated scene names, NULL for all
+    const char* out_path;   // NULL for stdout
+    bool perf;              // Hardware counters per stage
+} BenchOptions;
+
+// Deterministic generator so every run renders the same scenes
+static uint32_t next_random(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static float random_unit(uint32_t* state) {
+    return (next_random(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+static float random_range(uint32_t* state, float low, float high) {
+    return low + (high - low) * random_unit(state);
+}
+
+static Splat* alloc_splats(size_t count) {
+    Splat* splats = (Splat*)malloc((count ? count : 1) * sizeof(Splat));
+    if (!splats) printf("Error: Failed to allocate %zu splats.\n", count);
+    return splats;
+}
+
+static void random_color(Splat* splat, uint32_t* state, float alpha) {
+    splat->r = random_unit(state);
+    splat->g = random_unit(state);
+    splat->b = random_unit(state);
+    splat->a = alpha;
+    splat->dx = splat->dy = splat->dz = 0.0f;
+}
+
+// Splats spread evenly through a cube, most of them overlapping others on screen
+static int generate_uniform_volume(size_t count, uint32_t seed, Splat** splats) {
+    Splat* out = alloc_splats(count);
+    if (!out) return 0;
+    for (size_t i = 0; i < count; i++) {
+        out[i].x = random_range(&seed, -1.0f, 1.0f);
+        out[i].y = random_range(&seed, -1.0f, 1.0f);
+        out[i].z = random_range(&seed, -1.0f, 1.0f);
+        out[i].scale = 0.01f;
+        random_color(&out[i], &seed, 0.8f);
+    }
+    *splats = out;
+    return (int)count;
+}
+
+// A rippled sheet sampled densely enough that neighbors overlap, like a scanned surface
+static int generate_dense_surface(size_t count, uint32_t seed, Splat** splats) {
+    Splat* out = alloc_splats(count);
+    if (!out) return 0;
+    int side = (int)ceil(sqrt((double)count));
+    float spacing = 2.0f / side;
+    for (size_t i = 0; i < count; i++) {
+        float u = -1.0f + spacing * (float)(i % side);
+        float v = -1.0f + spacing * (float)(i / side);
+        out[i].x = u;
+        out[i].y = 0.15f * sinf(u * 6.0f) * cosf(v * 5.0f);
+        out[i].z = v;
+        out[i].scale = spacing * 1.5f;
+        random_color(&out[i], &seed, 1.0f);
+    }
+    *splats = out;
+    return (int)count;
+}
+
+// A few splats that each cover a large part of the screen; stresses per-pixel blending
+static int generate_huge_overlapping(size_t count, uint32_t seed, Splat** splats) {
+    (void)count;
+    Splat* out = alloc_splats(BENCH_HUGE_SPLATS);
+    if (!out) return 0;
+    for (size_t i = 0; i < BENCH_HUGE_SPLATS; i++) {
+        out[i].x = random_range(&seed, -0.5f, 0.5f);
+        out[i].y = random_range(&seed, -0.5f, 0.5f);
+        out[i].z = random_range(&seed, -0.5f, 0.5f);
+        out[i].scale = random_range(&seed, 0.4f, 1.0f);
+        random_color(&out[i], &seed, 0.3f);
+    }
+    *splats = out;
+    return BENCH_HUGE_SPLATS;
+}
+
+// Many splats smaller than a pixel; stresses projection and culling rather than blending
+static int generate_subpixel(size_t count, uint32_t seed, Splat** splats) {
+    Splat* out = alloc_splats(count);
+    if (!out) return 0;
+    for (size_t i = 0; i < count; i++) {
+        out[i].x = random_range(&seed, -1.5f, 1.5f);
+        out[i].y = random_range(&seed, -1.5f, 1.5f);
+        out[i].z = random_range(&seed, -1.5f, 1.5f);
+        out[i].scale = 0.0005f;
+        random_color(&out[i], &seed, 1.0f);
+    }
+    *splats = out;
+    return (int)count;
+}
+
+// A synthetic depth frame (ground, back wall and a box) unprojected like a real capture
+static int generate_depth_grid(size_t count, uint32_t seed, Splat** splats) {
+    int width = (int)ceil(sqrt(count * 4.0 / 3.0));
+    int height = (int)((count + width - 1) / width);
+    size_t pixels = (size_t)width * height;
+    float* depth = (float*)malloc(pixels * sizeof(float));
+    unsigned char* rgb = (unsigned char*)malloc(pixels * 3);
+    if (!depth || !rgb) {
+        free(depth);
+        free(rgb);
+        return 0;
+    }
+
+    CameraIntrinsics intrinsics = camera_intrinsics_from_fov(width, height, 90.0f);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            size_t i = (size_t)y * width + x;
+            float ray_y = (y - intrinsics.cy) / intrinsics.fy;
+            float z = ray_y > 0.25f ? 0.75f / ray_y : 3.0f;  // Ground below the horizon, wall behind
+            bool box = x > width / 2 && x < width * 3 / 4 && y > height / 4 && y < height / 2;
+            if (box) z = 2.0f + 0.5f * (float)x / width;
+            depth[i] = z < 3.0f ? z : 3.0f;
+            unsigned char shade = (unsigned char)(next_random(&seed) >> 27);
+            rgb[i * 3 + 0] = (unsigned char)(box ? 200 : 60) + shade;
+            rgb[i * 3 + 1] = (unsigned char)(ray_y > 0.25f ? 140 : 90) + shade;
+            rgb[i * 3 + 2] = (unsigned char)(box ? 40 : 160) + shade;
+        }
+    }
+
+    size_t shape[2] = { (size_t)height, (size_t)width };
+    cnpy_array view = {0};
+    view.data = depth;
+    view.shape = shape;
+    view.ndim = 2;
+    view.datatype = 'f';
+    view.dtype = CNPY_DTYPE_F4;
+    view.word_size = sizeof(float);
+
+    UnprojectParams params = {0};
+    params.intrinsics = intrinsics;
+    params.rgb = rgb;
+    params.rgb_width = width;
+    params.rgb_height = height;
+    params.rgb_channels = 3;
+    int splat_count = unproject_depth_to_splats(&view, &params, splats);
+    free(depth);
+    free(rgb);
+
+    // Center the frame on the origin like the other scenes
+    for (int i = 0; i < splat_count; i++) {
+        (*splats)[i].z += 2.0f;
+    }
+    return splat_count;
+}
+
+static const BenchScene bench_scenes[] = {
+    {"uniform_volume", generate_uniform_volume},
+    {"dense_surface", generate_dense_surface},
+    {"huge_overlapping", generate_huge_overlapping},
+    {"subpixel", generate_subpixel},
+    {"depth_grid", generate_depth_grid},
+};
+
+// Fixed path: a partial orbit around the origin while moving in, looking at the center
+static void camera_on_path(Camera* camera, int frame, int frame_count) {
+    float t = frame_count > 1 ? (float)frame / (frame_count - 1) : 0.0f;
+    float angle = (-30.0f + 60.0f * t) * (float)M_PI / 180.0f;
+    float distance = 3.5f - 1.0f * t;
+    vec3 position = { distance * sinf(angle), 0.4f * sinf(angle * 2.0f), distance * cosf(angle) };
+
+    camera_init(camera);
+    camera->position = position;
+    float length = sqrtf(position.x * position.x + position.y * position.y + position.z * position.z);
+    camera->yaw = atan2f(-position.z, -position.x) * 180.0f / (float)M_PI;
+    camera->pitch = asinf(-position.y / length) * 180.0f / (float)M_PI;
+    camera_update_vectors(camera);
+}
+
+// Pixels inside the footprint of every splat drawn in the last frame, counted per row from the projected records
+static double count_shaded_pixels(const Renderer* renderer, int splat_count) {
+    int block_count = (splat_count + PROJECT_BLOCK_SIZE - 1) / PROJECT_BLOCK_SIZE;
+    double shaded = 0.0;
+
+    #pragma omp parallel for reduction(+:shaded) schedule(dynamic, 16)
+    for (int block = 0; block < block_count; block++) {
+        const ProjectedSplat* splat = renderer->projected + (size_t)block * PROJECT_BLOCK_SIZE;
+        for (int i = 0; i < renderer->block_counts[block]; i++, splat++) {
+            int min_x = (int)fmaxf(0, splat->x - splat->radius);
+            int max_x = (int)fminf(renderer->width - 1, splat->x + splat->radius);
+            int min_y = (int)fmaxf(0, splat->y - splat->radius);
+            int max_y = (int)fminf(renderer->height - 1, splat->y + splat->radius);
+            for (int y = min_y; y <= max_y; y++) {
+                float dy = (y - splat->y) / splat->radius;
+                if (dy * dy > 1.0f) continue;
+                float half = sqrtf(1.0f - dy * dy) * splat->radius;
+                int first = (int)ceilf(splat->x - half), last = (int)floorf(splat->x + half);
+                if (first < min_x) first = min_x;
+                if (last > max_x) last = max_x;
+                if (last >= first) shaded += last - first + 1;
+            }
+        }
+    }
+    return shaded;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+typedef struct {
+    double ms_mean, ms_p50, ms_p95, ms_min;
+    double shaded_pixels;      // Per frame, averaged over the path
+    int visible;               // On the last frame
+    double stages[PROFILE_STAGE_COUNT];  // p50 milliseconds
+    bool counted;                        // Hardware counters were available
+    bool has[PERF_EVENT_COUNT];
+    double counters[PROFILE_STAGE_COUNT][PERF_EVENT_COUNT];  // Per frame, summed over threads
+} BenchResult;
+
+static bool run_config(Splat* splats, int splat_count, int width, int height, const BenchOptions* options,
+                       bool count_pixels, BenchResult* result) {
+    Renderer renderer;
+    init_renderer_headless(&renderer, width, height);
+    double* times = (double*)malloc((size_t)options->frames * sizeof(double));
+    if (!times) {
+        free_renderer(&renderer);
+        return false;
+    }
+
+    Camera camera;
+    for (int frame = 0; frame < options->warmup; frame++) {
+        camera_on_path(&camera, frame, options->warmup);
+        render_scene(&renderer, splats, splat_count, &camera, DEBUG_NONE, 10);
+    }
+    profiler_init(&renderer.profiler);
+    if (options->perf) renderer.profiler.perf = perf_counters_open();   // Closed by free_renderer
+
+    memset(result, 0, sizeof(*result));
+    double total = 0.0;
+    for (int frame = 0; frame < options->frames; frame++) {
+        camera_on_path(&camera, frame, options->frames);
+        double start = platform_time_seconds();
+        render_scene(&renderer, splats, splat_count, &camera, DEBUG_NONE, 10);
+        times[frame] = (platform_time_seconds() - start) * 1000.0;
+        total += times[frame];
+
+        // Outside the timed region; the count depends only on the camera, not the thread count
+        if (count_pixels) result->shaded_pixels += count_shaded_pixels(&renderer, splat_count);
+    }
+    profiler_begin_frame(&renderer.profiler);  // Completes the last frame's sample
+
+    ProfileReport report;
+    profiler_get_report(&renderer.profiler, &report);
+    for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+        result->stages[stage] = report.stages[stage].p50;
+    }
+    result->visible = report.counters.visible;
+
+    const PerfCounters* perf = renderer.profiler.perf;
+    if (perf && perf_counters_frames(perf) > 0) {
+        result->counted = true;
+        for (int stage = 0; stage < PROFILE_STAGE_COUNT; stage++) {
+            PerfSample sample;
+            perf_counters_get(perf, (ProfileStage)stage, -1, &sample);
+            for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                result->has[e] = perf_counters_has(perf, (PerfEvent)e);
+                result->counters[stage][e] = (double)sample.values[e] / perf_counters_frames(perf);
+            }
+        }
+    }
+
+    qsort(times, (size_t)options->frames, sizeof(double), compare_double);
+    result->ms_mean = total / options->frames;
+    result->ms_p50 = times[options->frames / 2];
+    result->ms_p95 = times[(size_t)(options->frames * 0.95)];
+    result->ms_min = times[0];
+    result->shaded_pixels /= options->frames;
+
+    free(times);
+    free_renderer(&renderer);
+    return true;
+}
+
+static bool scene_selected(const char* list, const char* name) {
+    if (!list) return true;
+    size_t length = strlen(name);
+    for (const char* p = list; (p = strstr(p, name)) != NULL; p += length) {
+        bool starts = p == list || p[-1] == ',';
+        bool ends = p[length] == '\0' || p[length] == ',';
+        if (starts && ends) return true;
+    }
+    return false;
+}
+
+static int parse_int_list(const char* text, int* values, int max_count) {
+    int count = 0;
+    while (*text && count < max_count) {
+        char* end;
+        long value = strtol(text, &end, 10);
+        if (end == text || value <= 0) return 0;
+        values[count++] = (int)value;
+        text = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return 0;
+    }
+    return count;
+}
+
+static int parse_resolutions(const char* text, int* widths, int* heights, int max_count) {
+    int count = 0;
+    while (*text && count < max_count) {
+        int width, height, consumed;
+        if (sscanf(text, "%dx%d%n", &width, &height, &consumed) != 2 || width <= 0 || height <= 0 ||
+            (width * height) % 4 != 0) {
+            return 0;
+        }
+        widths[count] = width;
+        heights[count] = height;
+        count++;
+        text += consumed;
+        if (*text == ',') text++;
+        else if (*text != '\0') return 0;
+    }
+    return count;
+}
+
+static void print_usage(const char* program) {
+    printf("Usage: %s [--splats N] [--frames N] [--warmup N] [--threads 1,2,4] [--resolutions 640x360,1920x1080]\n"
+           "       [--scenes uniform_volume,dense_surface,huge_overlapping,subpixel,depth_grid] [--out results.json] [--perf]\n",
+           program);
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    memset(options, 0, sizeof(*options));
+    options->splats = BENCH_DEFAULT_SPLATS;
+    options->frames = BENCH_DEFAULT_FRAMES;
+    options->warmup = BENCH_DEFAULT_WARMUP;
+
+    // Powers of two up to every core, plus every core
+    int max_threads = omp_get_max_threads();
+    for (int n = 1; n < max_threads && options->thread_count < BENCH_MAX_LIST - 1; n *= 2) {
+        options->threads[options->thread_count++] = n;
+    }
+    options->threads[options->thread_count++] = max_threads;
+
+    static const int default_widths[] = {640, 1280, 1920}, default_heights[] = {360, 720, 1080};
+    options->resolution_count = 3;
+    memcpy(options->widths, default_widths, sizeof(default_widths));
+    memcpy(options->heights, default_heights, sizeof(default_heights));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--perf") == 0) {
+            options->perf = true;
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+        if (strcmp(argv[i], "--splats") == 0 && ok) {
+            options->splats = (size_t)strtoull(value, NULL, 10);
+            ok = options->splats > 0;
+        } else if (strcmp(argv[i], "--frames") == 0 && ok) {
+            ok = (options->frames = atoi(value)) > 0;
+        } else if (strcmp(argv[i], "--warmup") == 0 && ok) {
+            ok = (options->warmup = atoi(value)) >= 0;
+        } else if (strcmp(argv[i], "--threads") == 0 && ok) {
+            ok = (options->thread_count = parse_int_list(value, options->threads, BENCH_MAX_LIST)) > 0;
+        } else if (strcmp(argv[i], "--resolutions") == 0 && ok) {
+            ok = (options->resolution_count = parse_resolutions(value, options->widths, options->heights,
+                                                                BENCH_MAX_LIST)) > 0;
+        } else if (strcmp(argv[i], "--scenes") == 0 && ok) {
+            options->scenes = value;
+        } else if (strcmp(argv[i], "--out") == 0 && ok) {
+            options->out_path = value;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printf("Invalid argument: %s\n", argv[i]);
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Probed once, so hosts without counters get one message and plain results
+    if (options.perf) {
+        PerfCounters* probe = perf_counters_open();
+        options.perf = probe != NULL;
+        perf_counters_close(probe);
+    }
+
+    FILE* out = options.out_path ? fopen(options.out_path, "w") : stdout;
+    if (!out) {
+        printf("Failed to open %s for writing.\n", options.out_path);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"benchmark\": \"splat_bench\",\n  \"frames\": %d,\n  \"warmup\": %d,\n"
+                 "  \"max_threads\": %d,\n  \"results\": [", options.frames, options.warmup, omp_get_max_threads());
+    bool first_result = true;
+
+    for (size_t s = 0; s < sizeof(bench_scenes) / sizeof(bench_scenes[0]); s++) {
+        const BenchScene* scene = &bench_scenes[s];
+        if (!scene_selected(options.scenes, scene->name)) continue;
+
+        Splat* splats = NULL;
+        int splat_count = scene->generate(options.splats, 12345u + (uint32_t)s, &splats);
+        if (splat_count == 0) {
+            printf("Failed to generate scene %s.\n", scene->name);
+            fclose(out);
+            return 1;
+        }
+
+        for (int r = 0; r < options.resolution_count; r++) {
+            int width = options.widths[r], height = options.heights[r];
+            double shaded_pixels = 0.0;
+            double reference_cost = 0.0;   // ms * threads of the first thread count
+
+            for (int t = 0; t < options.thread_count; t++) {
+                int threads = options.threads[t];
+                omp_set_num_threads(threads);
+                fprintf(stderr, "%s %dx%d, %d thread(s)...\n", scene->name, width, height, threads);
+
+                BenchResult result;
+                if (!run_config(splats, splat_count, width, height, &options, t == 0, &result)) {
+                    printf("Failed to render scene %s.\n", scene->name);
+                    free(splats);
+                    fclose(out);
+                    return 1;
+                }
+                if (t == 0) {
+                    shaded_pixels = result.shaded_pixels;
+                    reference_cost = result.ms_mean * threads;
+                }
+
+                double seconds = result.ms_mean / 1000.0;
+                fprintf(out, "%s\n    {\"scene\": \"%s\", \"splats\": %d, \"width\": %d, \"height\": %d, \"threads\": %d,\n"
+                             "     \"ms_per_frame\": %.4f, \"ms_p50\": %.4f, \"ms_p95\": %.4f, \"ms_min\": %.4f,\n"
+                             "     \"splats_per_sec\": %.1f, \"shaded_pixels_per_frame\": %.1f, \"shaded_pixels_per_sec\": %.1f,\n"
+                             "     \"visible_splats\": %d, \"scaling_efficiency\": %.4f,\n     \"stage_ms_p50\": {",
+                        first_result ? "" : ",", scene->name, splat_count, width, height, threads,
+                        result.ms_mean, result.ms_p50, result.ms_p95, result.ms_min,
+                        splat_count / seconds, shaded_pixels, shaded_pixels / seconds,
+                        result.visible, reference_cost / (result.ms_mean * threads));
+                // Headless frames have no upload, resolve or present
+                for (int stage = 0; stage <= PROFILE_RASTERIZE; stage++) {
+                    fprintf(out, "%s\"%s\": %.4f", stage ? ", " : "", profile_stage_name((ProfileStage)stage),
+                            result.stages[stage]);
+                }
+                fprintf(out, "}");
+                if (result.counted) {
+                    fprintf(out, ",\n     \"counters_per_frame\": {");
+                    for (int stage = 0; stage <= PROFILE_RASTERIZE; stage++) {
+                        fprintf(out, "%s\"%s\": {", stage ? ", " : "", profile_stage_name((ProfileStage)stage));
+                        bool first_event = true;
+                        for (int e = 0; e < PERF_EVENT_COUNT; e++) {
+                            if (!result.has[e]) continue;
+                            fprintf(out, "%s\"%s\": %.0f", first_event ? "" : ", ", perf_event_name((PerfEvent)e),
+                                    result.counters[stage][e]);
+                            first_event = false;
+                        }
+                        fprintf(out, "}");
+                    }
+                    fprintf(out, "}");
+                }
+                fprintf(out, "}");
+                first_result = false;
+            }
+        }
+        free(splats);
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,66 @@
+// File: tools/splat_convert.c
+// Converts a depth map (.npz) and optional RGB frame (.png) into a binary
+// splat scene that the renderer can memory-map at startup.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "data_loader.h"
+#include "image_loader.h"
+#include "scene_file.h"
+#include "mem_track.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+static void print_usage(const char* program) {
+    printf("Usage: %s <depth.npz> [rgb.png] <output.splatscene>\n", program);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3 && argc != 4) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* npz_path = argv[1];
+    const char* rgb_path = argc == 4 ? argv[2] : NULL;
+    const char* output_path = argv[argc - 1];
+
+    Splat* splats;
+    int splat_count = load_splats_from_npz(npz_path, &splats);
+    if (splat_count == 0) {
+        printf("Failed to load splats from %s.\n", npz_path);
+        return 1;
+    }
+
+    if (rgb_path) {
+        int width, height, channels;
+        unsigned char* rgb = load_png_image(rgb_path, &width, &height, &channels);
+        if (!rgb) {
+            mem_free(MEM_LOADER, splats);
+            return 1;
+        }
+
+        // One splat per depth pixel, so the image must cover the same grid
+        if ((long long)width * height != splat_count) {
+            printf("RGB image %dx%d does not match %d depth samples; keeping default colors.\n",
+                   width, height, splat_count);
+        } else {
+            for (int i = 0; i < splat_count; i++) {
+                const unsigned char* pixel = rgb + (size_t)i * channels;
+                splats[i].r = pixel[0] / 255.0f;
+                splats[i].g = pixel[channels >= 3 ? 1 : 0] / 255.0f;
+                splats[i].b = pixel[channels >= 3 ? 2 : 0] / 255.0f;
+            }
+        }
+        free_png_image(rgb);
+    }
+
+    bool ok = scene_file_write(output_path, splats, (size_t)splat_count, NULL);
+    mem_free(MEM_LOADER, splats);
+
+    if (!ok) {
+        return 1;
+    }
+    printf("Wrote %d splats to %s.\n", splat_count, output_path);
+    return 0;
+}